@@ -16,6 +16,15 @@ export const GameBoyButton = {
     DOWN: 7
 };
 
+// Stop conditions for runCycles (bit mask, mirrors GameBoyStopReason in core.h)
+export const GameBoyStop = {
+    BUDGET: 0,
+    VBLANK: 1 << 0,
+    JOYPAD: 1 << 1,
+    SERIAL: 1 << 2,
+    BREAKPOINT: 1 << 3
+};
+
 export class EmulatorCore {
     constructor(wasmModule, coreName) {
         this.wasm = wasmModule;
@@ -47,10 +56,32 @@ export class EmulatorCore {
         this.init = getExport('init');
         this.loadRom = getExport('load_rom');
         this.stepFrame = getExport('step_frame');
+        this.runCyclesFn = getExport('run_cycles');
+        this.getRunCycles = getExport('get_run_cycles');
+        this.setBreakpoint = getExport('set_breakpoint');
+        this.clearBreakpoints = getExport('clear_breakpoints');
         this.setButton = getExport('set_button');
         this.getFramebuffer = getExport('get_framebuffer');
         this.getAudioBufferPtr = getExport('get_audio_buffer');
         this.getAudioBufferSize = getExport('get_audio_buffer_size');
+        this.setIdleLoopSkip = getExport('set_idle_loop_skip');
+        this.getIdleLoopHits = getExport('get_idle_loop_hits');
+        this.getIdleLoopCycles = getExport('get_idle_loop_cycles');
+        this.setBlockCacheEnabled = getExport('set_block_cache');
+        this.getBlockCacheHits = getExport('get_block_cache_hits');
+        this.getBlockCacheMisses = getExport('get_block_cache_misses');
+        this.getBlockCacheBytes = getExport('get_block_cache_bytes');
+        this.setJitEnabled = getExport('set_jit');
+        this.setColorCorrectionEnabled = getExport('set_color_correction');
+        this.setDeferredRenderEnabled = getExport('set_deferred_render');
+        this.getJitBlocks = getExport('get_jit_blocks');
+        this.getLog = getExport('get_log');
+        this.setTraceRing = getExport('set_trace');
+        this.getTraceRecords = getExport('get_trace');
+        this.getTraceCount = getExport('get_trace_count');
+        this.setGuestProfilerEnabled = getExport('set_guest_profiler');
+        this.getGuestProfilePtr = getExport('get_guest_profile');
+        this.getGuestProfileSize = getExport('get_guest_profile_size');
         this.saveState = getExport('save_state');
         this.loadState = getExport('load_state');
         this.reset = getExport('reset');
@@ -110,6 +141,13 @@ export class EmulatorCore {
         if (this.stepFrame) this.stepFrame();
     }
 
+    // Run up to `budget` cycles; stops early on any GameBoyStop bit in stopMask
+    runCycles(budget, stopMask = 0) {
+        if (!this.runCyclesFn) return null;
+        const reason = this.runCyclesFn(budget, stopMask);
+        return { reason, cycles: this.getRunCycles ? this.getRunCycles() : budget };
+    }
+
     setButtonState(button, pressed) {
         if (this.setButton) this.setButton(button, pressed ? 1 : 0);
     }
@@ -126,6 +164,105 @@ export class EmulatorCore {
         return new ImageData(memory, width, height);
     }
 
+    // Idle-loop skipping is on by default; turn it off for games that misbehave
+    setIdleLoopSkipping(enabled) {
+        if (this.setIdleLoopSkip) this.setIdleLoopSkip(enabled ? 1 : 0);
+    }
+
+    // Polling loops fast-forwarded and cycles saved during the last frame
+    getIdleLoopStats() {
+        if (!this.getIdleLoopHits || !this.getIdleLoopCycles) return null;
+        return { hits: this.getIdleLoopHits(), cycles: this.getIdleLoopCycles() };
+    }
+
+    // Run the CPU from the basic-block translation cache (fast-forward, headless)
+    setBlockCache(enabled) {
+        if (this.setBlockCacheEnabled) this.setBlockCacheEnabled(enabled ? 1 : 0);
+    }
+
+    // Cache hit rate and footprint since the cache was last switched
+    getBlockCacheStats() {
+        if (!this.getBlockCacheHits || !this.getBlockCacheMisses) return null;
+        const hits = this.getBlockCacheHits();
+        const misses = this.getBlockCacheMisses();
+        return {
+            hits,
+            misses,
+            hitRate: hits + misses ? hits / (hits + misses) : 0,
+            bytes: this.getBlockCacheBytes ? this.getBlockCacheBytes() : 0,
+            jitBlocks: this.getJitBlocks ? this.getJitBlocks() : 0,
+        };
+    }
+
+    // Compile hot blocks to WebAssembly (only while the block cache is on)
+    setJit(enabled) {
+        if (this.setJitEnabled) this.setJitEnabled(enabled ? 1 : 0);
+    }
+
+    // CGB colours through the LCD response curve instead of raw RGB555
+    setColorCorrection(enabled) {
+        if (this.setColorCorrectionEnabled) this.setColorCorrectionEnabled(enabled ? 1 : 0);
+    }
+
+    // Draw each frame in one pass at VBlank instead of line by line
+    setDeferredRender(enabled) {
+        if (this.setDeferredRenderEnabled) this.setDeferredRenderEnabled(enabled ? 1 : 0);
+    }
+
+    // Pending core log lines (only builds made with LOG_LEVEL log anything)
+    drainLog() {
+        if (!this.getLog || !this.malloc) return '';
+
+        const size = 16384;
+        const ptr = this.malloc(size);
+        const length = this.getLog(ptr, size);
+
+        this.updateMemoryViews();
+        const text = new TextDecoder().decode(this.HEAPU8.subarray(ptr, ptr + length));
+        this.free(ptr);
+        return text;
+    }
+
+    // Keep the last `records` executed instructions in the trace ring; 0 turns
+    // tracing off
+    setTrace(records) {
+        if (!this.setTraceRing) return false;
+        return this.setTraceRing(records) === 0;
+    }
+
+    // Copy of the newest `max` trace records, oldest first: 24 bytes each,
+    // laid out as GameBoyTraceRecord in core.h
+    getTrace(max) {
+        if (!this.getTraceRecords || !this.malloc) return null;
+
+        const RECORD_SIZE = 24;
+        const ptr = this.malloc(max * RECORD_SIZE);
+        const count = this.getTraceRecords(ptr, max);
+
+        this.updateMemoryViews();
+        const records = this.HEAPU8.slice(ptr, ptr + count * RECORD_SIZE);
+        this.free(ptr);
+        return records;
+    }
+
+    // Guest code profiler (builds with GB_GUEST_PROFILER only); starting
+    // clears the last profile
+    setGuestProfiler(enabled) {
+        if (this.setGuestProfilerEnabled) this.setGuestProfilerEnabled(enabled ? 1 : 0);
+    }
+
+    // Profile text: folded stacks for a flame graph, or with `hotspots`
+    // "bank:addr cycles" lines, most cycles first
+    getGuestProfile(hotspots = false) {
+        if (!this.getGuestProfilePtr || !this.getGuestProfileSize) return '';
+
+        const ptr = this.getGuestProfilePtr(hotspots ? 1 : 0);
+        const size = this.getGuestProfileSize();
+
+        this.updateMemoryViews();
+        return new TextDecoder().decode(this.HEAPU8.subarray(ptr, ptr + size));
+    }
+
     getAudioSamples() {
         if (!this.getAudioBufferPtr || !this.getAudioBufferSize) return null;
 
@@ -0,0 +1,54 @@
+#!/bin/bash
+
+# NeoBoy ALU Path Comparison
+# Runs a ROM through the GB core with computed and with table-driven ALU
+# flags (GB_ALU_TABLES) and prints the best of RUNS speeds for each: natively
+# always, and as WASM under Node when gb.js and gb-alu.js have been built.
+#
+# Usage: scripts/alu-bench.sh <rom.gb> [frames]
+# (normally via: make alu-bench ROM=<rom.gb> [FRAMES=n])
+
+set -e
+
+ROM="$1"
+FRAMES="${2:-600}"
+RUNS="${RUNS:-5}"
+BIN_DIR="build/native"
+WASM_DIR="frontend/src/wasm/generated"
+
+if [ -z "$ROM" ]; then
+    echo "Usage: $0 <rom.gb> [frames]"
+    exit 1
+fi
+
+# Best "speed:" (fps) of RUNS runs of a command that prints gb-bench output
+best_fps() {
+    for _ in $(seq "$RUNS"); do
+        "$@" 2>&1 | awk '/^speed:/ { print $2 }'
+    done | sort -g | tail -n 1
+}
+
+report() {
+    printf "%-6s computed %10.1f fps   tables %10.1f fps   %+.1f%%\n" "$1" "$2" "$3" \
+        "$(awk -v c="$2" -v t="$3" 'BEGIN { print (t / c - 1) * 100 }')"
+}
+
+for variant in computed tables; do
+    if [ ! -x "$BIN_DIR/gb-bench-alu-$variant" ]; then
+        echo "Error: $BIN_DIR/gb-bench-alu-$variant not found (run 'make alu-bench')."
+        exit 1
+    fi
+done
+
+"$BIN_DIR/gb-bench-alu-tables" "$ROM" 1 2>&1 | grep "^ALU tables:"
+report native \
+    "$(best_fps "$BIN_DIR/gb-bench-alu-computed" "$ROM" "$FRAMES")" \
+    "$(best_fps "$BIN_DIR/gb-bench-alu-tables" "$ROM" "$FRAMES")"
+
+if command -v node > /dev/null && [ -f "$WASM_DIR/gb.js" ] && [ -f "$WASM_DIR/gb-alu.js" ]; then
+    report wasm \
+        "$(best_fps node tools/gb-wasm-bench.mjs "$WASM_DIR/gb.js" "$ROM" "$FRAMES")" \
+        "$(best_fps node tools/gb-wasm-bench.mjs "$WASM_DIR/gb-alu.js" "$ROM" "$FRAMES")"
+else
+    echo "wasm   skipped (needs node and 'make gb gb-alu')"
+fi
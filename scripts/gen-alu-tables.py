@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+NeoBoy - LR35902 ALU Table Generator
+
+Emits wasm/core-gb/alu_tables.h: precomputed results and flags of the 8-bit
+arithmetic that cpu.c otherwise computes per instruction. The header is only
+used by builds with GB_ALU_TABLES=1 (see wasm/core-gb/profile.h) and is
+generated by the Makefile before such a build; it is not checked in.
+
+Entries are in the CPU's lazy flag form (see gb_cpu_t in cpu.h):
+
+  gb_alu_add[c << 16 | a << 8 | n]   ADD/ADC: a + n + c
+  gb_alu_sub[c << 16 | a << 8 | n]   SUB/SBC/CP: a - n - c
+      bits 0-7 result (and Z byte), bit 8 C, bit 12 H
+
+  gb_alu_inc[r], gb_alu_dec[r]       INC/DEC: bits 0-7 result, bit 12 H
+
+  gb_alu_daa[n << 10 | h << 9 | c << 8 | a]
+      bits 0-7 corrected A, bit 8 C (H is always cleared, N kept)
+
+Usage: python3 scripts/gen-alu-tables.py [output]
+"""
+
+import os
+import sys
+
+H_BIT = 12
+C_BIT = 8
+
+
+def add_table():
+    t = []
+    for c in range(2):
+        for a in range(256):
+            for n in range(256):
+                res = a + n + c
+                h = (a ^ n ^ res) & 0x10
+                t.append((res & 0xFF) | ((res >> 8) << C_BIT) | ((h >> 4) << H_BIT))
+    return t
+
+
+def sub_table():
+    t = []
+    for c in range(2):
+        for a in range(256):
+            for n in range(256):
+                res = (a - n - c) & 0xFFFF
+                h = (a ^ n ^ res) & 0x10
+                t.append((res & 0xFF) | (((res >> 8) & 1) << C_BIT) | ((h >> 4) << H_BIT))
+    return t
+
+
+def incdec_table(delta):
+    t = []
+    for r in range(256):
+        res = (r + delta) & 0xFF
+        h = (r ^ 1 ^ res) & 0x10
+        t.append(res | ((h >> 4) << H_BIT))
+    return t
+
+
+def daa_table():
+    """Same rules as the computed DAA in cpu.c."""
+    t = []
+    for n in range(2):
+        for h in range(2):
+            for c in range(2):
+                for a in range(256):
+                    correction = 0
+                    carry = c
+                    if h or (not n and (a & 0x0F) > 9):
+                        correction |= 0x06
+                    if c or (not n and a > 0x99):
+                        correction |= 0x60
+                        carry = 1
+                    res = (a - correction if n else a + correction) & 0xFF
+                    t.append(res | (carry << C_BIT))
+    return t
+
+
+def emit_array(lines, name, table, comment):
+    lines.append("/* %s (%d entries, %d bytes) */" % (comment, len(table), len(table) * 2))
+    lines.append("static const u16 %s[%d] = {" % (name, len(table)))
+    for i in range(0, len(table), 16):
+        lines.append("    " + ",".join("0x%04X" % v for v in table[i:i + 16]) + ",")
+    lines.append("};")
+    lines.append("")
+
+
+def main():
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    out = sys.argv[1] if len(sys.argv) > 1 else os.path.join(root, "wasm", "core-gb", "alu_tables.h")
+
+    tables = [
+        ("gb_alu_add", add_table(), "ADD/ADC, index c << 16 | a << 8 | n"),
+        ("gb_alu_sub", sub_table(), "SUB/SBC/CP, index c << 16 | a << 8 | n"),
+        ("gb_alu_inc", incdec_table(1), "INC r, index r"),
+        ("gb_alu_dec", incdec_table(-1), "DEC r, index r"),
+        ("gb_alu_daa", daa_table(), "DAA, index n << 10 | h << 9 | c << 8 | a"),
+    ]
+    total = sum(len(t) * 2 for _, t, _ in tables)
+
+    lines = [
+        "/**",
+        " * NeoBoy - LR35902 ALU Tables",
+        " *",
+        " * GENERATED by scripts/gen-alu-tables.py - do not edit by hand.",
+        " *",
+        " * Result byte in bits 0-7, C in bit %d, H in bit %d (so that" % (C_BIT, H_BIT),
+        " * (entry >> 8) & 0x10 is the lazy H and (entry >> 8) & 1 is C).",
+        " */",
+        "",
+        "#ifndef GB_ALU_TABLES_H",
+        "#define GB_ALU_TABLES_H",
+        "",
+        "#include \"../common/common.h\"",
+        "",
+        "#define GB_ALU_TABLE_BYTES %d" % total,
+        "",
+    ]
+    for name, table, comment in tables:
+        emit_array(lines, name, table, comment)
+    lines.append("#endif /* GB_ALU_TABLES_H */")
+
+    with open(out, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+    for name, table, _ in tables:
+        print("%-12s %7d entries %8d bytes" % (name, len(table), len(table) * 2))
+    print("%-12s %24d bytes" % ("total", total))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+"""
+NeoBoy - LR35902 Opcode Table Generator
+
+Emits wasm/core-gb/cpu_tables.h: the 256-entry main opcode table and the
+256-entry CB-prefixed table as X-macro lists of (opcode, handler, cycles).
+
+Cycle counts are the base (not-taken) cost of each instruction. Handlers in
+cpu.c return any extra cycles (taken branches), so the dispatcher computes
+`cycles = base + handler()` without per-opcode bookkeeping.
+
+A third list gives each main opcode's length and block-translation flags,
+and a fourth the superinstructions read from scripts/cpu-fusion.txt.
+
+Usage: python3 scripts/gen-cpu-tables.py [output]
+"""
+
+import os
+import sys
+
+R8 = ["b", "c", "d", "e", "h", "l", "mhl", "a"]
+R16 = ["bc", "de", "hl", "sp"]
+R16_STACK = ["bc", "de", "hl", "af"]
+COND = ["nz", "z", "nc", "c"]
+ALU = ["add", "adc", "sub", "sbc", "and", "xor", "or", "cp"]
+CB_SHIFT = ["rlc", "rrc", "rl", "rr", "sla", "sra", "swap", "srl"]
+ILLEGAL = [0xD3, 0xDB, 0xDD, 0xE3, 0xE4, 0xEB, 0xEC, 0xED, 0xF4, 0xFC, 0xFD]
+
+
+def main_table():
+    t = {}
+
+    def op(code, name, cycles):
+        assert code not in t, hex(code)
+        t[code] = (name, cycles)
+
+    op(0x00, "nop", 4)
+    op(0x08, "ld_ma16_sp", 20)
+    op(0x10, "stop", 4)
+    op(0x18, "jr_r8", 12)
+
+    for i, rr in enumerate(R16):
+        op(0x01 + i * 0x10, "ld_%s_d16" % rr, 12)
+        op(0x03 + i * 0x10, "inc_%s" % rr, 8)
+        op(0x09 + i * 0x10, "add_hl_%s" % rr, 8)
+        op(0x0B + i * 0x10, "dec_%s" % rr, 8)
+
+    for i, m in enumerate(["mbc", "mde", "mhli", "mhld"]):
+        op(0x02 + i * 0x10, "ld_%s_a" % m, 8)
+        op(0x0A + i * 0x10, "ld_a_%s" % m, 8)
+
+    for i, r in enumerate(R8):
+        slow = r == "mhl"
+        op(0x04 + i * 8, "inc_%s" % r, 12 if slow else 4)
+        op(0x05 + i * 8, "dec_%s" % r, 12 if slow else 4)
+        op(0x06 + i * 8, "ld_%s_d8" % r, 12 if slow else 8)
+
+    for i, name in enumerate(["rlca", "rrca", "rla", "rra", "daa", "cpl", "scf", "ccf"]):
+        op(0x07 + i * 8, name, 4)
+
+    for i, cc in enumerate(COND):
+        op(0x20 + i * 8, "jr_%s_r8" % cc, 8)
+        op(0xC0 + i * 8, "ret_%s" % cc, 8)
+        op(0xC2 + i * 8, "jp_%s_a16" % cc, 12)
+        op(0xC4 + i * 8, "call_%s_a16" % cc, 12)
+
+    for d, dst in enumerate(R8):
+        for s, src in enumerate(R8):
+            code = 0x40 + d * 8 + s
+            if code == 0x76:
+                op(code, "halt", 4)
+                continue
+            op(code, "ld_%s_%s" % (dst, src), 8 if "mhl" in (dst, src) else 4)
+
+    for a, alu in enumerate(ALU):
+        for s, src in enumerate(R8):
+            op(0x80 + a * 8 + s, "%s_%s" % (alu, src), 8 if src == "mhl" else 4)
+        op(0xC6 + a * 8, "%s_d8" % alu, 8)
+
+    for i, rr in enumerate(R16_STACK):
+        op(0xC1 + i * 0x10, "pop_%s" % rr, 12)
+        op(0xC5 + i * 0x10, "push_%s" % rr, 16)
+
+    for i in range(8):
+        op(0xC7 + i * 8, "rst_%02x" % (i * 8), 16)
+
+    op(0xC3, "jp_a16", 16)
+    op(0xC9, "ret", 16)
+    op(0xCB, "prefix_cb", 4)
+    op(0xCD, "call_a16", 24)
+    op(0xD9, "reti", 16)
+    op(0xE0, "ldh_ma8_a", 12)
+    op(0xE2, "ld_mc_a", 8)
+    op(0xE8, "add_sp_r8", 16)
+    op(0xE9, "jp_hl", 4)
+    op(0xEA, "ld_ma16_a", 16)
+    op(0xF0, "ldh_a_ma8", 12)
+    op(0xF2, "ld_a_mc", 8)
+    op(0xF3, "di", 4)
+    op(0xF8, "ld_hl_sp_r8", 12)
+    op(0xF9, "ld_sp_hl", 8)
+    op(0xFA, "ld_a_ma16", 16)
+    op(0xFB, "ei", 4)
+
+    for code in ILLEGAL:
+        op(code, "illegal", 4)
+
+    assert len(t) == 256, len(t)
+    return t
+
+
+def cb_table():
+    t = {}
+    for code in range(256):
+        r = R8[code & 7]
+        slow = r == "mhl"
+        group = code >> 6
+        bit = (code >> 3) & 7
+        if group == 0:
+            t[code] = ("%s_%s" % (CB_SHIFT[bit], r), 12 if slow else 4)
+        elif group == 1:
+            t[code] = ("bit%d_%s" % (bit, r), 8 if slow else 4)
+        elif group == 2:
+            t[code] = ("res%d_%s" % (bit, r), 12 if slow else 4)
+        else:
+            t[code] = ("set%d_%s" % (bit, r), 12 if slow else 4)
+    return t
+
+
+MEMORY_OPERANDS = {"mhl", "mbc", "mde", "mhli", "mhld", "ma16", "ma8", "mc"}
+
+
+def decode_info(name):
+    """Length in bytes and GB_CPU_OP_* flags of a main-table handler."""
+    parts = name.split("_")
+    if "d16" in parts or "a16" in parts or "ma16" in parts:
+        length = 3
+    elif {"d8", "r8", "ma8"} & set(parts) or name in ("prefix_cb", "stop"):
+        length = 2
+    else:
+        length = 1
+
+    flags = []
+    if MEMORY_OPERANDS & set(parts) or parts[0] in ("push", "pop"):
+        flags.append("GB_CPU_OP_MEM")
+    if parts[0] in ("jp", "jr", "call", "ret", "reti", "rst") or name in ("halt", "stop", "ei"):
+        flags.append("GB_CPU_OP_END")
+    return length, " | ".join(flags) or "0"
+
+
+MAX_FUSED = 16
+
+
+def read_fusion(path, table):
+    """Opcode pairs from the fusion data file (see its header)."""
+    pairs = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split("#")[0].split()
+            if not fields:
+                continue
+            first, second = int(fields[0], 16), int(fields[1], 16)
+            where = "%s:%d" % (path, number)
+            assert "GB_CPU_OP_END" not in decode_info(table[first][0])[1], where + ": first op ends a block"
+            assert 0xCB not in (first, second), where + ": CB-prefixed ops cannot be fused"
+            assert (first, second) not in pairs, where + ": duplicate pair"
+            pairs.append((first, second))
+    return pairs[:MAX_FUSED]
+
+
+def emit_fusion(lines, table, pairs):
+    lines.append("/* Superinstructions (scripts/cpu-fusion.txt), ids from 1:")
+    lines.append(" * X(id, op1, handler1, cycles1, op2, handler2, cycles2) */")
+    lines.append("#define GB_CPU_FUSION_TABLE(X) \\")
+    for i, (first, second) in enumerate(pairs):
+        cont = " \\" if i < len(pairs) - 1 else ""
+        lines.append("    X(%d, 0x%02X, %s, %d, 0x%02X, %s, %d)%s" % (
+            i + 1, first, table[first][0], table[first][1], second, table[second][0], table[second][1], cont))
+    lines.append("")
+
+
+def emit_table(lines, macro, table, comment):
+    lines.append("/* %s */" % comment)
+    lines.append("#define %s(X) \\" % macro)
+    for code in range(256):
+        name, cycles = table[code]
+        cont = " \\" if code < 255 else ""
+        lines.append("    X(0x%02X, %-12s %2d)%s" % (code, name + ",", cycles, cont))
+    lines.append("")
+
+
+def emit_decode(lines, table):
+    lines.append("/* Decode info for the block translator (block.c): X(opcode, length, flags).")
+    lines.append(" * Memory access of a CB-prefixed opcode depends on its second byte. */")
+    lines.append("#define GB_CPU_OP_MEM 0x01 /* Accesses memory beyond its own operand bytes */")
+    lines.append("#define GB_CPU_OP_END 0x02 /* Ends a block: jumps, calls, returns, HALT, STOP, EI */")
+    lines.append("")
+    lines.append("#define GB_CPU_OPCODE_DECODE(X) \\")
+    for code in range(256):
+        length, flags = decode_info(table[code][0])
+        cont = " \\" if code < 255 else ""
+        lines.append("    X(0x%02X, %d, %s)%s" % (code, length, flags, cont))
+    lines.append("")
+
+
+def main():
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    out = sys.argv[1] if len(sys.argv) > 1 else os.path.join(root, "wasm", "core-gb", "cpu_tables.h")
+
+    lines = [
+        "/**",
+        " * NeoBoy - LR35902 Opcode Tables",
+        " *",
+        " * GENERATED by scripts/gen-cpu-tables.py - do not edit by hand.",
+        " *",
+        " * Each entry is X(opcode, handler, cycles). `cycles` is the base cost of",
+        " * the instruction; conditional handlers return the extra cycles taken",
+        " * when the branch is followed. CB cycles exclude the 4-cycle prefix.",
+        " */",
+        "",
+        "#ifndef GB_CPU_TABLES_H",
+        "#define GB_CPU_TABLES_H",
+        "",
+    ]
+    emit_table(lines, "GB_CPU_OPCODE_TABLE", main_table(), "Main opcode table (0x00-0xFF)")
+    emit_table(lines, "GB_CPU_CB_TABLE", cb_table(), "CB-prefixed opcode table (0xCB 0x00-0xFF)")
+    emit_decode(lines, main_table())
+    emit_fusion(lines, main_table(), read_fusion(os.path.join(root, "scripts", "cpu-fusion.txt"), main_table()))
+    lines.append("#endif /* GB_CPU_TABLES_H */")
+
+    with open(out, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
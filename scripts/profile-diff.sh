@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# NeoBoy Profile Comparison
+# Runs a ROM through the ACCURATE and FAST native builds of the GB core and
+# reports the first frame whose framebuffer differs between them.
+#
+# Usage: scripts/profile-diff.sh <rom.gb> [frames]
+# (normally via: make profile-diff ROM=<rom.gb> [FRAMES=n])
+
+set -e
+
+ROM="$1"
+FRAMES="${2:-600}"
+BIN_DIR="build/native"
+
+if [ -z "$ROM" ]; then
+    echo "Usage: $0 <rom.gb> [frames]"
+    exit 1
+fi
+
+for profile in accurate fast; do
+    if [ ! -x "$BIN_DIR/gb-framehash-$profile" ]; then
+        echo "Error: $BIN_DIR/gb-framehash-$profile not found (run 'make framehash')."
+        exit 1
+    fi
+    "$BIN_DIR/gb-framehash-$profile" "$ROM" "$FRAMES" > "$BIN_DIR/framehash-$profile.txt" 2> /dev/null
+done
+
+# Both files have one "<frame> <hash>" line per frame
+awk '
+    NR == FNR { accurate[$1] = $2; next }
+    $2 != accurate[$1] {
+        if (!diverged) first = $1
+        diverged++
+    }
+    END {
+        if (diverged) {
+            printf "Profiles diverge at frame %d (%d of %d frames differ)\n", first, diverged, FNR
+            exit 1
+        }
+        printf "Profiles match on all %d frames\n", FNR
+    }
+' "$BIN_DIR/framehash-accurate.txt" "$BIN_DIR/framehash-fast.txt"
@@ -0,0 +1,217 @@
+/**
+ * NeoBoy - Native Game Boy Core Benchmark
+ *
+ * Runs the GB core natively (host compiler, no WASM) for a fixed number of
+ * frames and reports emulation speed. On Linux the host instructions retired
+ * are read through perf_event_open(2) and reported per emulated instruction,
+ * which is the number to watch when changing the CPU hot path.
+ *
+ * Instruction fetches that miss the MMU fetch window are counted too; run
+ * once more with --no-fetch-window (every fetch through the page tables) to
+ * see what the window saves on a given ROM. --blocks runs the basic-block
+ * translation cache instead of the interpreter and reports its hit rate.
+ * --deferred draws each frame in one pass at VBlank instead of line by line.
+ * Built with -DGB_ALU_TABLES=1 (make alu-bench) it also reports the size
+ * of the ALU tables.
+ *
+ * Afterwards each scanline compositor variant the host can run (compose.h)
+ * is timed on its own over line buffers with a mix of BG and sprite pixels,
+ * in ns per scanline.
+ *
+ * Build: make bench
+ * Usage: build/native/gb-bench [--no-fetch-window] [--blocks] [--deferred] <rom.gb> [frames]
+ */
+
+#include "core.h"
+#include "block.h"
+#include "compose.h"
+#include "cpu.h"
+#include "mmu.h"
+#include "profile.h"
+#if GB_ALU_TABLES
+#include "alu_tables.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define DEFAULT_FRAMES 3600 /* One minute of emulated time */
+#define COMPOSE_LINES  (GB_SCREEN_HEIGHT * 2000)
+
+/* Host instruction counter; returns -1 when unavailable */
+static int counter_open(void) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void counter_start(int fd) {
+#ifdef __linux__
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+static long long counter_stop(int fd) {
+#ifdef __linux__
+    long long count = -1;
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+    }
+    return count;
+#else
+    (void)fd;
+    return -1;
+#endif
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_compositors(void) {
+    u8 bg[GB_SCREEN_WIDTH], obj[GB_SCREEN_WIDTH];
+    u32 lut[GB_COMPOSE_LUT_SIZE];
+    static u8 frame[GB_FRAMEBUFFER_SIZE];
+
+    /* Sprites over a fifth of the line, as in a busy game scene */
+    u32 seed = 1;
+    for (u32 x = 0; x < GB_SCREEN_WIDTH; x++) {
+        seed = seed * 1103515245 + 12345;
+        bg[x] = (seed >> 16) & 0x83;
+        obj[x] = (seed >> 24) % 5 ? 0 : (((seed >> 20) & 1) ? GB_COMPOSE_OBP1 : GB_COMPOSE_OBP0) | (1 + (seed >> 8) % 3);
+    }
+    for (u32 i = 0; i < GB_COMPOSE_LUT_SIZE; i++) {
+        lut[i] = 0xFF000000u | (i * 0x10203u);
+    }
+
+    const gb_compose_variant_t *variants;
+    u32 count = gb_compose_variants(&variants);
+    for (u32 v = 0; v < count; v++) {
+        double start = now_seconds();
+        for (u32 line = 0; line < COMPOSE_LINES; line++) {
+            variants[v].fn(frame + (line % GB_SCREEN_HEIGHT) * GB_SCREEN_WIDTH * 4, bg, obj, lut);
+        }
+        double elapsed = now_seconds() - start;
+        fprintf(stderr, "compose %-8s    %.1f ns/scanline%s\n", variants[v].name, elapsed / COMPOSE_LINES * 1e9,
+                variants[v].fn == gb_compose_line ? " (in use)" : "");
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *prog = argv[0];
+    bool blocks = false;
+    bool deferred = false;
+    while (argc > 1 && strncmp(argv[1], "--", 2) == 0) {
+        if (strcmp(argv[1], "--no-fetch-window") == 0) {
+            gb_mmu_fetch_window = false;
+        } else if (strcmp(argv[1], "--blocks") == 0) {
+            blocks = true;
+        } else if (strcmp(argv[1], "--deferred") == 0) {
+            deferred = true;
+        } else {
+            break;
+        }
+        argc--;
+        argv++;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s [--no-fetch-window] [--blocks] [--deferred] <rom.gb> [frames]\n", prog);
+        return 1;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : DEFAULT_FRAMES;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        fprintf(stderr, "gb-bench: cannot open %s\n", argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *rom = malloc(size);
+    if (!rom || fread(rom, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "gb-bench: cannot read %s\n", argv[1]);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    gb_init();
+    if (gb_load_rom(rom, (uint32_t)size) != 0) {
+        fprintf(stderr, "gb-bench: ROM load failed\n");
+        return 1;
+    }
+
+    gb_set_block_cache(blocks);
+    gb_set_deferred_render(deferred);
+
+    int fd = counter_open();
+    gb_cpu_instructions = 0;
+    gb_mmu_fetch_misses = 0;
+    double start = now_seconds();
+    counter_start(fd);
+
+    for (int i = 0; i < frames; i++) {
+        gb_step_frame();
+    }
+
+    long long host_instructions = counter_stop(fd);
+    double elapsed = now_seconds() - start;
+
+    double emulated = frames / 59.7275;
+    fprintf(stderr, "frames:             %d\n", frames);
+    fprintf(stderr, "wall time:          %.3f s\n", elapsed);
+    fprintf(stderr, "speed:              %.1f fps (%.1fx realtime)\n", frames / elapsed, emulated / elapsed);
+    fprintf(stderr, "guest instructions: %llu (%.1f M/s)\n",
+            (unsigned long long)gb_cpu_instructions, gb_cpu_instructions / elapsed / 1e6);
+    fprintf(stderr, "fetch misses:       %llu (%.3f per guest instruction, window %s)\n",
+            (unsigned long long)gb_mmu_fetch_misses,
+            gb_cpu_instructions ? (double)gb_mmu_fetch_misses / gb_cpu_instructions : 0.0,
+            gb_mmu_fetch_window ? "on" : "off");
+    if (blocks) {
+        u32 lookups = gb_get_block_cache_hits() + gb_get_block_cache_misses();
+        fprintf(stderr, "block cache:        %.2f%% hits, %u translations, %u page invalidations, %u KB\n",
+                lookups ? 100.0 * gb_get_block_cache_hits() / lookups : 0.0, gb_get_block_cache_misses(),
+                gb_block_cache.invalidations, gb_get_block_cache_bytes() / 1024);
+    }
+#if GB_ALU_TABLES
+    fprintf(stderr, "ALU tables:         %u KB\n", GB_ALU_TABLE_BYTES / 1024);
+#endif
+    if (host_instructions >= 0 && gb_cpu_instructions > 0) {
+        fprintf(stderr, "host instructions:  %lld (%.1f per guest instruction)\n",
+                host_instructions, (double)host_instructions / gb_cpu_instructions);
+    } else {
+        fprintf(stderr, "host instructions:  n/a (perf counters unavailable)\n");
+    }
+    bench_compositors();
+
+    gb_destroy();
+    free(rom);
+    return 0;
+}
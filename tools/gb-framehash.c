@@ -0,0 +1,81 @@
+/**
+ * NeoBoy - Per-Frame Framebuffer Hashes
+ *
+ * Runs the GB core natively and prints one line per frame, `<frame> <hash>`,
+ * with a 64-bit FNV-1a hash of the RGBA framebuffer. The Makefile builds it
+ * once per core profile (gb-framehash-accurate, gb-framehash-fast) so the
+ * two outputs can be compared line by line; scripts/profile-diff.sh does
+ * that and reports the first frame where the profiles disagree.
+ *
+ * --deferred renders each frame in one pass at VBlank (gb_set_deferred_render),
+ * which must not change a single hash.
+ *
+ * Build: make framehash
+ * Usage: build/native/gb-framehash-<profile> [--deferred] <rom.gb> [frames]
+ */
+
+#include "core.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_FRAMES 600 /* Ten seconds of emulated time */
+
+static uint64_t fnv1a(const uint8_t *data, size_t len) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+int main(int argc, char **argv) {
+    const char *prog = argv[0];
+    bool deferred = false;
+    if (argc > 1 && strcmp(argv[1], "--deferred") == 0) {
+        deferred = true;
+        argc--;
+        argv++;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s [--deferred] <rom.gb> [frames]\n", prog);
+        return 1;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : DEFAULT_FRAMES;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        fprintf(stderr, "gb-framehash: cannot open %s\n", argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *rom = malloc(size);
+    if (!rom || fread(rom, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "gb-framehash: cannot read %s\n", argv[1]);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    gb_init();
+    if (gb_load_rom(rom, (uint32_t)size) != 0) {
+        fprintf(stderr, "gb-framehash: ROM load failed\n");
+        return 1;
+    }
+    gb_set_deferred_render(deferred);
+
+    fprintf(stderr, "gb-framehash: %s profile, %d frames%s\n", GB_PROFILE_NAME, frames,
+            deferred ? ", deferred rendering" : "");
+    for (int i = 0; i < frames; i++) {
+        gb_step_frame();
+        printf("%d %016llx\n", i, (unsigned long long)fnv1a(gb_get_framebuffer(), GB_FRAMEBUFFER_SIZE));
+    }
+
+    gb_destroy();
+    free(rom);
+    return 0;
+}
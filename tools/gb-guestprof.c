@@ -0,0 +1,75 @@
+/**
+ * NeoBoy - Guest Code Profile
+ *
+ * Runs a ROM with the guest code profiler (wasm/core-gb/prof.h) started
+ * from the first frame and prints the profile: folded call stacks by
+ * default, ready for a flame graph,
+ *
+ *   build/native/gb-guestprof game.gb | flamegraph.pl > game.svg
+ *
+ * or with --hot the cycles per bank:address, most expensive first.
+ *
+ * Build: make guestprof
+ * Usage: build/native/gb-guestprof [--hot] [--frames n] <rom.gb>
+ */
+
+#include "core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_FRAMES 600 /* Ten seconds of emulated time */
+
+int main(int argc, char **argv) {
+    uint32_t format = GB_GUEST_PROFILE_FOLDED;
+    int frames = DEFAULT_FRAMES;
+    int arg = 1;
+    for (; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--hot") == 0) {
+            format = GB_GUEST_PROFILE_HOTSPOTS;
+        } else if (arg + 1 < argc && strcmp(argv[arg], "--frames") == 0) {
+            frames = atoi(argv[++arg]);
+        } else {
+            break;
+        }
+    }
+    if (arg >= argc) {
+        fprintf(stderr, "usage: %s [--hot] [--frames n] <rom.gb>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *f = fopen(argv[arg], "rb");
+    if (!f) {
+        fprintf(stderr, "gb-guestprof: cannot open %s\n", argv[arg]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *rom = malloc(size);
+    if (!rom || fread(rom, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "gb-guestprof: cannot read %s\n", argv[arg]);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    gb_init();
+    if (gb_load_rom(rom, (uint32_t)size) != 0) {
+        fprintf(stderr, "gb-guestprof: ROM load failed\n");
+        return 1;
+    }
+
+    gb_set_guest_profiler(true);
+    for (int i = 0; i < frames; i++) {
+        gb_step_frame();
+    }
+    gb_set_guest_profiler(false);
+
+    const char *profile = gb_get_guest_profile(format);
+    fwrite(profile, 1, gb_get_guest_profile_size(), stdout);
+
+    gb_destroy();
+    free(rom);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * NeoBoy - Headless Block JIT Check
+ *
+ * Loads the web build of the GB core in Node and runs a ROM twice, each in
+ * a fresh module instance: once with the block cache alone and once with
+ * hot blocks compiled to WebAssembly (wasm/core-gb/jit.js). Every frame's
+ * framebuffer is hashed; the first frame where the two runs differ is
+ * reported along with both run times.
+ *
+ * Build: make gb
+ * Usage: node tools/gb-jit-check.mjs <rom.gb> [frames]
+ */
+
+import { readFileSync } from 'node:fs';
+import { performance } from 'node:perf_hooks';
+import NeoBoyGB from '../frontend/src/wasm/generated/gb.js';
+
+const GB_FRAMEBUFFER_SIZE = 160 * 144 * 4;
+const DEFAULT_FRAMES = 600;
+
+function fnv1a(bytes) {
+    let hash = 0x811C9DC5;
+    for (let i = 0; i < bytes.length; i++) {
+        hash ^= bytes[i];
+        hash = Math.imul(hash, 0x01000193);
+    }
+    return hash >>> 0;
+}
+
+async function run(rom, frames, jit) {
+    const gb = await NeoBoyGB({ print: () => {}, printErr: () => {} });
+    gb._gb_init();
+
+    const ptr = gb._malloc(rom.length);
+    gb.HEAPU8.set(rom, ptr);
+    if (gb._gb_load_rom(ptr, rom.length) !== 0) {
+        throw new Error('ROM load failed');
+    }
+    gb._free(ptr);
+
+    gb._gb_set_block_cache(1);
+    gb._gb_set_jit(jit ? 1 : 0);
+
+    const hashes = new Uint32Array(frames);
+    const start = performance.now();
+    for (let i = 0; i < frames; i++) {
+        gb._gb_step_frame();
+        const fb = gb._gb_get_framebuffer();
+        hashes[i] = fnv1a(gb.HEAPU8.subarray(fb, fb + GB_FRAMEBUFFER_SIZE));
+    }
+    const ms = performance.now() - start;
+
+    const jitBlocks = gb._gb_get_jit_blocks();
+    gb._gb_destroy();
+    return { hashes, ms, jitBlocks };
+}
+
+const [romPath, framesArg] = process.argv.slice(2);
+if (!romPath) {
+    console.error('usage: node tools/gb-jit-check.mjs <rom.gb> [frames]');
+    process.exit(1);
+}
+const frames = framesArg ? parseInt(framesArg, 10) : DEFAULT_FRAMES;
+const rom = new Uint8Array(readFileSync(romPath));
+
+const blocks = await run(rom, frames, false);
+const jit = await run(rom, frames, true);
+
+console.log(`blocks: ${blocks.ms.toFixed(1)} ms`);
+console.log(`jit:    ${jit.ms.toFixed(1)} ms (${jit.jitBlocks} blocks compiled, ${(blocks.ms / jit.ms).toFixed(2)}x)`);
+
+const diverged = blocks.hashes.findIndex((hash, i) => hash !== jit.hashes[i]);
+if (diverged >= 0) {
+    console.log(`JIT diverges from the block cache at frame ${diverged}`);
+    process.exit(1);
+}
+console.log(`JIT matches the block cache on all ${frames} frames`);
@@ -0,0 +1,118 @@
+/**
+ * NeoBoy - Instruction Pair Counter
+ *
+ * Runs each ROM through the GB core interpreter (block cache off) and counts
+ * how often every opcode directly follows another. The most frequent pairs
+ * that can be fused are printed in the format of scripts/cpu-fusion.txt,
+ * so a corpus can re-tune the superinstruction set:
+ *
+ *   build/native/gb-pairs [--frames n] <rom.gb>... > scripts/cpu-fusion.txt
+ *   make tables
+ *
+ * Build: make pairs
+ */
+
+#include "core.h"
+#include "cpu.h"
+#include "cpu_tables.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_FRAMES 3600 /* One minute of emulated time per ROM */
+#define MAX_PAIRS 16        /* Pairs the table generator reads */
+
+static const char *const op_names[256] = {
+#define OP_NAME(op, name, cyc) [op] = #name,
+    GB_CPU_OPCODE_TABLE(OP_NAME)
+#undef OP_NAME
+};
+
+static const u8 op_flags[256] = {
+#define OP_FLAGS(op, len, flags) [op] = flags,
+    GB_CPU_OPCODE_DECODE(OP_FLAGS)
+#undef OP_FLAGS
+};
+
+static bool run_rom(const char *path, int frames) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "gb-pairs: cannot open %s\n", path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *rom = malloc(size);
+    bool ok = rom && fread(rom, 1, size, f) == (size_t)size;
+    fclose(f);
+
+    gb_init();
+    if (ok && gb_load_rom(rom, (uint32_t)size) == 0) {
+        for (int i = 0; i < frames; i++) {
+            gb_step_frame();
+        }
+    } else {
+        fprintf(stderr, "gb-pairs: cannot load %s\n", path);
+        ok = false;
+    }
+    gb_destroy();
+    free(rom);
+    return ok;
+}
+
+/* Pairs the translator can fuse: the first op may not end a block and
+ * CB-prefixed ops have no handler of their own */
+static bool fusible(u32 pair) {
+    u8 first = pair >> 8, second = pair & 0xFF;
+    return !(op_flags[first] & GB_CPU_OP_END) && first != 0xCB && second != 0xCB;
+}
+
+int main(int argc, char **argv) {
+    int frames = DEFAULT_FRAMES;
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "--frames") == 0) {
+        frames = atoi(argv[arg + 1]);
+        arg += 2;
+    }
+    if (arg >= argc) {
+        fprintf(stderr, "usage: %s [--frames n] <rom.gb>...\n", argv[0]);
+        return 1;
+    }
+
+    int roms = 0;
+    for (; arg < argc; arg++) {
+        roms += run_rom(argv[arg], frames);
+    }
+
+    /* Top pairs by count: repeated selection, each winner is cleared */
+    u32 top[MAX_PAIRS], executions[MAX_PAIRS];
+    int count = 0;
+    for (; count < MAX_PAIRS; count++) {
+        u32 best = 0;
+        for (u32 pair = 1; pair < 0x10000; pair++) {
+            if (gb_cpu_pairs[pair] > gb_cpu_pairs[best] && fusible(pair)) {
+                best = pair;
+            }
+        }
+        if (!gb_cpu_pairs[best] || !fusible(best)) {
+            break;
+        }
+        top[count] = best;
+        executions[count] = gb_cpu_pairs[best];
+        gb_cpu_pairs[best] = 0;
+    }
+
+    printf("# NeoBoy - LR35902 Superinstructions\n");
+    printf("#\n");
+    printf("# <first opcode> <second opcode> [executions], most frequent first.\n");
+    printf("# Generated by gb-pairs from %d ROM(s), %d frames each; see the\n", roms, frames);
+    printf("# header of tools/gb-pairs.c. Run `make tables` after changing this file.\n");
+    for (int i = 0; i < count; i++) {
+        u32 pair = top[i];
+        printf("%02X %02X %10u    # %s ; %s\n", pair >> 8, pair & 0xFF, executions[i],
+                op_names[pair >> 8], op_names[pair & 0xFF]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,294 @@
+/**
+ * NeoBoy - Instruction Trace Diff
+ *
+ * Walks two instruction traces in lockstep and reports the first
+ * instruction where they disagree, with the ones leading up to it. Each
+ * input is either a gb-trace file or a text log in the format most
+ * reference emulators can write (Gameboy Doctor):
+ *
+ *   A:01 F:B0 B:00 C:13 D:00 E:D8 H:01 L:4D SP:FFFE PC:0100 PCMEM:00,C3,13,02
+ *
+ * PC may carry a bank ("PC:01:4A20"), and PCMEM and a decimal cycle stamp
+ * ("CY:1234") are optional: only fields both sides have are compared.
+ * Emulators rarely count cycles from the same origin, so --no-cycles
+ * leaves the stamps out of the comparison.
+ *
+ * Build: make trace
+ * Usage: build/native/gb-trace-diff [--no-cycles] [--context n] <a> <b>
+ */
+
+#include "core.h"
+#include "trace.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHUNK_RECORDS   8192
+#define DEFAULT_CONTEXT 8
+#define MAX_CONTEXT     256
+
+/* Fields a record may lack (text logs) */
+#define HAS_CYCLE  0x01
+#define HAS_BANK   0x02
+#define HAS_OPCODE 0x04
+#define HAS_ALL    (HAS_CYCLE | HAS_BANK | HAS_OPCODE)
+
+typedef struct {
+    const char *path;
+    FILE *f;
+    bool text;
+    u64 line;                 /* Text: line of the last record */
+    u32 count, pos;           /* Binary: records buffered, next one */
+    GameBoyTraceRecord chunk[CHUNK_RECORDS];
+} trace_reader_t;
+
+typedef struct {
+    GameBoyTraceRecord r;
+    u8 has;
+} trace_entry_t;
+
+static trace_reader_t reader_a, reader_b;
+static trace_entry_t history_a[MAX_CONTEXT], history_b[MAX_CONTEXT];
+
+static bool reader_open(trace_reader_t *t, const char *path) {
+    t->path = path;
+    t->f = fopen(path, "rb");
+    if (!t->f) {
+        fprintf(stderr, "gb-trace-diff: cannot open %s\n", path);
+        return false;
+    }
+    char magic[GB_TRACE_MAGIC_LEN];
+    if (fread(magic, 1, sizeof(magic), t->f) == sizeof(magic) &&
+        memcmp(magic, GB_TRACE_MAGIC, GB_TRACE_MAGIC_LEN) == 0) {
+        return true;
+    }
+    t->text = true;
+    rewind(t->f);
+    return true;
+}
+
+static const char *parse_hex(const char *s, u32 *value) {
+    u32 v = 0;
+    while (isxdigit((unsigned char)*s)) {
+        v = v << 4 | (u32)(isdigit((unsigned char)*s) ? *s - '0' : (toupper((unsigned char)*s) - 'A' + 10));
+        s++;
+    }
+    *value = v;
+    return s;
+}
+
+/* One text log line; false if it holds no instruction (blank, comment) */
+static bool parse_line(const char *s, GameBoyTraceRecord *r, u8 *has) {
+    static const char regs[] = "AFBCDEHL";
+    u8 *reg_fields[] = { &r->a, &r->f, &r->b, &r->c, &r->d, &r->e, &r->h, &r->l };
+    bool pc = false;
+
+    memset(r, 0, sizeof(*r));
+    *has = 0;
+    while (*s) {
+        while (*s == ' ' || *s == '\t' || *s == ',') {
+            s++;
+        }
+        char key[8];
+        u32 len = 0;
+        while (isalpha((unsigned char)*s) && len < sizeof(key) - 1) {
+            key[len++] = (char)toupper((unsigned char)*s++);
+        }
+        key[len] = '\0';
+        if (*s != ':') {
+            while (*s && *s != ' ' && *s != '\t') {
+                s++;
+            }
+            continue;
+        }
+        s++;
+
+        u32 value;
+        if (strcmp(key, "PC") == 0) {
+            s = parse_hex(s, &value);
+            if (*s == ':') {
+                r->bank = (u16)value;
+                *has |= HAS_BANK;
+                s = parse_hex(s + 1, &value);
+            }
+            r->pc = (u16)value;
+            pc = true;
+        } else if (strcmp(key, "SP") == 0) {
+            s = parse_hex(s, &value);
+            r->sp = (u16)value;
+        } else if (strcmp(key, "PCMEM") == 0) {
+            s = parse_hex(s, &value);
+            r->opcode = (u8)value;
+            *has |= HAS_OPCODE;
+            while (*s && *s != ' ' && *s != '\t') {
+                s++;
+            }
+        } else if (strcmp(key, "CY") == 0) {
+            r->cycle = strtoull(s, (char **)&s, 10);
+            *has |= HAS_CYCLE;
+        } else if (len == 1 && strchr(regs, key[0])) {
+            s = parse_hex(s, &value);
+            *reg_fields[strchr(regs, key[0]) - regs] = (u8)value;
+        } else {
+            while (*s && *s != ' ' && *s != '\t') {
+                s++;
+            }
+        }
+    }
+    return pc;
+}
+
+static bool reader_next(trace_reader_t *t, GameBoyTraceRecord *r, u8 *has) {
+    if (!t->text) {
+        if (t->pos == t->count) {
+            t->count = (u32)fread(t->chunk, sizeof(GameBoyTraceRecord), CHUNK_RECORDS, t->f);
+            t->pos = 0;
+            if (!t->count) {
+                return false;
+            }
+        }
+        *r = t->chunk[t->pos++];
+        *has = HAS_ALL;
+        return true;
+    }
+
+    char line[512];
+    while (fgets(line, sizeof(line), t->f)) {
+        t->line++;
+        if (parse_line(line, r, has)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Bit per field, in print order */
+static const char *const field_names[] = { "cycle", "bank", "pc", "opcode", "a", "f", "b", "c", "d", "e", "h", "l", "sp" };
+
+static u32 compare(const GameBoyTraceRecord *x, const GameBoyTraceRecord *y, u8 has) {
+    u32 diff = 0;
+    if ((has & HAS_CYCLE) && x->cycle != y->cycle) diff |= 1 << 0;
+    if ((has & HAS_BANK) && x->bank != y->bank) diff |= 1 << 1;
+    if (x->pc != y->pc) diff |= 1 << 2;
+    if ((has & HAS_OPCODE) && x->opcode != y->opcode) diff |= 1 << 3;
+    if (x->a != y->a) diff |= 1 << 4;
+    if (x->f != y->f) diff |= 1 << 5;
+    if (x->b != y->b) diff |= 1 << 6;
+    if (x->c != y->c) diff |= 1 << 7;
+    if (x->d != y->d) diff |= 1 << 8;
+    if (x->e != y->e) diff |= 1 << 9;
+    if (x->h != y->h) diff |= 1 << 10;
+    if (x->l != y->l) diff |= 1 << 11;
+    if (x->sp != y->sp) diff |= 1 << 12;
+    return diff;
+}
+
+static void print_record(const char *side, u64 index, const trace_entry_t *e) {
+    const GameBoyTraceRecord *r = &e->r;
+    printf("%s #%-10llu ", side, (unsigned long long)index);
+    if (e->has & HAS_CYCLE) {
+        printf("CY:%-12llu ", (unsigned long long)r->cycle);
+    } else {
+        printf("CY:%-12s ", "-");
+    }
+    printf("A:%02X F:%02X B:%02X C:%02X D:%02X E:%02X H:%02X L:%02X SP:%04X PC:",
+           r->a, r->f, r->b, r->c, r->d, r->e, r->h, r->l, r->sp);
+    if (e->has & HAS_BANK) {
+        printf("%02X:", r->bank);
+    }
+    printf("%04X", r->pc);
+    if (e->has & HAS_OPCODE) {
+        printf(" OP:%02X", r->opcode);
+    }
+    printf("\n");
+}
+
+static void location(const trace_reader_t *t, char *out, size_t size) {
+    if (t->text) {
+        snprintf(out, size, "%s:%llu", t->path, (unsigned long long)t->line);
+    } else {
+        snprintf(out, size, "%s", t->path);
+    }
+}
+
+int main(int argc, char **argv) {
+    u8 ignore = 0;
+    u32 context = DEFAULT_CONTEXT;
+    int arg = 1;
+    for (; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--no-cycles") == 0) {
+            ignore |= HAS_CYCLE;
+        } else if (arg + 1 < argc && strcmp(argv[arg], "--context") == 0) {
+            context = (u32)atoi(argv[++arg]);
+            context = MIN(context, MAX_CONTEXT);
+        } else {
+            break;
+        }
+    }
+    if (arg + 2 != argc) {
+        fprintf(stderr, "usage: %s [--no-cycles] [--context n] <a> <b>\n", argv[0]);
+        return 2;
+    }
+    if (!reader_open(&reader_a, argv[arg]) || !reader_open(&reader_b, argv[arg + 1])) {
+        return 2;
+    }
+
+    clock_t start = clock();
+    u64 index = 0;
+    int status = 0;
+    for (;;) {
+        trace_entry_t a, b;
+        bool more_a = reader_next(&reader_a, &a.r, &a.has);
+        bool more_b = reader_next(&reader_b, &b.r, &b.has);
+        if (!more_a || !more_b) {
+            if (more_a != more_b) {
+                printf("%s ends after %llu instructions, the other trace continues\n",
+                       more_a ? reader_b.path : reader_a.path, (unsigned long long)index);
+                status = 1;
+            }
+            break;
+        }
+
+        u32 diff = compare(&a.r, &b.r, a.has & b.has & ~ignore);
+        if (diff) {
+            u64 first = index > context ? index - context : 0;
+            for (u64 i = first; i < index; i++) {
+                const trace_entry_t *ha = &history_a[i % MAX_CONTEXT], *hb = &history_b[i % MAX_CONTEXT];
+                print_record("  ", i, ha);
+                if (compare(&ha->r, &hb->r, ha->has & hb->has)) {
+                    print_record("  ", i, hb); /* Differs only in ignored fields */
+                }
+            }
+            print_record("a ", index, &a);
+            print_record("b ", index, &b);
+
+            char where_a[600], where_b[600];
+            location(&reader_a, where_a, sizeof(where_a));
+            location(&reader_b, where_b, sizeof(where_b));
+            printf("traces diverge at instruction %llu (%s, %s):", (unsigned long long)index, where_a, where_b);
+            for (u32 i = 0; i < sizeof(field_names) / sizeof(field_names[0]); i++) {
+                if (diff & (1u << i)) {
+                    printf(" %s", field_names[i]);
+                }
+            }
+            printf("\n");
+            status = 1;
+            break;
+        }
+        history_a[index % MAX_CONTEXT] = a;
+        history_b[index % MAX_CONTEXT] = b;
+        index++;
+    }
+
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    fprintf(stderr, "gb-trace-diff: %llu instructions compared in %.2f s (%.1f M/s)\n",
+            (unsigned long long)index, seconds, seconds > 0 ? index / seconds / 1e6 : 0.0);
+    if (!status) {
+        printf("traces match over %llu instructions\n", (unsigned long long)index);
+    }
+    fclose(reader_a.f);
+    fclose(reader_b.f);
+    return status;
+}
@@ -0,0 +1,88 @@
+/**
+ * NeoBoy - Instruction Trace Recorder
+ *
+ * Runs a ROM with the trace ring on (wasm/core-gb/trace.h) and streams
+ * every executed instruction to a binary trace file: GB_TRACE_MAGIC and
+ * then one 24-byte GameBoyTraceRecord per instruction. The ring is drained
+ * once per frame, so it only has to hold one frame of instructions.
+ * Compare two traces, or a trace and a reference emulator's log, with
+ * gb-trace-diff.
+ *
+ * Build: make trace
+ * Usage: build/native/gb-trace [--frames n] <rom.gb> <out.trace>
+ */
+
+#include "core.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_FRAMES 600   /* Ten seconds of emulated time */
+#define RING_RECORDS   65536 /* A frame is at most ~35000 instructions (double speed) */
+
+int main(int argc, char **argv) {
+    int frames = DEFAULT_FRAMES;
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "--frames") == 0) {
+        frames = atoi(argv[arg + 1]);
+        arg += 2;
+    }
+    if (arg + 2 != argc) {
+        fprintf(stderr, "usage: %s [--frames n] <rom.gb> <out.trace>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *f = fopen(argv[arg], "rb");
+    if (!f) {
+        fprintf(stderr, "gb-trace: cannot open %s\n", argv[arg]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *rom = malloc(size);
+    if (!rom || fread(rom, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "gb-trace: cannot read %s\n", argv[arg]);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    FILE *out = fopen(argv[arg + 1], "wb");
+    if (!out) {
+        fprintf(stderr, "gb-trace: cannot create %s\n", argv[arg + 1]);
+        return 1;
+    }
+    fwrite(GB_TRACE_MAGIC, 1, GB_TRACE_MAGIC_LEN, out);
+
+    GameBoyTraceRecord *records = malloc(RING_RECORDS * sizeof(GameBoyTraceRecord));
+    gb_init();
+    if (!records || gb_load_rom(rom, (uint32_t)size) != 0 || gb_set_trace(RING_RECORDS) != 0) {
+        fprintf(stderr, "gb-trace: cannot start %s\n", argv[arg]);
+        return 1;
+    }
+
+    uint64_t total = 0;
+    uint32_t drained = gb_get_trace_count();
+    for (int i = 0; i < frames; i++) {
+        gb_step_frame();
+        uint32_t count = gb_get_trace_count();
+        uint32_t fresh = count - drained;
+        if (fresh > RING_RECORDS) {
+            fprintf(stderr, "gb-trace: frame %d overran the ring, %u records lost\n", i, fresh - RING_RECORDS);
+            fresh = RING_RECORDS;
+        }
+        uint32_t n = gb_get_trace(records, fresh);
+        fwrite(records, sizeof(GameBoyTraceRecord), n, out);
+        total += n;
+        drained = count;
+    }
+
+    fclose(out);
+    fprintf(stderr, "gb-trace: %llu instructions in %d frames\n", (unsigned long long)total, frames);
+    gb_destroy();
+    free(records);
+    free(rom);
+    return 0;
+}
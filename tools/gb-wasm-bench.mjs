@@ -0,0 +1,49 @@
+/**
+ * NeoBoy - Headless WASM Benchmark
+ *
+ * Loads a built GB core module (frontend/src/wasm/generated/gb*.js) in Node,
+ * runs a ROM for a fixed number of frames and prints the speed in the same
+ * "speed:" format as the native gb-bench, so scripts can compare the two.
+ *
+ * Build: make gb (and/or gb-fast, gb-alu)
+ * Usage: node tools/gb-wasm-bench.mjs <module.js> <rom.gb> [frames]
+ */
+
+import { readFileSync } from 'node:fs';
+import { resolve } from 'node:path';
+import { pathToFileURL } from 'node:url';
+import { performance } from 'node:perf_hooks';
+
+const DEFAULT_FRAMES = 3600; /* One minute of emulated time */
+
+const [modulePath, romPath, framesArg] = process.argv.slice(2);
+if (!modulePath || !romPath) {
+    console.error('usage: node tools/gb-wasm-bench.mjs <module.js> <rom.gb> [frames]');
+    process.exit(1);
+}
+const frames = framesArg ? parseInt(framesArg, 10) : DEFAULT_FRAMES;
+
+const factory = (await import(pathToFileURL(resolve(modulePath)).href)).default;
+const gb = await factory({ print: () => {}, printErr: () => {} });
+gb._gb_init();
+
+const rom = new Uint8Array(readFileSync(romPath));
+const ptr = gb._malloc(rom.length);
+gb.HEAPU8.set(rom, ptr);
+if (gb._gb_load_rom(ptr, rom.length) !== 0) {
+    console.error('gb-wasm-bench: ROM load failed');
+    process.exit(1);
+}
+gb._free(ptr);
+
+const start = performance.now();
+for (let i = 0; i < frames; i++) {
+    gb._gb_step_frame();
+}
+const seconds = (performance.now() - start) / 1000;
+
+const emulated = frames / 59.7275;
+console.log(`frames:             ${frames}`);
+console.log(`wall time:          ${seconds.toFixed(3)} s`);
+console.log(`speed:              ${(frames / seconds).toFixed(1)} fps (${(emulated / seconds).toFixed(1)}x realtime)`);
+gb._gb_destroy();
@@ -0,0 +1,107 @@
+/**
+ * NeoBoy - Structured Logging Implementation
+ *
+ * Purpose: The in-memory log ring and its text drain
+ */
+
+#include "log.h"
+
+#if NEOBOY_LOG_LEVEL > 0
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+static log_record_t ring[LOG_RING_SLOTS];
+static _Atomic u32 head;     /* Next slot the core writes */
+static _Atomic u32 tail;     /* Next slot the host reads */
+static _Atomic u32 dropped;  /* Records lost to a full ring */
+
+static const char level_names[] = "?EWID";
+static const char *const category_names[LOG_CATEGORY_COUNT] = {
+    "core", "cart", "cpu", "mmu", "serial", "ppu", "apu", "dma"
+};
+
+void neoboy_log_write(u8 level, u8 category, const char *fmt, ...) {
+    u32 h = atomic_load_explicit(&head, memory_order_relaxed);
+    if (h - atomic_load_explicit(&tail, memory_order_acquire) >= LOG_RING_SLOTS) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    log_record_t *r = &ring[h & (LOG_RING_SLOTS - 1)];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(r->text, LOG_TEXT_MAX + 1, fmt, args);
+    va_end(args);
+    r->level = level;
+    r->category = category;
+    r->length = (u16)(len < 0 ? 0 : MIN(len, LOG_TEXT_MAX));
+
+    atomic_store_explicit(&head, h + 1, memory_order_release);
+}
+
+bool neoboy_log_read(log_record_t *out) {
+    u32 t = atomic_load_explicit(&tail, memory_order_relaxed);
+    if (t == atomic_load_explicit(&head, memory_order_acquire)) {
+        return false;
+    }
+    *out = ring[t & (LOG_RING_SLOTS - 1)];
+    atomic_store_explicit(&tail, t + 1, memory_order_release);
+    return true;
+}
+
+u32 neoboy_log_drain(char *buffer, u32 size) {
+    u32 used = 0;
+    char line[LOG_TEXT_MAX + 32];
+
+    u32 lost = atomic_load_explicit(&dropped, memory_order_relaxed);
+    if (lost) {
+        int len = snprintf(line, sizeof(line), "W core: %u log records dropped\n", lost);
+        if ((u32)len > size) {
+            return 0;
+        }
+        memcpy(buffer, line, (size_t)len);
+        used = (u32)len;
+        atomic_fetch_sub_explicit(&dropped, lost, memory_order_relaxed);
+    }
+
+    u32 t = atomic_load_explicit(&tail, memory_order_relaxed);
+    u32 h = atomic_load_explicit(&head, memory_order_acquire);
+    for (; t != h; t++) {
+        const log_record_t *r = &ring[t & (LOG_RING_SLOTS - 1)];
+        int len = snprintf(line, sizeof(line), "%c %s: %.*s\n",
+                           level_names[r->level < sizeof(level_names) - 1 ? r->level : 0],
+                           r->category < LOG_CATEGORY_COUNT ? category_names[r->category] : "?",
+                           (int)r->length, r->text);
+        if (used + (u32)len > size) {
+            break; /* Stays in the ring for the next drain */
+        }
+        memcpy(buffer + used, line, (size_t)len);
+        used += (u32)len;
+    }
+    atomic_store_explicit(&tail, t, memory_order_release);
+    return used;
+}
+
+#else
+
+void neoboy_log_write(u8 level, u8 category, const char *fmt, ...) {
+    (void)level;
+    (void)category;
+    (void)fmt;
+}
+
+bool neoboy_log_read(log_record_t *out) {
+    (void)out;
+    return false;
+}
+
+u32 neoboy_log_drain(char *buffer, u32 size) {
+    (void)buffer;
+    (void)size;
+    return 0;
+}
+
+#endif
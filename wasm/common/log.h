@@ -0,0 +1,103 @@
+/**
+ * NeoBoy - Structured Logging
+ *
+ * Purpose: Levelled, categorised core logging that costs nothing in release
+ *
+ * Cores log through the LOG_ERROR/LOG_WARN/LOG_INFO/LOG_DEBUG macros. Which
+ * levels exist is fixed at compile time by NEOBOY_LOG_LEVEL (0 = none, the
+ * default, up to LOG_LEVEL_DEBUG); a call above it expands to nothing and
+ * its arguments are never evaluated.
+ *
+ * Records are formatted into a fixed ring in memory instead of stdout, so
+ * a WASM core never calls out to JS to log. The ring is single-producer,
+ * single-consumer and lock-free: the core appends, the host drains with
+ * neoboy_log_drain() whenever it likes (typically once per frame). When
+ * the host falls behind, new records are dropped and counted rather than
+ * overwriting ones it has not read yet.
+ */
+
+#ifndef NEOBOY_LOG_H
+#define NEOBOY_LOG_H
+
+#include "common.h"
+
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef NEOBOY_LOG_LEVEL
+#define NEOBOY_LOG_LEVEL 0
+#endif
+
+/* True if LOG_* calls of `level` are compiled in */
+#define LOG_ENABLED(level) (NEOBOY_LOG_LEVEL >= (level))
+
+typedef enum {
+    LOG_CORE,     /* Init, ROM loading, frame status */
+    LOG_CART,     /* Cartridge header, MBC, save RAM */
+    LOG_CPU,
+    LOG_MMU,
+    LOG_SERIAL,   /* Text the game sends over the link port */
+    LOG_PPU,
+    LOG_APU,
+    LOG_DMA,
+    LOG_CATEGORY_COUNT
+} log_category_t;
+
+#define LOG_RING_SLOTS 256  /* Power of two */
+#define LOG_TEXT_MAX   120  /* Longer messages are truncated */
+
+typedef struct {
+    u8 level;
+    u8 category;
+    u16 length;              /* Bytes in text, without the terminator */
+    char text[LOG_TEXT_MAX + 4];
+} log_record_t;
+
+/**
+ * Format a record into the ring (use the LOG_* macros)
+ */
+void neoboy_log_write(u8 level, u8 category, const char *fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+/**
+ * Take the oldest record off the ring; false if it is empty
+ */
+bool neoboy_log_read(log_record_t *out);
+
+/**
+ * Move as many whole records as fit into `buffer` as text lines
+ * ("W cart: message\n"), preceded by a note of any dropped records.
+ * Returns the bytes written; the buffer is not NUL-terminated.
+ */
+u32 neoboy_log_drain(char *buffer, u32 size);
+
+#if LOG_ENABLED(LOG_LEVEL_ERROR)
+#define LOG_ERROR(cat, ...) neoboy_log_write(LOG_LEVEL_ERROR, cat, __VA_ARGS__)
+#else
+#define LOG_ERROR(cat, ...) ((void)0)
+#endif
+
+#if LOG_ENABLED(LOG_LEVEL_WARN)
+#define LOG_WARN(cat, ...) neoboy_log_write(LOG_LEVEL_WARN, cat, __VA_ARGS__)
+#else
+#define LOG_WARN(cat, ...) ((void)0)
+#endif
+
+#if LOG_ENABLED(LOG_LEVEL_INFO)
+#define LOG_INFO(cat, ...) neoboy_log_write(LOG_LEVEL_INFO, cat, __VA_ARGS__)
+#else
+#define LOG_INFO(cat, ...) ((void)0)
+#endif
+
+#if LOG_ENABLED(LOG_LEVEL_DEBUG)
+#define LOG_DEBUG(cat, ...) neoboy_log_write(LOG_LEVEL_DEBUG, cat, __VA_ARGS__)
+#else
+#define LOG_DEBUG(cat, ...) ((void)0)
+#endif
+
+#endif /* NEOBOY_LOG_H */
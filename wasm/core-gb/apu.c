@@ -1,5 +1,7 @@
 #include "core.h"
 #include "apu.h"
+#include "mmu.h"
+#include "scheduler.h"
 #include <string.h>
 
 static const u8 pulse_duty_patterns[4][8] = {
@@ -81,80 +83,103 @@ static void step_frame_sequencer(gb_apu_t *apu) {
     }
 }
 
-void gb_apu_step(gb_apu_t *apu, uint32_t cycles) {
-    if (!(apu->nr52 & 0x80)) return; /* APU disabled */
+#define APU_FRAME_SEQ_CYCLES 8192 /* 4.194304 MHz / 512 Hz */
+
+/* APU cycles are converted to scheduler (CPU) cycles: in double speed the
+ * CPU clock runs twice as fast as the APU */
+static void schedule_event(gb_mmu_t *mmu, gb_event_t event, u64 base, u32 apu_cycles) {
+    gb_sched_schedule(mmu->sched, event, base + ((u64)apu_cycles << mmu->speed));
+}
+
+static u32 cycles_per_sample(gb_apu_t *apu) {
+    return 4194304 / apu->sample_rate;
+}
 
-    /* Frame Sequencer (512Hz) */
-    apu->sequencer_timer += cycles;
-    if (apu->sequencer_timer >= 8192) { /* 4.194304 MHz / 512 Hz = 8192 */
-        apu->sequencer_timer -= 8192;
+void gb_apu_start(gb_apu_t *apu, void *mmu_ptr) {
+    gb_mmu_t *mmu = (gb_mmu_t *)mmu_ptr;
+    u64 now = mmu->sched->now;
+    
+    schedule_event(mmu, GB_EVENT_APU_FRAME_SEQ, now, APU_FRAME_SEQ_CYCLES);
+    schedule_event(mmu, GB_EVENT_APU_SAMPLE, now, cycles_per_sample(apu));
+}
+
+void gb_apu_frame_sequencer_event(gb_apu_t *apu, void *mmu_ptr, u64 when) {
+    if (apu->nr52 & 0x80) { /* Frozen while the APU is disabled */
         step_frame_sequencer(apu);
     }
+    schedule_event((gb_mmu_t *)mmu_ptr, GB_EVENT_APU_FRAME_SEQ, when, APU_FRAME_SEQ_CYCLES);
+}
 
-    /* Channel 4: Noise Oscillator */
-    if (apu->ch4.enabled) {
-        if (apu->ch4.timer <= cycles) {
-            static const u8 divisors[] = {8, 16, 32, 48, 64, 80, 96, 112};
-            apu->ch4.timer = divisors[apu->ch4.dividing_ratio] << apu->ch4.shift_clock_freq;
-            
-            u8 result = (apu->ch4.lfsr & 1) ^ ((apu->ch4.lfsr >> 1) & 1);
-            apu->ch4.lfsr = (apu->ch4.lfsr >> 1) | (result << 14);
-            if (apu->ch4.counter_step) {
-                apu->ch4.lfsr = (apu->ch4.lfsr & ~0x40) | (result << 6);
-            }
-        } else {
-            apu->ch4.timer -= cycles;
+/* Channel 4: Noise Oscillator, clocked over `cycles` */
+static void clock_noise(gb_apu_t *apu, u32 cycles) {
+    static const u8 divisors[] = {8, 16, 32, 48, 64, 80, 96, 112};
+    
+    /* Shifts 14 and 15 stop the LFSR */
+    if (apu->ch4.shift_clock_freq >= 14) return;
+    u32 period = (u32)divisors[apu->ch4.dividing_ratio] << apu->ch4.shift_clock_freq;
+    
+    while (apu->ch4.timer <= cycles) {
+        cycles -= apu->ch4.timer;
+        apu->ch4.timer = period;
+        
+        u8 result = (apu->ch4.lfsr & 1) ^ ((apu->ch4.lfsr >> 1) & 1);
+        apu->ch4.lfsr = (apu->ch4.lfsr >> 1) | (result << 14);
+        if (apu->ch4.counter_step) {
+            apu->ch4.lfsr = (apu->ch4.lfsr & ~0x40) | (result << 6);
         }
     }
+    apu->ch4.timer -= cycles;
+}
 
+void gb_apu_sample_event(gb_apu_t *apu, void *mmu_ptr, u64 when) {
+    u32 period = cycles_per_sample(apu);
+    schedule_event((gb_mmu_t *)mmu_ptr, GB_EVENT_APU_SAMPLE, when, period);
+    
+    if (!(apu->nr52 & 0x80)) return; /* APU disabled */
+    
+    if (apu->ch4.enabled) {
+        clock_noise(apu, period);
+    }
+    
     /* Mixing and Sample Generation (Simplified) */
-    static u32 sample_accumulation = 0;
-    sample_accumulation += cycles;
+    float ch1_sample = 0, ch2_sample = 0, ch3_sample = 0, ch4_sample = 0;
     
-    u32 cycles_per_sample = 4194304 / apu->sample_rate;
+    if (apu->ch1.enabled) {
+        ch1_sample = pulse_duty_patterns[apu->ch1.duty][apu->ch1.duty_step] ? 1.0f : -1.0f;
+        ch1_sample *= (float)apu->ch1.env_volume / 15.0f;
+    }
     
-    if (sample_accumulation >= cycles_per_sample) {
-        sample_accumulation -= cycles_per_sample;
-        
-        float ch1_sample = 0, ch2_sample = 0, ch3_sample = 0, ch4_sample = 0;
-        
-        if (apu->ch1.enabled) {
-            ch1_sample = pulse_duty_patterns[apu->ch1.duty][apu->ch1.duty_step] ? 1.0f : -1.0f;
-            ch1_sample *= (float)apu->ch1.env_volume / 15.0f;
-        }
-        
-        if (apu->ch2.enabled) {
-            ch2_sample = pulse_duty_patterns[apu->ch2.duty][apu->ch2.duty_step] ? 1.0f : -1.0f;
-            ch2_sample *= (float)apu->ch2.env_volume / 15.0f;
-        }
-        
-        if (apu->ch3.enabled) {
-            u8 sample_idx = apu->ch3.sample_index % 32;
-            u8 sample = apu->wave_ram[sample_idx / 2];
-            if (sample_idx % 2 == 0) sample >>= 4;
-            else sample &= 0x0F;
-            
-            if (apu->ch3.volume_shift > 0) sample >>= (apu->ch3.volume_shift - 1);
-            else sample = 0;
-            
-            ch3_sample = ((float)sample / 7.5f) - 1.0f;
-        }
-        
-        if (apu->ch4.enabled) {
-            ch4_sample = (apu->ch4.lfsr & 1) ? -1.0f : 1.0f;
-            ch4_sample *= (float)apu->ch4.env_volume / 15.0f;
-        }
+    if (apu->ch2.enabled) {
+        ch2_sample = pulse_duty_patterns[apu->ch2.duty][apu->ch2.duty_step] ? 1.0f : -1.0f;
+        ch2_sample *= (float)apu->ch2.env_volume / 15.0f;
+    }
+    
+    if (apu->ch3.enabled) {
+        u8 sample_idx = apu->ch3.sample_index % 32;
+        u8 sample = apu->wave_ram[sample_idx / 2];
+        if (sample_idx % 2 == 0) sample >>= 4;
+        else sample &= 0x0F;
         
-        float mixed = (ch1_sample + ch2_sample + ch3_sample + ch4_sample) * 0.25f;
+        if (apu->ch3.volume_shift > 0) sample >>= (apu->ch3.volume_shift - 1);
+        else sample = 0;
         
-        /* Store in circular buffer */
-        if (apu->buffer_pos < 4096) {
-            apu->buffer[apu->buffer_pos] = mixed;
-            apu->buffer_pos = (apu->buffer_pos + 1) % 4096;
-        } else {
-            apu->buffer_pos = 0;
-            apu->buffer[0] = mixed;
-        }
+        ch3_sample = ((float)sample / 7.5f) - 1.0f;
+    }
+    
+    if (apu->ch4.enabled) {
+        ch4_sample = (apu->ch4.lfsr & 1) ? -1.0f : 1.0f;
+        ch4_sample *= (float)apu->ch4.env_volume / 15.0f;
+    }
+    
+    float mixed = (ch1_sample + ch2_sample + ch3_sample + ch4_sample) * 0.25f;
+    
+    /* Store in circular buffer */
+    if (apu->buffer_pos < 4096) {
+        apu->buffer[apu->buffer_pos] = mixed;
+        apu->buffer_pos = (apu->buffer_pos + 1) % 4096;
+    } else {
+        apu->buffer_pos = 0;
+        apu->buffer[0] = mixed;
     }
 }
 
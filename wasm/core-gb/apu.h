@@ -62,7 +62,7 @@ typedef struct {
 
 typedef struct {
     bool enabled;
-    u16 timer;
+    u32 timer;     /* Up to 112 << 13 cycles */
     u16 lfsr;
     
     /* Envelope */
@@ -96,8 +96,7 @@ typedef struct gb_apu_t {
     
     u8 wave_ram[16];
     
-    /* Frame Sequencer */
-    u32 sequencer_timer;
+    /* Frame Sequencer (ticked by GB_EVENT_APU_FRAME_SEQ) */
     u8 sequencer_step;
     
     /* Audio Output */
@@ -108,7 +107,22 @@ typedef struct gb_apu_t {
 
 void gb_apu_init(gb_apu_t *apu);
 void gb_apu_reset(gb_apu_t *apu);
-void gb_apu_step(gb_apu_t *apu, u32 cycles);
+
+/**
+ * Schedule the frame sequencer and sample events after reset
+ */
+void gb_apu_start(gb_apu_t *apu, void *mmu);
+
+/**
+ * GB_EVENT_APU_FRAME_SEQ handler: 512 Hz length/sweep/envelope tick
+ */
+void gb_apu_frame_sequencer_event(gb_apu_t *apu, void *mmu, u64 when);
+
+/**
+ * GB_EVENT_APU_SAMPLE handler: mix one output sample into the buffer
+ */
+void gb_apu_sample_event(gb_apu_t *apu, void *mmu, u64 when);
+
 u8 gb_apu_read(gb_apu_t *apu, u16 addr);
 void gb_apu_write(gb_apu_t *apu, u16 addr, u8 value);
 
@@ -0,0 +1,232 @@
+/**
+ * NeoBoy - Game Boy Basic-Block Translation Cache Implementation
+ *
+ * Purpose: Block decoding, RAM-page invalidation and the JIT hand-off
+ */
+
+#include "block.h"
+#include "cpu_tables.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Invalidations after which a page is no longer translated */
+#define GB_BLOCK_MAX_STRIKES 8
+
+gb_block_cache_t gb_block_cache = { .jit = GB_JIT };
+
+/* Write pointers of the pages protected below, restored on invalidation */
+static u8 *saved_write_page[0x100];
+
+static const u8 op_length[256] = {
+#define OP_LENGTH(op, len, flags) [op] = len,
+    GB_CPU_OPCODE_DECODE(OP_LENGTH)
+#undef OP_LENGTH
+};
+
+static const u8 op_flags[256] = {
+#define OP_FLAGS(op, len, flags) [op] = flags,
+    GB_CPU_OPCODE_DECODE(OP_FLAGS)
+#undef OP_FLAGS
+};
+
+/* Superinstruction id of each fused pair, by its first opcode */
+static const struct { u8 first, second, id; } fused_pairs[] = {
+#define FUSED_PAIR(id, op1, name1, cyc1, op2, name2, cyc2) { op1, op2, id },
+    GB_CPU_FUSION_TABLE(FUSED_PAIR)
+#undef FUSED_PAIR
+    { 0, 0, 0 }
+};
+
+static u8 fusion_id(u8 first, u8 second) {
+    for (u32 i = 0; fused_pairs[i].id; i++) {
+        if (fused_pairs[i].first == first && fused_pairs[i].second == second) {
+            return fused_pairs[i].id;
+        }
+    }
+    return 0;
+}
+
+static const u8 op_cycles[256] = {
+#define OP_CYCLES(op, name, cyc) [op] = cyc,
+    GB_CPU_OPCODE_TABLE(OP_CYCLES)
+#undef OP_CYCLES
+};
+
+static const u8 cb_cycles[256] = {
+#define CB_CYCLES(op, name, cyc) [op] = cyc,
+    GB_CPU_CB_TABLE(CB_CYCLES)
+#undef CB_CYCLES
+};
+
+#if GB_JIT
+/* Implemented in jit.js */
+extern u32 gb_jit_compile(const u8 *code, u32 count, const u8 *layout);
+extern void gb_jit_free(u32 fn);
+
+/* Where jit.js finds the registers in gb_cpu_t, in its local order */
+static const u8 jit_layout[] = {
+    offsetof(gb_cpu_t, b), offsetof(gb_cpu_t, c), offsetof(gb_cpu_t, d), offsetof(gb_cpu_t, e),
+    offsetof(gb_cpu_t, h), offsetof(gb_cpu_t, l), offsetof(gb_cpu_t, a),
+    offsetof(gb_cpu_t, flag_z), offsetof(gb_cpu_t, flag_n), offsetof(gb_cpu_t, flag_h), offsetof(gb_cpu_t, flag_c),
+    offsetof(gb_cpu_t, sp), offsetof(gb_cpu_t, ime), offsetof(gb_cpu_t, ei_delay),
+};
+
+void gb_block_compile(gb_block_t *block) {
+    u32 fn = gb_jit_compile(block->host, block->jit_ops, jit_layout);
+    if (fn) {
+        block->jit = (gb_jit_fn_t)(uintptr_t)fn;
+        gb_block_cache.jit_blocks++;
+    }
+}
+
+static void release_jit(gb_block_t *block) {
+    gb_jit_free((u32)(uintptr_t)block->jit);
+    block->jit = NULL;
+    gb_block_cache.jit_blocks--;
+}
+#endif
+
+/* The other mapping of a WRAM page (C000-DDFF is echoed at E000-FDFF), or -1 */
+static int echo_page(u8 page) {
+    if (page >= 0xC0 && page <= 0xDD) return page + 0x20;
+    if (page >= 0xE0 && page <= 0xFD) return page - 0x20;
+    return -1;
+}
+
+static void protect_page(gb_mmu_t *mmu, u8 page) {
+    if (gb_block_cache.code[page]) {
+        return;
+    }
+    gb_block_cache.code[page] = 1;
+    saved_write_page[page] = mmu->write_page[page];
+    mmu->write_page[page] = NULL; /* HRAM (page 0xFF) never had one */
+}
+
+static void unprotect_page(gb_mmu_t *mmu, u8 page) {
+    gb_block_cache.code[page] = 0;
+    mmu->write_page[page] = saved_write_page[page];
+    gb_block_cache.page_gen[page]++;
+    if (gb_block_cache.strikes[page] < GB_BLOCK_MAX_STRIKES) {
+        gb_block_cache.strikes[page]++;
+    }
+}
+
+void gb_block_flush(gb_mmu_t *mmu) {
+    for (u16 page = 0; page < 0x100; page++) {
+        if (gb_block_cache.code[page]) {
+            mmu->write_page[page] = saved_write_page[page];
+        }
+    }
+    memset(gb_block_cache.code, 0, sizeof(gb_block_cache.code));
+    memset(gb_block_cache.strikes, 0, sizeof(gb_block_cache.strikes));
+#if GB_JIT
+    for (u32 i = 0; i < GB_BLOCK_SLOTS; i++) {
+        if (gb_block_cache.slots[i].jit) {
+            release_jit(&gb_block_cache.slots[i]);
+        }
+    }
+#endif
+    memset(gb_block_cache.slots, 0, sizeof(gb_block_cache.slots));
+}
+
+void gb_block_invalidate(gb_mmu_t *mmu, u8 page) {
+    gb_block_cache.invalidations++;
+    unprotect_page(mmu, page);
+    int echo = echo_page(page);
+    if (echo >= 0 && gb_block_cache.code[echo]) {
+        unprotect_page(mmu, (u8)echo);
+    }
+}
+
+void gb_block_invalidate_range(gb_mmu_t *mmu, u8 first, u8 last) {
+    for (u16 page = first; page <= last; page++) {
+        if (gb_block_cache.code[page]) {
+            gb_block_invalidate(mmu, (u8)page);
+        }
+    }
+}
+
+gb_block_t *gb_block_translate(gb_mmu_t *mmu, u16 pc, const u8 *host, gb_block_t *slot) {
+    u8 page = pc >> 8;
+    bool ram = page >= 0x80;
+
+    gb_block_cache.misses++;
+#if GB_JIT
+    if (slot->jit) {
+        release_jit(slot);
+    }
+#endif
+    slot->host = host;
+    slot->base = mmu->read_page[page];
+    slot->pc = pc;
+    slot->page = page;
+    slot->gen = gb_block_cache.page_gen[page];
+    slot->count = 0;
+    slot->jit_ops = 0;
+    slot->jit_bytes = 0;
+    slot->jit_cycles = 0;
+    slot->heat = 0;
+
+    if (ram && gb_block_cache.strikes[page] >= GB_BLOCK_MAX_STRIKES) {
+        return NULL;
+    }
+
+    /* Instructions may not run past the page (or into IE at 0xFFFF) */
+    u16 avail = page == 0xFF ? 0xFFFF - pc : 0x100 - (pc & 0xFF);
+    u16 offset = 0;
+    bool leading = true; /* Still in the register-only run */
+    u8 cycles = 0;
+    while (slot->count < GB_BLOCK_MAX_OPS) {
+        u8 opcode = host[offset];
+        u8 length = op_length[opcode];
+        if (offset + length > avail) {
+            break;
+        }
+
+        gb_block_op_t *op = &slot->ops[slot->count++];
+        op->opcode = opcode;
+        op->length = length;
+        op->flags = op_flags[opcode];
+        op->fuse = 0;
+        if (slot->count > 1) {
+            op[-1].fuse = fusion_id(op[-1].opcode, opcode);
+        }
+        if (opcode == 0xCB && (host[offset + 1] & 0x07) == 0x06) {
+            op->flags |= GB_CPU_OP_MEM; /* (HL) operand */
+        }
+        cycles = op_cycles[opcode] + (opcode == 0xCB ? cb_cycles[host[offset + 1]] : 0);
+        offset += length;
+
+        if (op->flags & (GB_CPU_OP_MEM | GB_CPU_OP_END)) {
+            leading = false;
+        }
+        if (leading) {
+            slot->jit_ops++;
+            slot->jit_bytes += length;
+            slot->jit_cycles += cycles;
+        }
+        if (op->flags & GB_CPU_OP_END) {
+            break;
+        }
+    }
+
+    if (slot->count == 0) {
+        return NULL;
+    }
+    gb_block_op_t *last = &slot->ops[slot->count - 1];
+    if (leading) {
+        /* The run took in the last op, which executes as END */
+        slot->jit_ops--;
+        slot->jit_bytes -= last->length;
+        slot->jit_cycles -= cycles;
+    }
+    last->flags |= GB_CPU_OP_END; /* However the block ended */
+    if (ram) {
+        protect_page(mmu, page);
+        int echo = echo_page(page);
+        if (echo >= 0) {
+            protect_page(mmu, (u8)echo);
+        }
+    }
+    return slot;
+}
@@ -0,0 +1,152 @@
+/**
+ * NeoBoy - Game Boy Basic-Block Translation Cache Header
+ *
+ * Purpose: Pre-decoded straight-line LR35902 code for gb_cpu_run()
+ *
+ * A block is a run of instructions starting at some PC and ending at the
+ * first jump, call, return, HALT, STOP or EI (or the end of its 256-byte
+ * page). It is decoded once into an array of (opcode, length, flags)
+ * entries; executing it skips the per-instruction fetch, EI/HALT
+ * bookkeeping and, for instructions that only touch registers, the event
+ * and interrupt checks (see cpu_run_block() in cpu.c). Adjacent pairs listed
+ * in scripts/cpu-fusion.txt are marked at decode time and run as one
+ * superinstruction.
+ *
+ * Blocks are keyed by the host address of their first byte together with
+ * the guest PC, so each ROM bank has its own blocks and an MBC bank switch
+ * never needs a flush. Blocks in RAM (VRAM, cartridge RAM, WRAM, HRAM)
+ * write-protect their page: the page-table write pointer is cleared, the
+ * next write lands in gb_mmu_write_slow() and gb_block_invalidate() drops
+ * every block on the page. A page that keeps being invalidated is left to
+ * the interpreter until the next flush.
+ *
+ * In the web build a block whose leading register-only instructions keep
+ * being entered is also compiled to WebAssembly at runtime (jit.js): after
+ * GB_JIT_THRESHOLD entries that run becomes one call through the indirect
+ * function table. Instructions touching memory, and so I/O, are never
+ * compiled. Compiled code belongs to its block and is freed with it, so
+ * bank switches and writes to code pages need no further hooks.
+ */
+
+#ifndef GB_BLOCK_H
+#define GB_BLOCK_H
+
+#include "../common/common.h"
+#include "cpu.h"
+#include "mmu.h"
+
+#define GB_BLOCK_MAX_OPS 32
+#define GB_BLOCK_SLOTS   2048  /* Direct-mapped, power of two */
+
+/* WebAssembly can be generated and instantiated at runtime only in the web
+ * build; -DGB_NO_JIT leaves it out there too */
+#if defined(__EMSCRIPTEN__) && !defined(GB_NO_JIT)
+#define GB_JIT 1
+#else
+#define GB_JIT 0
+#endif
+
+#define GB_JIT_THRESHOLD 64  /* Block entries before its run is compiled */
+#define GB_JIT_MIN_OPS   3   /* Shorter runs do not pay for the call */
+
+/* Compiled run: updates the registers as the interpreted instructions would */
+typedef void (*gb_jit_fn_t)(gb_cpu_t *cpu);
+
+typedef struct {
+    u8 opcode;
+    u8 length;     /* Bytes, including the CB prefix and immediates */
+    u8 flags;      /* GB_CPU_OP_* (cpu_tables.h); the last op always has END */
+    u8 fuse;       /* GB_CPU_FUSION_TABLE id if this op and the next form a superinstruction */
+} gb_block_op_t;
+
+typedef struct {
+    const u8 *host;    /* Host address of the first opcode, NULL if the slot is empty */
+    const u8 *base;    /* read_page[page] when translated (NULL in HRAM) */
+    u16 pc;            /* Guest address of the first opcode */
+    u8 page;           /* Guest page the block lies in */
+    u8 count;          /* Instructions; 0 marks a PC the interpreter keeps */
+    u32 gen;           /* gb_block_cache.page_gen[page] when translated */
+    u8 jit_ops;        /* Leading instructions that neither touch memory nor end the block */
+    u8 jit_bytes;      /* Their length in bytes */
+    u16 jit_cycles;    /* Their cycles */
+    u32 heat;          /* Entries, counted up to GB_JIT_THRESHOLD */
+    gb_jit_fn_t jit;   /* Compiled leading run, NULL until hot */
+    gb_block_op_t ops[GB_BLOCK_MAX_OPS];
+} gb_block_t;
+
+typedef struct {
+    bool enabled;                  /* Off by default: gb_cpu_run() interprets */
+    u32 hits;                      /* Blocks entered from the cache */
+    u32 misses;                    /* Translations */
+    u32 invalidations;             /* Page invalidations by writes or remaps */
+    bool jit;                      /* Compile hot blocks (GB_JIT builds only) */
+    u32 jit_blocks;                /* Blocks currently compiled */
+    u8 code[0x100];                /* RAM pages holding blocks (write-protected) */
+    u8 strikes[0x100];             /* Invalidations per page since the last flush */
+    u32 page_gen[0x100];           /* Bumped on every invalidation of the page */
+    gb_block_t slots[GB_BLOCK_SLOTS];
+} gb_block_cache_t;
+
+extern gb_block_cache_t gb_block_cache;
+
+/**
+ * Drop every block and lift all write protection (reset, state load)
+ */
+void gb_block_flush(gb_mmu_t *mmu);
+
+/**
+ * Drop the blocks on a guest page and lift its write protection
+ */
+void gb_block_invalidate(gb_mmu_t *mmu, u8 page);
+
+/**
+ * Invalidate pages [first, last] that hold blocks (after a bank switch
+ * rebuilt their page-table entries)
+ */
+void gb_block_invalidate_range(gb_mmu_t *mmu, u8 first, u8 last);
+
+/**
+ * Decode the block at `pc` into `slot`
+ * Returns the block, or NULL if `pc` is left to the interpreter
+ */
+gb_block_t *gb_block_translate(gb_mmu_t *mmu, u16 pc, const u8 *host, gb_block_t *slot);
+
+#if GB_JIT
+/**
+ * Compile the leading register-only run of a hot block (block->jit stays
+ * NULL if it cannot be compiled)
+ */
+void gb_block_compile(gb_block_t *block);
+#endif
+
+/* Host address of the code at `pc`, NULL where no block can start */
+static inline const u8 *gb_block_host(const gb_mmu_t *mmu, u16 pc) {
+    const u8 *page = mmu->read_page[pc >> 8];
+    if (page) {
+        return page + (pc & 0xFF);
+    }
+    if (pc >= 0xFF80 && pc < 0xFFFF) {
+        return mmu->hram + (pc - 0xFF80);
+    }
+    return NULL;
+}
+
+/* Block starting at `pc`, translated on a miss; NULL to interpret */
+static inline gb_block_t *gb_block_lookup(gb_mmu_t *mmu, u16 pc) {
+    const u8 *host = gb_block_host(mmu, pc);
+    if (!host) {
+        return NULL;
+    }
+    uintptr_t key = (uintptr_t)host;
+    gb_block_t *slot = &gb_block_cache.slots[(key ^ (key >> 11)) & (GB_BLOCK_SLOTS - 1)];
+    if (slot->host != host || slot->pc != pc || slot->gen != gb_block_cache.page_gen[slot->page]) {
+        return gb_block_translate(mmu, pc, host, slot);
+    }
+    if (!slot->count) {
+        return NULL;
+    }
+    gb_block_cache.hits++;
+    return slot;
+}
+
+#endif /* GB_BLOCK_H */
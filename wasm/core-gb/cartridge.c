@@ -4,9 +4,9 @@
 
 #include "core.h"
 #include "cartridge.h"
+#include "../common/log.h"
 #include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
 
 /**
  * Detect MBC type from cartridge header
@@ -42,27 +42,27 @@ void gb_cart_init(gb_cartridge_t *cart) {
 
 int gb_cart_load(gb_cartridge_t *cart, const u8 *data, u32 size) {
     if (!cart || !data || size < 0x150) {
-        printf("[NeoBoy] [ERROR] Invalid cartridge load: cart=%p, data=%p, size=%u\n", cart, data, size);
+        LOG_ERROR(LOG_CART, "Invalid cartridge load: cart=%p, data=%p, size=%u", (void *)cart, (const void *)data, size);
         return -1;
     }
     
     // Free previous ROM/RAM
     if (cart->rom) {
-        printf("[NeoBoy] Freeing old ROM...\n");
+        LOG_DEBUG(LOG_CART, "Freeing old ROM");
         free(cart->rom);
         cart->rom = NULL;
     }
     if (cart->ram) {
-        printf("[NeoBoy] Freeing old RAM...\n");
+        LOG_DEBUG(LOG_CART, "Freeing old RAM");
         free(cart->ram);
         cart->ram = NULL;
     }
     
     // Allocate ROM
-    printf("[NeoBoy] Allocating %u bytes for ROM...\n", size);
+    LOG_DEBUG(LOG_CART, "Allocating %u bytes for ROM", size);
     cart->rom = (u8*)malloc(size);
     if (!cart->rom) {
-        printf("[NeoBoy] [ERROR] Failed to allocate ROM buffer!\n");
+        LOG_ERROR(LOG_CART, "Failed to allocate ROM buffer");
         return -1;
     }
     
@@ -72,7 +72,7 @@ int gb_cart_load(gb_cartridge_t *cart, const u8 *data, u32 size) {
     // Parse header
     u8 cart_type = data[0x147];
     cart->mbc_type = detect_mbc_type(cart_type);
-    printf("[NeoBoy] Cartridge Type: 0x%02X, MBC: %d\n", cart_type, cart->mbc_type);
+    LOG_INFO(LOG_CART, "Cartridge type 0x%02X, MBC %d", cart_type, cart->mbc_type);
     
     // Parse RAM size
     u8 ram_size_code = data[0x149];
@@ -86,10 +86,10 @@ int gb_cart_load(gb_cartridge_t *cart, const u8 *data, u32 size) {
     }
     
     if (cart->ram_size > 0) {
-        printf("[NeoBoy] Allocating %u bytes for RAM...\n", cart->ram_size);
+        LOG_DEBUG(LOG_CART, "Allocating %u bytes for RAM", cart->ram_size);
         cart->ram = (u8*)calloc(cart->ram_size, 1);
         if (!cart->ram) {
-            printf("[NeoBoy] [WARNING] Failed to allocate RAM, but continuing...\n");
+            LOG_WARN(LOG_CART, "Failed to allocate RAM, continuing without it");
             cart->ram_size = 0;
         }
     }
@@ -97,7 +97,7 @@ int gb_cart_load(gb_cartridge_t *cart, const u8 *data, u32 size) {
     // Copy title
     memcpy(cart->title, &data[0x134], 16);
     cart->title[16] = '\0';
-    printf("[NeoBoy] Game Title: %s\n", cart->title);
+    LOG_INFO(LOG_CART, "Game title: %s", cart->title);
     
     cart->rom_bank = 1;
     cart->rom_bank_9bit = 1;
@@ -107,47 +107,59 @@ int gb_cart_load(gb_cartridge_t *cart, const u8 *data, u32 size) {
     return 0;
 }
 
-u8 gb_cart_read(gb_cartridge_t *cart, u16 addr) {
-    if (!cart || !cart->rom) return 0xFF;
-    
+/* Offset of `addr` (0x0000-0x7FFF) in the ROM image under the current
+ * banking, before mirroring */
+static u32 rom_offset(const gb_cartridge_t *cart, u16 addr) {
     if (addr < 0x4000) {
         /* ROM Bank 0 (or banked in MBC1 Mode 1) */
         u32 bank = 0;
         if (cart->mbc_type == MBC1 && cart->banking_mode == 1) {
             bank = cart->rom_bank & 0x60;
         }
-        
-        u32 offset = (bank * 0x4000) + addr;
-        if (offset < cart->rom_size) {
-            return cart->rom[offset];
-        } else if (cart->rom_size > 0) {
-            return cart->rom[offset % cart->rom_size];
-        }
-    } else if (addr < 0x8000) {
-        /* ROM Bank 01-NN */
-        u32 bank = cart->rom_bank;
-        if (cart->mbc_type == MBC5) bank = cart->rom_bank_9bit;
-        
-        /* MBC1/3/5 Bank 0 logic (bank 0 is interpreted as bank 1) */
-        if (cart->mbc_type != MBC5 && (bank & 0x1F) == 0) {
-            bank |= 1;
-        }
-        
-        u32 offset = (bank * 0x4000) + (addr - 0x4000);
-        if (offset < cart->rom_size) {
-            return cart->rom[offset];
-        } else if (cart->rom_size > 0) {
-            // Mirroring
-            u32 mirrored_offset = offset % cart->rom_size;
-            return cart->rom[mirrored_offset];
-        }
+        return (bank * 0x4000) + addr;
     }
-    
-    return 0xFF;
+
+    /* ROM Bank 01-NN */
+    u32 bank = cart->rom_bank;
+    if (cart->mbc_type == MBC5) bank = cart->rom_bank_9bit;
+
+    /* MBC1/3/5 Bank 0 logic (bank 0 is interpreted as bank 1) */
+    if (cart->mbc_type != MBC5 && (bank & 0x1F) == 0) {
+        bank |= 1;
+    }
+    return (bank * 0x4000) + (addr - 0x4000);
 }
 
-void gb_cart_write(gb_cartridge_t *cart, u16 addr, u8 value) {
-    if (!cart) return;
+u8 gb_cart_read(gb_cartridge_t *cart, u16 addr) {
+    if (!cart || !cart->rom || addr >= 0x8000) return 0xFF;
+
+    u32 offset = rom_offset(cart, addr);
+    if (offset >= cart->rom_size) {
+        offset %= cart->rom_size; /* Mirroring */
+    }
+    return cart->rom[offset];
+}
+
+u8 *gb_cart_rom_page(gb_cartridge_t *cart, u16 addr) {
+    if (!cart || !cart->rom) return NULL;
+
+    u32 offset = rom_offset(cart, addr & 0xFF00);
+    if (offset >= cart->rom_size) {
+        offset %= cart->rom_size;
+    }
+    /* A page that wraps past the end of a short image mirrors byte by byte */
+    if (offset + 0x100 > cart->rom_size) return NULL;
+    return cart->rom + offset;
+}
+
+bool gb_cart_write(gb_cartridge_t *cart, u16 addr, u8 value) {
+    if (!cart) return false;
+    
+    u16 rom_bank = cart->rom_bank;
+    u16 rom_bank_9bit = cart->rom_bank_9bit;
+    u8 ram_bank = cart->ram_bank;
+    bool ram_enable = cart->ram_enable;
+    u8 banking_mode = cart->banking_mode;
     
     switch (cart->mbc_type) {
         case MBC1:
@@ -212,19 +224,28 @@ void gb_cart_write(gb_cartridge_t *cart, u16 addr, u8 value) {
         default:
             break;
     }
+    
+    return cart->rom_bank != rom_bank || cart->rom_bank_9bit != rom_bank_9bit ||
+           cart->ram_bank != ram_bank || cart->ram_enable != ram_enable ||
+           cart->banking_mode != banking_mode;
+}
+
+/* RTC registers are mapped instead of RAM for MBC3 banks 08-0C */
+static bool rtc_mapped(const gb_cartridge_t *cart) {
+    return cart->mbc_type == MBC3 && cart->ram_bank >= 0x08 && cart->ram_bank <= 0x0C;
 }
 
 u8 gb_cart_read_ram(gb_cartridge_t *cart, u16 addr) {
     if (!cart || !cart->ram_enable) return 0xFF;
     
-    if (cart->mbc_type == MBC3 && cart->ram_bank >= 0x08 && cart->ram_bank <= 0x0C) {
+    if (rtc_mapped(cart)) {
         /* Read RTC Register */
         return cart->rtc_latched ? cart->rtc_latch[cart->ram_bank - 0x08] : cart->rtc_regs[cart->ram_bank - 0x08];
     }
 
     if (!cart->ram) return 0xFF;
 
-    u32 offset = (cart->ram_bank * 0x2000) + (addr - 0xA000);
+    u32 offset = (cart->ram_bank * 0x2000) + addr;
     if (offset < cart->ram_size) {
         return cart->ram[offset];
     }
@@ -235,7 +256,7 @@ u8 gb_cart_read_ram(gb_cartridge_t *cart, u16 addr) {
 void gb_cart_write_ram(gb_cartridge_t *cart, u16 addr, u8 value) {
     if (!cart || !cart->ram_enable) return;
 
-    if (cart->mbc_type == MBC3 && cart->ram_bank >= 0x08 && cart->ram_bank <= 0x0C) {
+    if (rtc_mapped(cart)) {
         /* Write RTC Register */
         cart->rtc_regs[cart->ram_bank - 0x08] = value;
         return;
@@ -243,12 +264,20 @@ void gb_cart_write_ram(gb_cartridge_t *cart, u16 addr, u8 value) {
     
     if (!cart->ram) return;
 
-    u32 offset = (cart->ram_bank * 0x2000) + (addr - 0xA000);
+    u32 offset = (cart->ram_bank * 0x2000) + addr;
     if (offset < cart->ram_size) {
         cart->ram[offset] = value;
     }
 }
 
+u8 *gb_cart_ram_page(gb_cartridge_t *cart, u16 addr) {
+    if (!cart || !cart->ram_enable || !cart->ram || rtc_mapped(cart)) return NULL;
+
+    u32 offset = (cart->ram_bank * 0x2000) + (addr & 0x1F00);
+    if (offset + 0x100 > cart->ram_size) return NULL;
+    return cart->ram + offset;
+}
+
 void gb_cart_step(gb_cartridge_t *cart, u32 cycles) {
     if (!cart || cart->mbc_type != MBC3) return;
 
@@ -82,19 +82,34 @@ u8 gb_cart_read(gb_cartridge_t *cart, u16 addr);
 
 /**
  * Write to cartridge (MBC registers)
+ * @return true if the write changed the ROM or RAM mapping
  */
-void gb_cart_write(gb_cartridge_t *cart, u16 addr, u8 value);
+bool gb_cart_write(gb_cartridge_t *cart, u16 addr, u8 value);
 
 /**
  * Read from external RAM
+ * @param addr Offset into the 0xA000-0xBFFF window
  */
 u8 gb_cart_read_ram(gb_cartridge_t *cart, u16 addr);
 
 /**
  * Write to external RAM
+ * @param addr Offset into the 0xA000-0xBFFF window
  */
 void gb_cart_write_ram(gb_cartridge_t *cart, u16 addr, u8 value);
 
+/**
+ * Host pointer to the 256-byte ROM page holding `addr` under the current
+ * banking, or NULL if the page cannot be mapped directly
+ */
+u8 *gb_cart_rom_page(gb_cartridge_t *cart, u16 addr);
+
+/**
+ * Host pointer to the 256-byte external RAM page holding window offset
+ * `addr`, or NULL while RAM is disabled, absent or replaced by the RTC
+ */
+u8 *gb_cart_ram_page(gb_cartridge_t *cart, u16 addr);
+
 /**
  * Free cartridge resources
  */
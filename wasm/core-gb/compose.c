@@ -0,0 +1,160 @@
+/**
+ * NeoBoy - Game Boy Scanline Compositor Implementation
+ *
+ * Purpose: Scalar, WebAssembly SIMD128, SSSE3 and AVX2 line compositing
+ */
+
+#include "compose.h"
+#include <string.h>
+
+#if defined(__wasm_simd128__)
+#define GB_COMPOSE_WASM 1
+#include <wasm_simd128.h>
+#elif (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define GB_COMPOSE_X86 1
+#include <immintrin.h>
+#endif
+
+#if GB_SCREEN_WIDTH % 32
+#error "the SIMD compositors assume whole 32-pixel steps"
+#endif
+
+static void compose_scalar(u8 *out, const u8 *bg, const u8 *obj, const u32 *lut) {
+    for (u32 x = 0; x < GB_SCREEN_WIDTH; x++) {
+        u32 pixel = lut[obj[x] ? obj[x] : bg[x] & 3];
+        memcpy(out + x * 4, &pixel, 4);
+    }
+}
+
+/* The table split by channel: planes[c][i] is byte c (R, G, B, A) of lut[i],
+ * ready to be indexed by a byte shuffle */
+static void lut_planes(const u32 *lut, u8 planes[4][GB_COMPOSE_LUT_SIZE]) {
+    for (u32 i = 0; i < GB_COMPOSE_LUT_SIZE; i++) {
+        for (u32 c = 0; c < 4; c++) {
+            planes[c][i] = (u8)(lut[i] >> (c * 8));
+        }
+    }
+}
+
+#if GB_COMPOSE_WASM
+
+static void compose_simd128(u8 *out, const u8 *bg, const u8 *obj, const u32 *lut) {
+    u8 planes[4][GB_COMPOSE_LUT_SIZE];
+    lut_planes(lut, planes);
+    v128_t r = wasm_v128_load(planes[0]), g = wasm_v128_load(planes[1]);
+    v128_t b = wasm_v128_load(planes[2]), a = wasm_v128_load(planes[3]);
+    v128_t three = wasm_i8x16_splat(3);
+
+    for (u32 x = 0; x < GB_SCREEN_WIDTH; x += 16) {
+        v128_t back = wasm_v128_and(wasm_v128_load(bg + x), three);
+        v128_t sprite = wasm_v128_load(obj + x);
+        v128_t index = wasm_v128_bitselect(back, sprite, wasm_i8x16_eq(sprite, wasm_i8x16_splat(0)));
+
+        v128_t cr = wasm_i8x16_swizzle(r, index), cg = wasm_i8x16_swizzle(g, index);
+        v128_t cb = wasm_i8x16_swizzle(b, index), ca = wasm_i8x16_swizzle(a, index);
+        v128_t rg_lo = wasm_i8x16_shuffle(cr, cg, 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        v128_t rg_hi = wasm_i8x16_shuffle(cr, cg, 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+        v128_t ba_lo = wasm_i8x16_shuffle(cb, ca, 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        v128_t ba_hi = wasm_i8x16_shuffle(cb, ca, 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+        u8 *dst = out + x * 4;
+        wasm_v128_store(dst, wasm_i16x8_shuffle(rg_lo, ba_lo, 0, 8, 1, 9, 2, 10, 3, 11));
+        wasm_v128_store(dst + 16, wasm_i16x8_shuffle(rg_lo, ba_lo, 4, 12, 5, 13, 6, 14, 7, 15));
+        wasm_v128_store(dst + 32, wasm_i16x8_shuffle(rg_hi, ba_hi, 0, 8, 1, 9, 2, 10, 3, 11));
+        wasm_v128_store(dst + 48, wasm_i16x8_shuffle(rg_hi, ba_hi, 4, 12, 5, 13, 6, 14, 7, 15));
+    }
+}
+
+#endif /* GB_COMPOSE_WASM */
+
+#if GB_COMPOSE_X86
+
+__attribute__((target("ssse3")))
+static void compose_ssse3(u8 *out, const u8 *bg, const u8 *obj, const u32 *lut) {
+    u8 planes[4][GB_COMPOSE_LUT_SIZE];
+    lut_planes(lut, planes);
+    __m128i r = _mm_loadu_si128((const __m128i *)planes[0]), g = _mm_loadu_si128((const __m128i *)planes[1]);
+    __m128i b = _mm_loadu_si128((const __m128i *)planes[2]), a = _mm_loadu_si128((const __m128i *)planes[3]);
+    __m128i three = _mm_set1_epi8(3);
+
+    for (u32 x = 0; x < GB_SCREEN_WIDTH; x += 16) {
+        __m128i back = _mm_and_si128(_mm_loadu_si128((const __m128i *)(bg + x)), three);
+        __m128i sprite = _mm_loadu_si128((const __m128i *)(obj + x));
+        __m128i none = _mm_cmpeq_epi8(sprite, _mm_setzero_si128());
+        __m128i index = _mm_or_si128(_mm_and_si128(none, back), _mm_andnot_si128(none, sprite));
+
+        __m128i cr = _mm_shuffle_epi8(r, index), cg = _mm_shuffle_epi8(g, index);
+        __m128i cb = _mm_shuffle_epi8(b, index), ca = _mm_shuffle_epi8(a, index);
+        __m128i rg_lo = _mm_unpacklo_epi8(cr, cg), rg_hi = _mm_unpackhi_epi8(cr, cg);
+        __m128i ba_lo = _mm_unpacklo_epi8(cb, ca), ba_hi = _mm_unpackhi_epi8(cb, ca);
+        __m128i *dst = (__m128i *)(out + x * 4);
+        _mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(rg_lo, ba_lo));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(rg_lo, ba_lo));
+        _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(rg_hi, ba_hi));
+        _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(rg_hi, ba_hi));
+    }
+}
+
+/* As compose_ssse3(), 32 pixels a step: the shuffles and unpacks work
+ * within each 128-bit half, so the halves are put back in order on store */
+__attribute__((target("avx2")))
+static void compose_avx2(u8 *out, const u8 *bg, const u8 *obj, const u32 *lut) {
+    u8 planes[4][GB_COMPOSE_LUT_SIZE];
+    lut_planes(lut, planes);
+    __m256i r = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)planes[0]));
+    __m256i g = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)planes[1]));
+    __m256i b = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)planes[2]));
+    __m256i a = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)planes[3]));
+    __m256i three = _mm256_set1_epi8(3);
+
+    for (u32 x = 0; x < GB_SCREEN_WIDTH; x += 32) {
+        __m256i back = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(bg + x)), three);
+        __m256i sprite = _mm256_loadu_si256((const __m256i *)(obj + x));
+        __m256i index = _mm256_blendv_epi8(sprite, back, _mm256_cmpeq_epi8(sprite, _mm256_setzero_si256()));
+
+        __m256i cr = _mm256_shuffle_epi8(r, index), cg = _mm256_shuffle_epi8(g, index);
+        __m256i cb = _mm256_shuffle_epi8(b, index), ca = _mm256_shuffle_epi8(a, index);
+        __m256i rg_lo = _mm256_unpacklo_epi8(cr, cg), rg_hi = _mm256_unpackhi_epi8(cr, cg);
+        __m256i ba_lo = _mm256_unpacklo_epi8(cb, ca), ba_hi = _mm256_unpackhi_epi8(cb, ca);
+        __m256i p0 = _mm256_unpacklo_epi16(rg_lo, ba_lo);  /* Pixels 0-3 | 16-19 */
+        __m256i p1 = _mm256_unpackhi_epi16(rg_lo, ba_lo);  /* 4-7 | 20-23 */
+        __m256i p2 = _mm256_unpacklo_epi16(rg_hi, ba_hi);  /* 8-11 | 24-27 */
+        __m256i p3 = _mm256_unpackhi_epi16(rg_hi, ba_hi);  /* 12-15 | 28-31 */
+        __m256i *dst = (__m256i *)(out + x * 4);
+        _mm256_storeu_si256(dst + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+}
+
+#endif /* GB_COMPOSE_X86 */
+
+static gb_compose_variant_t variants[3];
+static u32 variant_count;
+
+gb_compose_fn_t gb_compose_line = compose_scalar;
+
+void gb_compose_init(void) {
+    if (variant_count) {
+        return;
+    }
+    variants[variant_count++] = (gb_compose_variant_t){ "scalar", compose_scalar };
+#if GB_COMPOSE_WASM
+    variants[variant_count++] = (gb_compose_variant_t){ "simd128", compose_simd128 };
+#elif GB_COMPOSE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) {
+        variants[variant_count++] = (gb_compose_variant_t){ "ssse3", compose_ssse3 };
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        variants[variant_count++] = (gb_compose_variant_t){ "avx2", compose_avx2 };
+    }
+#endif
+    gb_compose_line = variants[variant_count - 1].fn;
+}
+
+u32 gb_compose_variants(const gb_compose_variant_t **list) {
+    gb_compose_init();
+    *list = variants;
+    return variant_count;
+}
@@ -0,0 +1,61 @@
+/**
+ * NeoBoy - Game Boy Scanline Compositor Header
+ *
+ * Purpose: Turn a scanline's layer buffers into framebuffer pixels
+ *
+ * gb_ppu_render_scanline() draws each layer into a 160-entry line buffer of
+ * palette indices instead of the framebuffer:
+ *
+ *   bg   BG/window colour 0-3 (bit 7, the CGB BG-over-OBJ attribute, is
+ *        ignored here)
+ *   obj  sprite pixel that won, as GB_COMPOSE_OBP0/OBP1 | colour 1-3, or 0
+ *        where no sprite shows
+ *
+ * The compositor picks the sprite index where there is one and the BG
+ * index elsewhere, looks it up in a 16-entry table of RGBA pixels (BGP
+ * shades at 0-3, OBP0 at 4-7, OBP1 at 8-11) and stores every pixel once
+ * as a u32.
+ *
+ * The lookup is a byte shuffle per colour channel, so each variant handles
+ * 16 or 32 pixels per step: WebAssembly SIMD128 (i8x16.swizzle) in the web
+ * build, SSSE3 and AVX2 natively on x86, chosen at startup from what the
+ * CPU supports, and a scalar loop everywhere else. SSE2 alone has no byte
+ * shuffle; x86 CPUs without SSSE3 get the scalar loop.
+ */
+
+#ifndef GB_COMPOSE_H
+#define GB_COMPOSE_H
+
+#include "../common/common.h"
+#include "ppu.h"
+
+/* Palette of a sprite pixel in the obj line buffer */
+#define GB_COMPOSE_OBP0 0x04
+#define GB_COMPOSE_OBP1 0x08
+
+#define GB_COMPOSE_LUT_SIZE 16
+
+/* Pixel x of `out` (RGBA bytes) = lut[obj[x] ? obj[x] : bg[x] & 3], for
+ * the GB_SCREEN_WIDTH pixels of a line */
+typedef void (*gb_compose_fn_t)(u8 *out, const u8 *bg, const u8 *obj, const u32 *lut);
+
+typedef struct {
+    const char *name;
+    gb_compose_fn_t fn;
+} gb_compose_variant_t;
+
+/* Fastest variant the host supports (set by gb_compose_init()) */
+extern gb_compose_fn_t gb_compose_line;
+
+/**
+ * Pick the fastest variant for this CPU
+ */
+void gb_compose_init(void);
+
+/**
+ * Variants this CPU can run, scalar first and the one gb_compose_init()
+ * picks last; returns how many
+ */
+u32 gb_compose_variants(const gb_compose_variant_t **variants);
+
+#endif /* GB_COMPOSE_H */
@@ -31,6 +31,33 @@ typedef enum {
     BTN_DOWN   = 7
 } GameBoyButton;
 
+// Stop conditions for gb_run_cycles (OR'd into stop_mask and its result)
+typedef enum {
+    GB_STOP_BUDGET     = 0,       // Cycle budget used up
+    GB_STOP_VBLANK     = 1 << 0,  // PPU entered VBlank
+    GB_STOP_JOYPAD     = 1 << 1,  // Game read the joypad register (0xFF00)
+    GB_STOP_SERIAL     = 1 << 2,  // Game started sending a serial byte
+    GB_STOP_BREAKPOINT = 1 << 3   // PC reached a breakpoint (gb_set_breakpoint)
+} GameBoyStopReason;
+
+// One instruction in the trace ring (gb_set_trace): registers as they were
+// before it executed. 24 bytes, little-endian in trace files.
+typedef struct {
+    uint64_t cycle;   // Scheduler time of the opcode fetch
+    uint16_t pc;
+    uint16_t bank;    // ROM bank PC was mapped from, 0 outside 0000-7FFF
+    uint16_t sp;
+    uint8_t opcode;
+    uint8_t a, f, b, c, d, e, h, l;
+    uint8_t reserved;
+} GameBoyTraceRecord;
+
+// Text formats of gb_get_guest_profile
+typedef enum {
+    GB_GUEST_PROFILE_FOLDED   = 0,  // "main;00:0150;01:4A20 cycles" lines (flamegraph.pl)
+    GB_GUEST_PROFILE_HOTSPOTS = 1   // "01:4A20 cycles" lines, most cycles first
+} GuestProfileFormat;
+
 // ===== WASM Exported Functions =====
 
 /**
@@ -52,6 +79,34 @@ int gb_load_rom(const uint8_t* rom_data, uint32_t size);
  */
 void gb_step_frame(void);
 
+/**
+ * Run for up to `budget` CPU cycles, or until one of the conditions in
+ * `stop_mask` fires. The run ends on an instruction boundary, so it can
+ * overshoot the budget by one instruction (or interrupt dispatch).
+ * @param budget Cycle budget (4194304 per second, doubled in CGB double speed)
+ * @param stop_mask GameBoyStopReason bits that end the run early
+ * @return GameBoyStopReason bits that ended the run, GB_STOP_BUDGET if none
+ */
+uint32_t gb_run_cycles(uint32_t budget, uint32_t stop_mask);
+
+/**
+ * Cycles consumed by the last gb_run_cycles call
+ */
+uint32_t gb_get_run_cycles(void);
+
+/**
+ * Add a PC breakpoint for gb_run_cycles (GB_STOP_BREAKPOINT)
+ * The run stops before the instruction at `addr` executes; the next run
+ * resumes with it.
+ * @return 0 on success, -1 if the breakpoint table is full
+ */
+int gb_set_breakpoint(uint16_t addr);
+
+/**
+ * Remove all breakpoints
+ */
+void gb_clear_breakpoints(void);
+
 /**
  * Set button state
  * @param button Button identifier
@@ -59,12 +114,126 @@ void gb_step_frame(void);
  */
 void gb_set_button(GameBoyButton button, bool pressed);
 
+/**
+ * Map CGB colours through an approximation of the CGB LCD's response
+ * instead of scaling RGB555 straight to RGB888
+ */
+void gb_set_color_correction(bool enabled);
+
+/**
+ * Deferred rendering: log each visible line's PPU state as it ends and draw
+ * the whole frame at VBlank, with the same output. The framebuffer is then
+ * only up to date between frames (gb_step_frame() always returns there).
+ */
+void gb_set_deferred_render(bool enabled);
+
 /**
  * Get pointer to framebuffer (RGBA format)
  * @return Pointer to framebuffer array
  */
 uint8_t* gb_get_framebuffer(void);
 
+/**
+ * Enable or disable idle-loop skipping for the loaded ROM
+ * Enabled by default; loading a ROM turns it back on
+ * @param enabled false to run polling loops instruction by instruction
+ */
+void gb_set_idle_loop_skip(bool enabled);
+
+/**
+ * Idle loops fast-forwarded during the last frame
+ */
+uint32_t gb_get_idle_loop_hits(void);
+
+/**
+ * CPU cycles skipped by idle-loop fast-forwarding during the last frame
+ */
+uint32_t gb_get_idle_loop_cycles(void);
+
+/**
+ * Switch gb_cpu_run() between the interpreter and the basic-block
+ * translation cache. Both give identical results; the cache is faster on
+ * most code and meant for fast-forward and headless runs. Off by default.
+ * Clears the cache statistics.
+ */
+void gb_set_block_cache(bool enabled);
+
+/**
+ * Translated blocks entered from the cache since it was last switched
+ */
+uint32_t gb_get_block_cache_hits(void);
+
+/**
+ * Block translations (cache misses) since it was last switched
+ */
+uint32_t gb_get_block_cache_misses(void);
+
+/**
+ * Memory taken by the translation cache in bytes
+ */
+uint32_t gb_get_block_cache_bytes(void);
+
+/**
+ * Let the block cache compile hot blocks to WebAssembly. On by default in
+ * the web build; has no effect in builds without a JIT (native tools).
+ */
+void gb_set_jit(bool enabled);
+
+/**
+ * Blocks currently held as compiled WebAssembly
+ */
+uint32_t gb_get_jit_blocks(void);
+
+/**
+ * Start or stop the guest code profiler (see prof.h). Starting clears the
+ * previous profile; while it runs the CPU is interpreted, without the block
+ * cache or JIT. Only builds with GB_GUEST_PROFILER=1 (`make gb-prof`) have
+ * a profiler; elsewhere this does nothing.
+ */
+void gb_set_guest_profiler(bool enabled);
+
+/**
+ * Profile collected since the profiler was started
+ * @param format GuestProfileFormat
+ * @return NUL-terminated text, valid until the next call (empty without a profiler)
+ */
+const char* gb_get_guest_profile(uint32_t format);
+
+/**
+ * Length in bytes of the text last returned by gb_get_guest_profile
+ */
+uint32_t gb_get_guest_profile_size(void);
+
+/**
+ * Record every executed instruction into a ring of the `records` most recent
+ * (rounded up to a power of two); 0 stops tracing and frees the ring. The
+ * ring starts empty. While tracing, the CPU is interpreted, without the
+ * block cache or JIT.
+ * @return 0 on success, -1 if the ring cannot be allocated
+ */
+int gb_set_trace(uint32_t records);
+
+/**
+ * Copy the newest `max` records held in the trace ring, oldest first
+ * @return Records copied
+ */
+uint32_t gb_get_trace(GameBoyTraceRecord* buffer, uint32_t max);
+
+/**
+ * Records written since tracing was last enabled (wraps at 2^32); the
+ * difference between two calls is what a snapshot must hold to miss nothing
+ */
+uint32_t gb_get_trace_count(void);
+
+/**
+ * Move pending log records into `buffer` as text lines ("I cart: ...\n").
+ * Logging is compiled in only with -DNEOBOY_LOG_LEVEL=n (`make gb
+ * LOG_LEVEL=4` for everything, see wasm/common/log.h); release builds
+ * always return 0.
+ * @return Bytes written (not NUL-terminated)
+ */
+uint32_t gb_get_log(uint8_t* buffer, uint32_t size);
+
 /**
  * Save emulator state
  * @param buffer Output buffer for state data
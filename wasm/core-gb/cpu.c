@@ -3,29 +3,58 @@
  * 
  * Purpose: CPU instruction execution and state management
  * 
- * This is a placeholder implementation that provides the basic structure
- * for CPU emulation. A full implementation would include:
- * - Complete instruction decode table (256 opcodes + 256 CB-prefixed)
- * - ALU operations (ADD, SUB, AND, OR, XOR, CP, INC, DEC)
- * - Load/Store operations
- * - Jump/Call/Return operations
- * - Bit operations (via CB prefix)
- * - Interrupt handling (VBLANK, LCD STAT, Timer, Serial, Joypad)
+ * Instructions are decoded through the generated tables in cpu_tables.h
+ * (256 main opcodes + 256 CB-prefixed opcodes). Each table entry names a
+ * per-operand handler defined below and its base cycle count, so decoding
+ * is a single indexed jump instead of a switch or comparison ladder.
  * 
- * TODO: Implement full instruction set and timing
+ * Regenerate the tables with: python3 scripts/gen-cpu-tables.py
  */
 
+#include "core.h"
+#include "block.h"
 #include "cpu.h"
+#include "cpu_tables.h"
 #include "mmu.h"
+#include "prof.h"
+#include "profile.h"
+#include "scheduler.h"
+#include "trace.h"
+#include "../common/log.h"
+#if GB_ALU_TABLES
+#include "alu_tables.h"
+#endif
 #include <string.h>
-#include <stdio.h>
+
+gb_idle_loop_t gb_cpu_idle_loop = { .enabled = true };
+gb_breakpoints_t gb_cpu_breakpoints;
+
+#ifdef GB_BENCH
+u64 gb_cpu_instructions = 0;
+#endif
+
+#ifdef GB_PAIR_STATS
+u32 gb_cpu_pairs[0x10000];
+
+/* Count `opcode` as the second of a pair if it directly follows the last
+ * instruction (no jump or interrupt in between) */
+static void cpu_count_pair(u16 at, u8 opcode, u16 next) {
+    static int prev = -1;
+    static u16 prev_next;
+    if (prev >= 0 && at == prev_next) {
+        gb_cpu_pairs[(prev << 8) | opcode]++;
+    }
+    prev = opcode;
+    prev_next = next;
+}
+#endif
 
 void gb_cpu_init(gb_cpu_t *cpu) {
     memset(cpu, 0, sizeof(gb_cpu_t));
     
     /* Set power-on register values (from Pan Docs) */
     cpu->a = 0x01;
-    cpu->f = 0xB0;
+    gb_cpu_set_f(cpu, 0xB0);
     cpu->b = 0x00;
     cpu->c = 0x13;
     cpu->d = 0x00;
@@ -40,7 +69,6 @@ void gb_cpu_init(gb_cpu_t *cpu) {
     cpu->halted = false;
     cpu->stopped = false;
     cpu->halt_bug = false;
-    cpu->cycles = 0;
 }
 
 void gb_cpu_reset(gb_cpu_t *cpu) {
@@ -48,11 +76,11 @@ void gb_cpu_reset(gb_cpu_t *cpu) {
 }
 
 static u8 fetch_u8(gb_cpu_t *cpu, gb_mmu_t *mmu) {
-    return gb_mmu_read(mmu, cpu->pc++);
+    return gb_mmu_fetch8(mmu, cpu->pc++);
 }
 
 static u16 fetch_u16(gb_cpu_t *cpu, gb_mmu_t *mmu) {
-    u16 val = gb_mmu_read16(mmu, cpu->pc);
+    u16 val = gb_mmu_fetch16(mmu, cpu->pc);
     cpu->pc += 2;
     return val;
 }
@@ -68,284 +96,824 @@ static u16 pop16(gb_cpu_t *cpu, gb_mmu_t *mmu) {
     return val;
 }
 
-/* ALU Helpers */
+/* ALU Helpers
+ *
+ * Flags are written in their lazy form (see gb_cpu_t): Z as the result
+ * byte, H as bit 4 of a ^ b ^ result (the carry into bit 4, for both
+ * addition and subtraction), C straight from bit 8 of the wide result.
+ */
+
+#if GB_ALU_TABLES
+
+/* Table path: one load yields the result byte, H and C (alu_tables.h) */
+static inline u8 alu_lookup(gb_cpu_t *cpu, u16 entry, u8 n) {
+    cpu->flag_n = n;
+    cpu->flag_h = (entry >> 8) & 0x10;
+    cpu->flag_c = (entry >> 8) & 1;
+    return cpu->flag_z = (u8)entry;
+}
+
+#define ALU_INDEX(cpu, c, val) (((u32)(c) << 16) | ((cpu)->a << 8) | (val))
+
+static void alu_add(gb_cpu_t *cpu, u8 val) { cpu->a = alu_lookup(cpu, gb_alu_add[ALU_INDEX(cpu, 0, val)], 0); }
+static void alu_adc(gb_cpu_t *cpu, u8 val) { cpu->a = alu_lookup(cpu, gb_alu_add[ALU_INDEX(cpu, cpu->flag_c, val)], 0); }
+static void alu_sub(gb_cpu_t *cpu, u8 val) { cpu->a = alu_lookup(cpu, gb_alu_sub[ALU_INDEX(cpu, 0, val)], 1); }
+static void alu_sbc(gb_cpu_t *cpu, u8 val) { cpu->a = alu_lookup(cpu, gb_alu_sub[ALU_INDEX(cpu, cpu->flag_c, val)], 1); }
+
+#else
 
 static void alu_add(gb_cpu_t *cpu, u8 val) {
     u16 res = (u16)cpu->a + val;
-    cpu->f = 0;
-    if ((res & 0xFF) == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if ((cpu->a & 0xF) + (val & 0xF) > 0xF) CPU_SET_FLAG(cpu, FLAG_H);
-    if (res > 0xFF) CPU_SET_FLAG(cpu, FLAG_C);
-    cpu->a = (u8)res;
+    cpu->flag_n = 0;
+    cpu->flag_h = cpu->a ^ val ^ res;
+    cpu->flag_c = res >> 8;
+    cpu->a = cpu->flag_z = (u8)res;
 }
 
 static void alu_adc(gb_cpu_t *cpu, u8 val) {
-    u8 carry = CPU_GET_FLAG(cpu, FLAG_C);
-    u32 res = (u32)cpu->a + val + carry;
-    cpu->f = 0;
-    if ((res & 0xFF) == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if ((cpu->a & 0xF) + (val & 0xF) + carry > 0xF) CPU_SET_FLAG(cpu, FLAG_H);
-    if (res > 0xFF) CPU_SET_FLAG(cpu, FLAG_C);
-    cpu->a = (u8)res;
+    u16 res = (u16)cpu->a + val + cpu->flag_c;
+    cpu->flag_n = 0;
+    cpu->flag_h = cpu->a ^ val ^ res;
+    cpu->flag_c = res >> 8;
+    cpu->a = cpu->flag_z = (u8)res;
 }
 
 static void alu_sub(gb_cpu_t *cpu, u8 val) {
-    cpu->f = (1 << FLAG_N);
-    if (cpu->a == val) CPU_SET_FLAG(cpu, FLAG_Z);
-    if ((cpu->a & 0xF) < (val & 0xF)) CPU_SET_FLAG(cpu, FLAG_H);
-    if (cpu->a < val) CPU_SET_FLAG(cpu, FLAG_C);
-    cpu->a -= val;
+    u16 res = (u16)cpu->a - val;
+    cpu->flag_n = 1;
+    cpu->flag_h = cpu->a ^ val ^ res;
+    cpu->flag_c = (res >> 8) & 1;
+    cpu->a = cpu->flag_z = (u8)res;
 }
 
 static void alu_sbc(gb_cpu_t *cpu, u8 val) {
-    u8 carry = CPU_GET_FLAG(cpu, FLAG_C);
-    int res = (int)cpu->a - val - carry;
-    cpu->f = (1 << FLAG_N);
-    if ((res & 0xFF) == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if ((int)(cpu->a & 0xF) - (int)(val & 0xF) - (int)carry < 0) CPU_SET_FLAG(cpu, FLAG_H);
-    if (res < 0) CPU_SET_FLAG(cpu, FLAG_C);
-    cpu->a = (u8)res;
+    u16 res = (u16)cpu->a - val - cpu->flag_c;
+    cpu->flag_n = 1;
+    cpu->flag_h = cpu->a ^ val ^ res;
+    cpu->flag_c = (res >> 8) & 1;
+    cpu->a = cpu->flag_z = (u8)res;
 }
 
+#endif /* GB_ALU_TABLES */
+
 static void alu_and(gb_cpu_t *cpu, u8 val) {
-    cpu->a &= val;
-    cpu->f = (1 << FLAG_H); // H is set for AND
-    if (cpu->a == 0) CPU_SET_FLAG(cpu, FLAG_Z);
+    cpu->a = cpu->flag_z = cpu->a & val;
+    cpu->flag_n = 0;
+    cpu->flag_h = 0x10; // H is set for AND
+    cpu->flag_c = 0;
 }
 
 static void alu_or(gb_cpu_t *cpu, u8 val) {
-    cpu->a |= val;
-    cpu->f = 0;
-    if (cpu->a == 0) CPU_SET_FLAG(cpu, FLAG_Z);
+    cpu->a = cpu->flag_z = cpu->a | val;
+    cpu->flag_n = 0;
+    cpu->flag_h = 0;
+    cpu->flag_c = 0;
 }
 
 static void alu_xor(gb_cpu_t *cpu, u8 val) {
-    cpu->a ^= val;
-    cpu->f = 0;
-    if (cpu->a == 0) CPU_SET_FLAG(cpu, FLAG_Z);
+    cpu->a = cpu->flag_z = cpu->a ^ val;
+    cpu->flag_n = 0;
+    cpu->flag_h = 0;
+    cpu->flag_c = 0;
 }
 
 static void alu_cp(gb_cpu_t *cpu, u8 val) {
-    u8 temp_a = cpu->a;
-    alu_sub(cpu, val);
-    cpu->a = temp_a; // CP is like SUB but doesn't affect A
+    /* CP is like SUB but doesn't affect A */
+#if GB_ALU_TABLES
+    alu_lookup(cpu, gb_alu_sub[ALU_INDEX(cpu, 0, val)], 1);
+#else
+    u16 res = (u16)cpu->a - val;
+    cpu->flag_n = 1;
+    cpu->flag_h = cpu->a ^ val ^ res;
+    cpu->flag_c = (res >> 8) & 1;
+    cpu->flag_z = (u8)res;
+#endif
+}
+
+/* INC/DEC leave C untouched */
+#if GB_ALU_TABLES
+static void alu_inc(gb_cpu_t *cpu, u8 *reg) {
+    u16 entry = gb_alu_inc[*reg];
+    cpu->flag_n = 0;
+    cpu->flag_h = (entry >> 8) & 0x10;
+    *reg = cpu->flag_z = (u8)entry;
 }
 
+static void alu_dec(gb_cpu_t *cpu, u8 *reg) {
+    u16 entry = gb_alu_dec[*reg];
+    cpu->flag_n = 1;
+    cpu->flag_h = (entry >> 8) & 0x10;
+    *reg = cpu->flag_z = (u8)entry;
+}
+#else
 static void alu_inc(gb_cpu_t *cpu, u8 *reg) {
     u8 res = *reg + 1;
-    CPU_CLEAR_FLAG(cpu, FLAG_Z);
-    CPU_CLEAR_FLAG(cpu, FLAG_N);
-    CPU_CLEAR_FLAG(cpu, FLAG_H);
-    if (res == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if ((*reg & 0xF) == 0xF) CPU_SET_FLAG(cpu, FLAG_H);
-    *reg = res;
+    cpu->flag_n = 0;
+    cpu->flag_h = *reg ^ 1 ^ res;
+    *reg = cpu->flag_z = res;
 }
 
 static void alu_dec(gb_cpu_t *cpu, u8 *reg) {
     u8 res = *reg - 1;
-    CPU_CLEAR_FLAG(cpu, FLAG_Z);
-    CPU_SET_FLAG(cpu, FLAG_N);
-    CPU_CLEAR_FLAG(cpu, FLAG_H);
-    if (res == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if ((*reg & 0xF) == 0) CPU_SET_FLAG(cpu, FLAG_H);
-    *reg = res;
+    cpu->flag_n = 1;
+    cpu->flag_h = *reg ^ 1 ^ res;
+    *reg = cpu->flag_z = res;
 }
+#endif
 
 /* CB Helpers */
 
+/* Shifts and rotates: Z from the result, N/H cleared, C = bit shifted out */
+static inline void cb_flags(gb_cpu_t *cpu, u8 res, u8 carry) {
+    cpu->flag_z = res;
+    cpu->flag_n = 0;
+    cpu->flag_h = 0;
+    cpu->flag_c = carry;
+}
+
 static void cb_rlc(gb_cpu_t *cpu, u8 *reg) {
     u8 carry = (*reg & 0x80) >> 7;
     *reg = (*reg << 1) | carry;
-    cpu->f = 0;
-    if (*reg == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if (carry) CPU_SET_FLAG(cpu, FLAG_C);
+    cb_flags(cpu, *reg, carry);
 }
 
 static void cb_rrc(gb_cpu_t *cpu, u8 *reg) {
     u8 carry = *reg & 0x01;
     *reg = (*reg >> 1) | (carry << 7);
-    cpu->f = 0;
-    if (*reg == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if (carry) CPU_SET_FLAG(cpu, FLAG_C);
+    cb_flags(cpu, *reg, carry);
 }
 
 static void cb_rl(gb_cpu_t *cpu, u8 *reg) {
-    u8 old_carry = CPU_GET_FLAG(cpu, FLAG_C);
     u8 new_carry = (*reg & 0x80) >> 7;
-    *reg = (*reg << 1) | old_carry;
-    cpu->f = 0;
-    if (*reg == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if (new_carry) CPU_SET_FLAG(cpu, FLAG_C);
+    *reg = (*reg << 1) | cpu->flag_c;
+    cb_flags(cpu, *reg, new_carry);
 }
 
 static void cb_rr(gb_cpu_t *cpu, u8 *reg) {
-    u8 old_carry = CPU_GET_FLAG(cpu, FLAG_C);
     u8 new_carry = *reg & 0x01;
-    *reg = (*reg >> 1) | (old_carry << 7);
-    cpu->f = 0;
-    if (*reg == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if (new_carry) CPU_SET_FLAG(cpu, FLAG_C);
+    *reg = (*reg >> 1) | (cpu->flag_c << 7);
+    cb_flags(cpu, *reg, new_carry);
 }
 
 static void cb_sla(gb_cpu_t *cpu, u8 *reg) {
     u8 carry = (*reg & 0x80) >> 7;
     *reg <<= 1;
-    cpu->f = 0;
-    if (*reg == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if (carry) CPU_SET_FLAG(cpu, FLAG_C);
+    cb_flags(cpu, *reg, carry);
 }
 
 static void cb_sra(gb_cpu_t *cpu, u8 *reg) {
     u8 carry = *reg & 0x01;
     *reg = (u8)((s8)*reg >> 1);
-    cpu->f = 0;
-    if (*reg == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if (carry) CPU_SET_FLAG(cpu, FLAG_C);
+    cb_flags(cpu, *reg, carry);
 }
 
 static void cb_swap(gb_cpu_t *cpu, u8 *reg) {
     *reg = ((*reg & 0x0F) << 4) | ((*reg & 0xF0) >> 4);
-    cpu->f = 0;
-    if (*reg == 0) CPU_SET_FLAG(cpu, FLAG_Z);
+    cb_flags(cpu, *reg, 0);
 }
 
 static void cb_srl(gb_cpu_t *cpu, u8 *reg) {
     u8 carry = *reg & 0x01;
     *reg >>= 1;
-    cpu->f = 0;
-    if (*reg == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-    if (carry) CPU_SET_FLAG(cpu, FLAG_C);
+    cb_flags(cpu, *reg, carry);
 }
 
 static void cb_bit(gb_cpu_t *cpu, u8 bit, u8 val) {
-    CPU_CLEAR_FLAG(cpu, FLAG_N);
-    CPU_SET_FLAG(cpu, FLAG_H);
-    if (!(val & (1 << bit))) CPU_SET_FLAG(cpu, FLAG_Z);
-    else CPU_CLEAR_FLAG(cpu, FLAG_Z);
+    cpu->flag_z = val & (1 << bit);
+    cpu->flag_n = 0;
+    cpu->flag_h = 0x10;
 }
 
 /* Standard Rotations (Accumulator) */
 
+/* Z flag is ALWAYS cleared for RLCA/RRCA/RLA/RRA (flag_z = 1) */
+static inline void rot_flags(gb_cpu_t *cpu, u8 carry) {
+    cpu->flag_z = 1;
+    cpu->flag_n = 0;
+    cpu->flag_h = 0;
+    cpu->flag_c = carry;
+}
+
 static void cpu_rlca(gb_cpu_t *cpu) {
     u8 carry = (cpu->a & 0x80) >> 7;
     cpu->a = (cpu->a << 1) | carry;
-    cpu->f = 0;
-    if (carry) CPU_SET_FLAG(cpu, FLAG_C);
-    // Z flag is ALWAYS cleared for RLCA/RRCA/RLA/RRA
+    rot_flags(cpu, carry);
 }
 
 static void cpu_rrca(gb_cpu_t *cpu) {
     u8 carry = cpu->a & 0x01;
     cpu->a = (cpu->a >> 1) | (carry << 7);
-    cpu->f = 0;
-    if (carry) CPU_SET_FLAG(cpu, FLAG_C);
+    rot_flags(cpu, carry);
 }
 
 static void cpu_rla(gb_cpu_t *cpu) {
-    u8 old_carry = CPU_GET_FLAG(cpu, FLAG_C);
     u8 new_carry = (cpu->a & 0x80) >> 7;
-    cpu->a = (cpu->a << 1) | old_carry;
-    cpu->f = 0;
-    if (new_carry) CPU_SET_FLAG(cpu, FLAG_C);
+    cpu->a = (cpu->a << 1) | cpu->flag_c;
+    rot_flags(cpu, new_carry);
 }
 
 static void cpu_rra(gb_cpu_t *cpu) {
-    u8 old_carry = CPU_GET_FLAG(cpu, FLAG_C);
     u8 new_carry = cpu->a & 0x01;
-    cpu->a = (cpu->a >> 1) | (old_carry << 7);
-    cpu->f = 0;
-    if (new_carry) CPU_SET_FLAG(cpu, FLAG_C);
+    cpu->a = (cpu->a >> 1) | (cpu->flag_c << 7);
+    rot_flags(cpu, new_carry);
 }
 
-static u32 gb_cpu_execute_cb(gb_cpu_t *cpu, gb_mmu_t *mmu) {
-    u8 opcode = fetch_u8(cpu, mmu);
-    u8 *reg = NULL;
-    u16 hl = 0;
-    u8 hl_val = 0;
-    bool is_hl = false;
-
-    /* Identify target register/memory */
-    switch (opcode & 0x07) {
-        case 0: reg = &cpu->b; break;
-        case 1: reg = &cpu->c; break;
-        case 2: reg = &cpu->d; break;
-        case 3: reg = &cpu->e; break;
-        case 4: reg = &cpu->h; break;
-        case 5: reg = &cpu->l; break;
-        case 6:
-            hl = CPU_GET_HL(cpu);
-            hl_val = gb_mmu_read(mmu, hl);
-            reg = &hl_val;
-            is_hl = true;
-            break;
-        case 7: reg = &cpu->a; break;
+/*
+ * Instruction Handlers
+ *
+ * One handler per opcode and operand combination. The opcode -> handler
+ * mapping and base cycle counts live in the generated cpu_tables.h;
+ * handlers only return the extra cycles of a taken branch (usually 0).
+ */
+
+#define OP(name)    static inline u32 op_##name(gb_cpu_t *cpu, gb_mmu_t *mmu)
+#define CB_OP(name) static inline u32 cb_op_##name(gb_cpu_t *cpu, gb_mmu_t *mmu)
+
+/* 8-bit operand accessors ("mhl" is (HL), "d8" is an immediate byte) */
+#define GET_b   cpu->b
+#define GET_c   cpu->c
+#define GET_d   cpu->d
+#define GET_e   cpu->e
+#define GET_h   cpu->h
+#define GET_l   cpu->l
+#define GET_a   cpu->a
+#define GET_mhl gb_mmu_read(mmu, CPU_GET_HL(cpu))
+#define GET_d8  fetch_u8(cpu, mmu)
+
+#define SET_b(v)   (cpu->b = (v))
+#define SET_c(v)   (cpu->c = (v))
+#define SET_d(v)   (cpu->d = (v))
+#define SET_e(v)   (cpu->e = (v))
+#define SET_h(v)   (cpu->h = (v))
+#define SET_l(v)   (cpu->l = (v))
+#define SET_a(v)   (cpu->a = (v))
+#define SET_mhl(v) gb_mmu_write(mmu, CPU_GET_HL(cpu), (v))
+
+/* Branch conditions (read the lazy flags directly, F is never built) */
+#define COND_nz (cpu->flag_z != 0)
+#define COND_z  (cpu->flag_z == 0)
+#define COND_nc (!cpu->flag_c)
+#define COND_c  (cpu->flag_c)
+
+/* Expand M(arg, r) for every 8-bit operand in encoding order */
+#define FOR_EACH_R8(M, arg) \
+    M(arg, b) M(arg, c) M(arg, d) M(arg, e) M(arg, h) M(arg, l) M(arg, mhl) M(arg, a)
+
+/* --- 8-bit Loads --- */
+
+#define DEFINE_LD_R8(dst, src) OP(ld_##dst##_##src) { SET_##dst(GET_##src); return 0; }
+#define DEFINE_LD_ROW(dst) FOR_EACH_R8(DEFINE_LD_R8, dst) DEFINE_LD_R8(dst, d8)
+
+DEFINE_LD_ROW(b)
+DEFINE_LD_ROW(c)
+DEFINE_LD_ROW(d)
+DEFINE_LD_ROW(e)
+DEFINE_LD_ROW(h)
+DEFINE_LD_ROW(l)
+DEFINE_LD_ROW(a)
+
+/* LD (HL), r - (HL),(HL) encodes HALT */
+DEFINE_LD_R8(mhl, b)
+DEFINE_LD_R8(mhl, c)
+DEFINE_LD_R8(mhl, d)
+DEFINE_LD_R8(mhl, e)
+DEFINE_LD_R8(mhl, h)
+DEFINE_LD_R8(mhl, l)
+DEFINE_LD_R8(mhl, a)
+DEFINE_LD_R8(mhl, d8)
+
+OP(ld_mbc_a) { gb_mmu_write(mmu, CPU_GET_BC(cpu), cpu->a); return 0; }
+OP(ld_mde_a) { gb_mmu_write(mmu, CPU_GET_DE(cpu), cpu->a); return 0; }
+OP(ld_a_mbc) { cpu->a = gb_mmu_read(mmu, CPU_GET_BC(cpu)); return 0; }
+OP(ld_a_mde) { cpu->a = gb_mmu_read(mmu, CPU_GET_DE(cpu)); return 0; }
+
+OP(ld_mhli_a) { gb_mmu_write(mmu, cpu->hl++, cpu->a); return 0; }
+OP(ld_mhld_a) { gb_mmu_write(mmu, cpu->hl--, cpu->a); return 0; }
+OP(ld_a_mhli) { cpu->a = gb_mmu_read(mmu, cpu->hl++); return 0; }
+OP(ld_a_mhld) { cpu->a = gb_mmu_read(mmu, cpu->hl--); return 0; }
+
+OP(ld_a_ma16) { cpu->a = gb_mmu_read(mmu, fetch_u16(cpu, mmu)); return 0; }
+OP(ld_ma16_a) { gb_mmu_write(mmu, fetch_u16(cpu, mmu), cpu->a); return 0; }
+OP(ldh_ma8_a) { gb_mmu_write(mmu, 0xFF00 + fetch_u8(cpu, mmu), cpu->a); return 0; }
+OP(ldh_a_ma8) { cpu->a = gb_mmu_read(mmu, 0xFF00 + fetch_u8(cpu, mmu)); return 0; }
+OP(ld_mc_a)   { gb_mmu_write(mmu, 0xFF00 + cpu->c, cpu->a); return 0; }
+OP(ld_a_mc)   { cpu->a = gb_mmu_read(mmu, 0xFF00 + cpu->c); return 0; }
+
+/* --- 16-bit Loads --- */
+
+OP(ld_bc_d16)  { CPU_SET_BC(cpu, fetch_u16(cpu, mmu)); return 0; }
+OP(ld_de_d16)  { CPU_SET_DE(cpu, fetch_u16(cpu, mmu)); return 0; }
+OP(ld_hl_d16)  { CPU_SET_HL(cpu, fetch_u16(cpu, mmu)); return 0; }
+OP(ld_sp_d16)  { cpu->sp = fetch_u16(cpu, mmu); return 0; }
+OP(ld_ma16_sp) { gb_mmu_write16(mmu, fetch_u16(cpu, mmu), cpu->sp); return 0; }
+OP(ld_sp_hl)   { cpu->sp = CPU_GET_HL(cpu); return 0; }
+
+OP(push_bc) { push16(cpu, mmu, CPU_GET_BC(cpu)); return 0; }
+OP(push_de) { push16(cpu, mmu, CPU_GET_DE(cpu)); return 0; }
+OP(push_hl) { push16(cpu, mmu, CPU_GET_HL(cpu)); return 0; }
+OP(push_af) { push16(cpu, mmu, CPU_GET_AF(cpu)); return 0; }
+
+OP(pop_bc) { CPU_SET_BC(cpu, pop16(cpu, mmu)); return 0; }
+OP(pop_de) { CPU_SET_DE(cpu, pop16(cpu, mmu)); return 0; }
+OP(pop_hl) { CPU_SET_HL(cpu, pop16(cpu, mmu)); return 0; }
+OP(pop_af) { CPU_SET_AF(cpu, pop16(cpu, mmu)); return 0; }
+
+/* --- 8-bit Arithmetic/Logic --- */
+
+#define DEFINE_ALU(op, src) OP(op##_##src) { alu_##op(cpu, GET_##src); return 0; }
+#define DEFINE_ALU_ROW(op) FOR_EACH_R8(DEFINE_ALU, op) DEFINE_ALU(op, d8)
+
+DEFINE_ALU_ROW(add)
+DEFINE_ALU_ROW(adc)
+DEFINE_ALU_ROW(sub)
+DEFINE_ALU_ROW(sbc)
+DEFINE_ALU_ROW(and)
+DEFINE_ALU_ROW(xor)
+DEFINE_ALU_ROW(or)
+DEFINE_ALU_ROW(cp)
+
+#define DEFINE_INC_DEC(unused, r) \
+    OP(inc_##r) { u8 v = GET_##r; alu_inc(cpu, &v); SET_##r(v); return 0; } \
+    OP(dec_##r) { u8 v = GET_##r; alu_dec(cpu, &v); SET_##r(v); return 0; }
+
+FOR_EACH_R8(DEFINE_INC_DEC, _)
+
+/* --- 16-bit Arithmetic --- */
+
+OP(inc_bc) { cpu->bc++; return 0; }
+OP(inc_de) { cpu->de++; return 0; }
+OP(inc_hl) { cpu->hl++; return 0; }
+OP(inc_sp) { cpu->sp++; return 0; }
+
+OP(dec_bc) { cpu->bc--; return 0; }
+OP(dec_de) { cpu->de--; return 0; }
+OP(dec_hl) { cpu->hl--; return 0; }
+OP(dec_sp) { cpu->sp--; return 0; }
+
+/* Z is untouched; H is the carry out of bit 11 */
+static void alu_add_hl(gb_cpu_t *cpu, u16 rr) {
+    u32 res = (u32)cpu->hl + rr;
+    cpu->flag_n = 0;
+    cpu->flag_h = (u8)((cpu->hl ^ rr ^ res) >> 8);
+    cpu->flag_c = (u8)(res >> 16);
+    cpu->hl = (u16)res;
+}
+
+OP(add_hl_bc) { alu_add_hl(cpu, CPU_GET_BC(cpu)); return 0; }
+OP(add_hl_de) { alu_add_hl(cpu, CPU_GET_DE(cpu)); return 0; }
+OP(add_hl_hl) { alu_add_hl(cpu, CPU_GET_HL(cpu)); return 0; }
+OP(add_hl_sp) { alu_add_hl(cpu, cpu->sp); return 0; }
+
+/* SP + signed immediate, shared by ADD SP,n and LD HL,SP+n */
+static u16 alu_sp_rel(gb_cpu_t *cpu, gb_mmu_t *mmu) {
+    u16 rel = (u16)(s8)fetch_u8(cpu, mmu);
+    u16 res = cpu->sp + rel;
+    u16 carries = cpu->sp ^ rel ^ res;  /* H/C come from the low byte add */
+    cpu->flag_z = 1;
+    cpu->flag_n = 0;
+    cpu->flag_h = (u8)carries;
+    cpu->flag_c = (carries >> 8) & 1;
+    return res;
+}
+
+OP(add_sp_r8)   { cpu->sp = alu_sp_rel(cpu, mmu); return 0; }
+OP(ld_hl_sp_r8) { CPU_SET_HL(cpu, alu_sp_rel(cpu, mmu)); return 0; }
+
+/* --- Control Flow --- */
+
+/*
+ * Idle-loop detection. Called after a taken backward branch with the CPU
+ * sitting at the loop head. The loop body (head up to the branch) is run
+ * twice on a scratch copy of the CPU; it qualifies if every instruction is
+ * a read of I/O or HRAM or an accumulator test, the branch is taken both
+ * times and the second pass leaves the registers exactly as the first did.
+ * Memory it reads only changes when the CPU writes it or a (non-audio)
+ * scheduler event fires, so every further pass is identical until then and
+ * the clock can jump in whole iterations to just short of that event or the
+ * run deadline. The registers are left as the skipped iterations would have
+ * left them. Returns the extra cycles to charge to the branch.
+ */
+#define CPU_IDLE_LOOP_MAX_BYTES 16
+#define CPU_IDLE_MAX_SKIP 0x10000000u
+
+static inline bool idle_loop_readable(u16 addr) {
+    if (addr < 0xFF00) return false;                    /* Only I/O, HRAM and IE */
+    if (addr == 0xFF00) return false;                   /* JOYP reads can end a run (GB_STOP_JOYPAD) */
+    if (addr == 0xFF04 || addr == 0xFF05) return false; /* DIV/TIMA count between events */
+    if (addr >= 0xFF10 && addr <= 0xFF3F) return false; /* APU, clocked by events we skip over */
+    return true;
+}
+
+/* Runs one pass from cpu->pc to the branch at `branch`. Returns the pass
+ * length in cycles, or 0 if the body does not qualify or the loop exits. */
+static u32 idle_loop_pass(gb_cpu_t *cpu, gb_mmu_t *mmu, u16 branch) {
+    u32 cycles = 0;
+    while (cpu->pc != branch) {
+        u16 pc = cpu->pc;
+        u16 addr;
+        u8 op = gb_mmu_read(mmu, pc);
+        switch (op) {
+            case 0xF0: /* LDH A,(a8) */
+                addr = 0xFF00 | gb_mmu_read(mmu, pc + 1);
+                if (!idle_loop_readable(addr)) return 0;
+                cpu->a = gb_mmu_read(mmu, addr);
+                cpu->pc += 2; cycles += 12;
+                break;
+            case 0xFA: /* LD A,(a16) */
+                addr = gb_mmu_read16(mmu, pc + 1);
+                if (!idle_loop_readable(addr)) return 0;
+                cpu->a = gb_mmu_read(mmu, addr);
+                cpu->pc += 3; cycles += 16;
+                break;
+            case 0xF2: /* LD A,(C) */
+            case 0x7E: /* LD A,(HL) */
+                addr = op == 0xF2 ? 0xFF00 | cpu->c : CPU_GET_HL(cpu);
+                if (!idle_loop_readable(addr)) return 0;
+                cpu->a = gb_mmu_read(mmu, addr);
+                cpu->pc += 1; cycles += 8;
+                break;
+            case 0xE6: alu_and(cpu, gb_mmu_read(mmu, pc + 1)); cpu->pc += 2; cycles += 8; break;
+            case 0xF6: alu_or(cpu, gb_mmu_read(mmu, pc + 1));  cpu->pc += 2; cycles += 8; break;
+            case 0xEE: alu_xor(cpu, gb_mmu_read(mmu, pc + 1)); cpu->pc += 2; cycles += 8; break;
+            case 0xFE: alu_cp(cpu, gb_mmu_read(mmu, pc + 1));  cpu->pc += 2; cycles += 8; break;
+            case 0xA7: alu_and(cpu, cpu->a); cpu->pc += 1; cycles += 4; break;
+            case 0xB7: alu_or(cpu, cpu->a);  cpu->pc += 1; cycles += 4; break;
+            case 0xCB: { /* BIT n,A */
+                u8 cb = gb_mmu_read(mmu, pc + 1);
+                if ((cb & 0xC7) != 0x47) return 0;
+                cb_bit(cpu, (cb >> 3) & 7, cpu->a);
+                cpu->pc += 2; cycles += 8;
+                break;
+            }
+            default:
+                return 0;
+        }
+        if ((u16)(cpu->pc - pc) > (u16)(branch - pc)) return 0; /* Overran the branch */
     }
 
-    if (opcode < 0x08) cb_rlc(cpu, reg);
-    else if (opcode < 0x10) cb_rrc(cpu, reg);
-    else if (opcode < 0x18) cb_rl(cpu, reg);
-    else if (opcode < 0x20) cb_rr(cpu, reg);
-    else if (opcode < 0x28) cb_sla(cpu, reg);
-    else if (opcode < 0x30) cb_sra(cpu, reg);
-    else if (opcode < 0x38) cb_swap(cpu, reg);
-    else if (opcode < 0x40) cb_srl(cpu, reg);
-    else if (opcode < 0x80) cb_bit(cpu, (opcode >> 3) & 0x07, *reg);
-    else if (opcode < 0xC0) *reg &= ~(1 << ((opcode >> 3) & 0x07)); // RES
-    else *reg |= (1 << ((opcode >> 3) & 0x07)); // SET
-
-    if (is_hl) {
-        gb_mmu_write(mmu, hl, hl_val);
+    u8 op = gb_mmu_read(mmu, branch);
+    bool taken;
+    switch ((op >> 3) & 3) { /* Condition field of JR cc / JP cc */
+        case 0:  taken = cpu->flag_z != 0; break;
+        case 1:  taken = cpu->flag_z == 0; break;
+        case 2:  taken = !cpu->flag_c; break;
+        default: taken = cpu->flag_c; break;
     }
-    
-    /* Cycle correction */
-    if (is_hl) {
-        // BIT (HL) is 12 cycles (4 fetch + 8 exec)
-        // Others (HL) are 16 cycles (4 fetch + 12 exec) 
-        // gb_cpu_step adds 4 base cycles.
-        if ((opcode & 0xC0) == 0x40) return 8; // BIT (HL) -> Total 12
-        return 12; // Others (HL) -> Total 16
+    if (op == 0x18 || op == 0xC3) taken = true;
+    if (!taken) return 0;
+    return cycles + (op < 0x40 ? 12 : 16);
+}
+
+static u32 cpu_idle_loop(gb_cpu_t *cpu, gb_mmu_t *mmu, u16 branch, u32 branch_cycles) {
+    gb_scheduler_t *sched = mmu->sched;
+    /* A trace has to record every pass, as a reference emulator would */
+    if (!gb_cpu_idle_loop.enabled || gb_cpu_breakpoints.count || gb_trace.ring ||
+        (u16)(branch - cpu->pc) > CPU_IDLE_LOOP_MAX_BYTES) {
+        return 0;
+    }
+    /* A pending interrupt is taken right after this branch */
+    if (cpu->ime && mmu->irq.pending) {
+        return 0;
+    }
+
+    /* The branch ends at `start`; the next pass must too finish before
+     * anything can change under it */
+    u64 start = sched->now + branch_cycles;
+    u64 target = MIN(gb_sched_next_of(sched, ~GB_SCHED_APU_EVENTS), sched->deadline);
+    if (target <= start) {
+        return 0;
     }
 
-    // Register CB ops are 8 cycles total (4 fetch + 4 exec)
-    return 4; 
+    gb_cpu_t first = *cpu;
+    u32 loop_cycles = idle_loop_pass(&first, mmu, branch);
+    if (loop_cycles == 0 || target - start <= loop_cycles) {
+        return 0;
+    }
+    gb_cpu_t second = first;
+    second.pc = cpu->pc;
+    if (idle_loop_pass(&second, mmu, branch) == 0 || second.a != first.a ||
+        second.flag_z != first.flag_z || second.flag_n != first.flag_n ||
+        second.flag_h != first.flag_h || second.flag_c != first.flag_c) {
+        return 0;
+    }
+
+    /* Whole passes that end strictly before the target */
+    u64 passes = MIN((target - start - 1) / loop_cycles, CPU_IDLE_MAX_SKIP / loop_cycles);
+    u32 skip = (u32)(passes * loop_cycles);
+
+    cpu->a = first.a;
+    cpu->flag_z = first.flag_z;
+    cpu->flag_n = first.flag_n;
+    cpu->flag_h = first.flag_h;
+    cpu->flag_c = first.flag_c;
+
+    gb_cpu_idle_loop.hits++;
+    gb_cpu_idle_loop.cycles += skip;
+    return skip;
 }
 
-u32 gb_cpu_step(gb_cpu_t *cpu, void *mmu_ptr) {
-    gb_mmu_t *mmu = (gb_mmu_t *)mmu_ptr;
-    
-    /* Handle suspended states */
+OP(jp_a16) {
+    u16 branch = cpu->pc - 1;
+    cpu->pc = fetch_u16(cpu, mmu);
+    if (cpu->pc <= branch) return cpu_idle_loop(cpu, mmu, branch, 16);
+    return 0;
+}
+OP(jp_hl)  { cpu->pc = CPU_GET_HL(cpu); return 0; }
+OP(jr_r8) {
+    u16 branch = cpu->pc - 1;
+    s8 rel = (s8)fetch_u8(cpu, mmu);
+    cpu->pc += rel;
+    if (rel < 0) return cpu_idle_loop(cpu, mmu, branch, 12);
+    return 0;
+}
+
+OP(call_a16) {
+    u16 dest = fetch_u16(cpu, mmu);
+    push16(cpu, mmu, cpu->pc);
+    cpu->pc = dest;
+    GB_PROF_CALL(mmu, dest, cpu->sp);
+    return 0;
+}
+
+OP(ret)  { cpu->pc = pop16(cpu, mmu); GB_PROF_RET(cpu->sp); return 0; }
+OP(reti) { cpu->pc = pop16(cpu, mmu); cpu->ime = true; GB_PROF_RET(cpu->sp); return 0; }
+
+#define DEFINE_BRANCHES(cc) \
+    OP(jr_##cc##_r8) { \
+        s8 rel = (s8)fetch_u8(cpu, mmu); \
+        if (COND_##cc) { \
+            cpu->pc += rel; \
+            if (rel < 0) return 4 + cpu_idle_loop(cpu, mmu, cpu->pc - rel - 2, 12); \
+            return 4; \
+        } \
+        return 0; \
+    } \
+    OP(jp_##cc##_a16) { \
+        if (COND_##cc) { \
+            u16 branch = cpu->pc - 1; \
+            cpu->pc = fetch_u16(cpu, mmu); \
+            if (cpu->pc <= branch) return 4 + cpu_idle_loop(cpu, mmu, branch, 16); \
+            return 4; \
+        } \
+        cpu->pc += 2; \
+        return 0; \
+    } \
+    OP(call_##cc##_a16) { \
+        u16 dest = fetch_u16(cpu, mmu); \
+        if (COND_##cc) { \
+            push16(cpu, mmu, cpu->pc); \
+            cpu->pc = dest; \
+            GB_PROF_CALL(mmu, dest, cpu->sp); \
+            return 12; \
+        } \
+        return 0; \
+    } \
+    OP(ret_##cc) { \
+        if (COND_##cc) { cpu->pc = pop16(cpu, mmu); GB_PROF_RET(cpu->sp); return 12; } \
+        return 0; \
+    }
+
+DEFINE_BRANCHES(nz)
+DEFINE_BRANCHES(z)
+DEFINE_BRANCHES(nc)
+DEFINE_BRANCHES(c)
+
+#define DEFINE_RST(vec) OP(rst_##vec) { \
+        push16(cpu, mmu, cpu->pc); \
+        cpu->pc = 0x##vec; \
+        GB_PROF_CALL(mmu, 0x##vec, cpu->sp); \
+        return 0; \
+    }
+
+DEFINE_RST(00)
+DEFINE_RST(08)
+DEFINE_RST(10)
+DEFINE_RST(18)
+DEFINE_RST(20)
+DEFINE_RST(28)
+DEFINE_RST(30)
+
+OP(rst_38) {
+    LOG_WARN(LOG_CPU, "RST 38 (0xFF) executed at PC 0x%04X, likely a crash", (u16)(cpu->pc - 1));
+    push16(cpu, mmu, cpu->pc);
+    cpu->pc = 0x38;
+    GB_PROF_CALL(mmu, 0x38, cpu->sp);
+    return 0;
+}
+
+/* --- Miscellaneous --- */
+
+OP(nop)     { return 0; }
+OP(illegal) { return 0; } /* Unused opcodes hang real hardware; treat as NOP */
+
+#if GB_ALU_TABLES
+OP(daa) {
+    u16 entry = gb_alu_daa[(cpu->flag_n << 10) | (CPU_FLAG_H(cpu) << 9) | (cpu->flag_c << 8) | cpu->a];
+    cpu->a = cpu->flag_z = (u8)entry;
+    cpu->flag_h = 0;
+    cpu->flag_c = entry >> 8;
+    return 0;
+}
+#else
+OP(daa) {
+    u8 correction = 0;
+    if (CPU_FLAG_H(cpu) || (!cpu->flag_n && (cpu->a & 0x0F) > 9)) {
+        correction |= 0x06;
+    }
+    if (cpu->flag_c || (!cpu->flag_n && cpu->a > 0x99)) {
+        correction |= 0x60;
+        cpu->flag_c = 1;
+    }
+    if (cpu->flag_n) {
+        cpu->a -= correction;
+    } else {
+        cpu->a += correction;
+    }
+    cpu->flag_z = cpu->a;
+    cpu->flag_h = 0;
+    return 0;
+}
+#endif
+
+OP(cpl) { cpu->a = ~cpu->a; cpu->flag_n = 1; cpu->flag_h = 0x10; return 0; }
+OP(scf) { cpu->flag_n = 0; cpu->flag_h = 0; cpu->flag_c = 1; return 0; }
+OP(ccf) { cpu->flag_n = 0; cpu->flag_h = 0; cpu->flag_c ^= 1; return 0; }
+
+OP(rlca) { cpu_rlca(cpu); return 0; }
+OP(rrca) { cpu_rrca(cpu); return 0; }
+OP(rla)  { cpu_rla(cpu); return 0; }
+OP(rra)  { cpu_rra(cpu); return 0; }
+
+OP(halt) {
+#if GB_HALT_BUG
+    if (!cpu->ime && mmu->irq.pending) {
+        // HALT bug: HALT mode not entered, next instruction executed twice
+        cpu->halt_bug = true;
+        return 0;
+    }
+#endif
+    cpu->halted = true;
+    return 0;
+}
+
+OP(stop) { cpu->stopped = true; fetch_u8(cpu, mmu); return 0; }
+OP(di)   { cpu->ime = false; cpu->ei_delay = false; return 0; }
+#if GB_EI_DELAY
+OP(ei)   { cpu->ei_delay = true; return 0; }
+#else
+OP(ei)   { cpu->ime = true; return 0; }
+#endif
+
+/* --- CB Prefix (Extended Instructions) --- */
+
+#define DEFINE_CB_SHIFT(op, r) CB_OP(op##_##r) { u8 v = GET_##r; cb_##op(cpu, &v); SET_##r(v); return 0; }
+#define DEFINE_CB_BIT(n, r)    CB_OP(bit##n##_##r) { cb_bit(cpu, n, GET_##r); return 0; }
+#define DEFINE_CB_RES(n, r)    CB_OP(res##n##_##r) { SET_##r(GET_##r & ~(1 << n)); return 0; }
+#define DEFINE_CB_SET(n, r)    CB_OP(set##n##_##r) { SET_##r(GET_##r | (1 << n)); return 0; }
+
+FOR_EACH_R8(DEFINE_CB_SHIFT, rlc)
+FOR_EACH_R8(DEFINE_CB_SHIFT, rrc)
+FOR_EACH_R8(DEFINE_CB_SHIFT, rl)
+FOR_EACH_R8(DEFINE_CB_SHIFT, rr)
+FOR_EACH_R8(DEFINE_CB_SHIFT, sla)
+FOR_EACH_R8(DEFINE_CB_SHIFT, sra)
+FOR_EACH_R8(DEFINE_CB_SHIFT, swap)
+FOR_EACH_R8(DEFINE_CB_SHIFT, srl)
+
+#define DEFINE_CB_BITOPS(n) \
+    FOR_EACH_R8(DEFINE_CB_BIT, n) FOR_EACH_R8(DEFINE_CB_RES, n) FOR_EACH_R8(DEFINE_CB_SET, n)
+
+DEFINE_CB_BITOPS(0)
+DEFINE_CB_BITOPS(1)
+DEFINE_CB_BITOPS(2)
+DEFINE_CB_BITOPS(3)
+DEFINE_CB_BITOPS(4)
+DEFINE_CB_BITOPS(5)
+DEFINE_CB_BITOPS(6)
+DEFINE_CB_BITOPS(7)
+
+/*
+ * Dispatch
+ *
+ * Native builds use computed goto: every opcode gets its own indirect jump
+ * site, which predicts far better than one shared switch. WebAssembly has no
+ * label addresses, so the WASM build uses a dense 0x00-0xFF switch that
+ * lowers to a single br_table.
+ */
+#if defined(__GNUC__) && !defined(__EMSCRIPTEN__)
+#define GB_CPU_COMPUTED_GOTO 1
+#else
+#define GB_CPU_COMPUTED_GOTO 0
+#endif
+
+static u32 gb_cpu_execute_cb(gb_cpu_t *cpu, gb_mmu_t *mmu) {
+    u8 opcode = fetch_u8(cpu, mmu);
+
+#if GB_CPU_COMPUTED_GOTO
+    static const void *const cb_dispatch[256] = {
+#define CB_LABEL(op, name, cyc) [op] = &&CB_L_##op,
+        GB_CPU_CB_TABLE(CB_LABEL)
+#undef CB_LABEL
+    };
+    goto *cb_dispatch[opcode];
+
+#define CB_HANDLER(op, name, cyc) CB_L_##op: return cyc + cb_op_##name(cpu, mmu);
+    GB_CPU_CB_TABLE(CB_HANDLER)
+#undef CB_HANDLER
+#else
+    switch (opcode) {
+#define CB_CASE(op, name, cyc) case op: return cyc + cb_op_##name(cpu, mmu);
+        GB_CPU_CB_TABLE(CB_CASE)
+#undef CB_CASE
+    }
+    return 0;
+#endif
+}
+
+OP(prefix_cb) { return gb_cpu_execute_cb(cpu, mmu); }
+
+/* Decode and execute `opcode`, leaving its cycle count in `cycles`.
+ * Expanded once per function that decodes; each expansion owns its label
+ * table, so gb_cpu_run() gets its own threaded dispatch. */
+#if GB_CPU_COMPUTED_GOTO
+#define OP_LABEL(op, name, cyc) [op] = &&L_##op,
+#define OP_HANDLER(op, name, cyc) L_##op: cycles = cyc + op_##name(cpu, mmu); goto done;
+#define CPU_EXECUTE(opcode) do { \
+        static const void *const dispatch[256] = { GB_CPU_OPCODE_TABLE(OP_LABEL) }; \
+        goto *dispatch[opcode]; \
+        GB_CPU_OPCODE_TABLE(OP_HANDLER) \
+    done:; \
+    } while (0)
+#else
+#define OP_CASE(op, name, cyc) case op: cycles = cyc + op_##name(cpu, mmu); break;
+#define CPU_EXECUTE(opcode) do { \
+        switch (opcode) { \
+            GB_CPU_OPCODE_TABLE(OP_CASE) \
+        } \
+    } while (0)
+#endif
+
+/* Returns true if the CPU is stopped or halted and should not fetch */
+static inline bool cpu_suspended(gb_cpu_t *cpu, gb_mmu_t *mmu) {
     if (cpu->stopped) {
         // STOP state is exited by a joypad interrupt (high-to-low transition on P1 bits)
         // For now, we'll implement a simple check: if any button is pressed (joypad interrupt pending), wake up.
         // In reality, it doesn't even need the interrupt enabled in IE, just the signal.
-        u8 if_reg = gb_mmu_read(mmu, 0xFF0F);
-        if (if_reg & 0x10) { // Joypad interrupt bit
+        if (mmu->irq.flags & GB_IRQ_JOYPAD) {
              cpu->stopped = false;
         } else {
-             return 4; // Burn cycles while stopped
+             return true; // Burn cycles while stopped
         }
     }
 
-    /* Handle halted state */
     if (cpu->halted) {
-        u8 ie = gb_mmu_read(mmu, 0xFFFF);
-        u8 if_reg = gb_mmu_read(mmu, 0xFF0F);
-        if (ie & if_reg) {
+        if (mmu->irq.pending) {
             cpu->halted = false;
         }
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * Cycles a sleeping CPU burns in gb_cpu_run(). While halted or stopped with
+ * no enabled interrupt pending nothing can wake it until a scheduler event
+ * raises IF (IE is only written by the CPU), so instead of looping 4 cycles
+ * at a time the clock jumps in whole 4-cycle steps to the first step at or
+ * past the next interrupt-capable event or the run deadline: the same step
+ * plain stepping would have woken on. Events passed on the way (APU, HDMA)
+ * are dispatched in order right after the jump.
+ */
+static inline u32 cpu_idle_cycles(gb_cpu_t *cpu, gb_mmu_t *mmu, const gb_scheduler_t *sched) {
+    if (!cpu->halted && !cpu->stopped) {
+        return 4; /* Woke up this step */
+    }
+    if (mmu->irq.pending) {
         return 4;
     }
-    
+
+    u64 target = MIN(gb_sched_next_irq(sched), sched->deadline);
+    if (target <= sched->now + 4) {
+        return 4;
+    }
+    u64 skip = (target - sched->now + 3) & ~(u64)3;
+    return skip < CPU_IDLE_MAX_SKIP ? (u32)skip : CPU_IDLE_MAX_SKIP;
+}
+
+static inline u8 cpu_fetch_opcode(gb_cpu_t *cpu, gb_mmu_t *mmu) {
+#if GB_EI_DELAY
     /* Handle EI delay */
     if (cpu->ei_delay) {
         cpu->ime = true;
         cpu->ei_delay = false;
     }
-    
-    /* Fetch instruction */
+#endif
+
+#if GB_HALT_BUG
     u16 old_pc = cpu->pc;
     u8 opcode = fetch_u8(cpu, mmu);
-    
+
     /* Halt bug:
      * If halt_bug triggered, the PC fails to increment for one instruction fetch.
      * Effectively, we re-execute the byte at the current PC.
@@ -355,583 +923,214 @@ u32 gb_cpu_step(gb_cpu_t *cpu, void *mmu_ptr) {
         cpu->halt_bug = false;
     }
 
-    u32 cycles = 4;
-    
-    /* Instruction decoder */
-    switch (opcode) {
-        case 0x00: // NOP
-            cycles = 4;
-            break;
+    return opcode;
+#else
+    return fetch_u8(cpu, mmu);
+#endif
+}
 
-        /* --- 8-bit Loads --- */
-        
-        // LD r, n
-        case 0x06: cpu->b = fetch_u8(cpu, mmu); cycles = 8; break; // LD B, n
-        case 0x0E: cpu->c = fetch_u8(cpu, mmu); cycles = 8; break; // LD C, n
-        case 0x16: cpu->d = fetch_u8(cpu, mmu); cycles = 8; break; // LD D, n
-        case 0x1E: cpu->e = fetch_u8(cpu, mmu); cycles = 8; break; // LD E, n
-        case 0x26: cpu->h = fetch_u8(cpu, mmu); cycles = 8; break; // LD H, n
-        case 0x2E: cpu->l = fetch_u8(cpu, mmu); cycles = 8; break; // LD L, n
-        case 0x3E: cpu->a = fetch_u8(cpu, mmu); cycles = 8; break; // LD A, n
-        case 0x36: gb_mmu_write(mmu, CPU_GET_HL(cpu), fetch_u8(cpu, mmu)); cycles = 12; break; // LD (HL), n
-
-        // LD r, r
-        case 0x7F: cpu->a = cpu->a; cycles = 4; break; // LD A, A
-        case 0x78: cpu->a = cpu->b; cycles = 4; break; // LD A, B
-        case 0x79: cpu->a = cpu->c; cycles = 4; break; // LD A, C
-        case 0x7A: cpu->a = cpu->d; cycles = 4; break; // LD A, D
-        case 0x7B: cpu->a = cpu->e; cycles = 4; break; // LD A, E
-        case 0x7C: cpu->a = cpu->h; cycles = 4; break; // LD A, H
-        case 0x7D: cpu->a = cpu->l; cycles = 4; break; // LD A, L
-        case 0x7E: cpu->a = gb_mmu_read(mmu, CPU_GET_HL(cpu)); cycles = 8; break; // LD A, (HL)
-
-        case 0x40: cpu->b = cpu->b; cycles = 4; break; // LD B, B
-        case 0x41: cpu->b = cpu->c; cycles = 4; break; // LD B, C
-        case 0x42: cpu->b = cpu->d; cycles = 4; break; // LD B, D
-        case 0x43: cpu->b = cpu->e; cycles = 4; break; // LD B, E
-        case 0x44: cpu->b = cpu->h; cycles = 4; break; // LD B, H
-        case 0x45: cpu->b = cpu->l; cycles = 4; break; // LD B, L
-        case 0x46: cpu->b = gb_mmu_read(mmu, CPU_GET_HL(cpu)); cycles = 8; break; // LD B, (HL)
-        case 0x47: cpu->b = cpu->a; cycles = 4; break; // LD B, A
-
-        case 0x48: cpu->c = cpu->b; cycles = 4; break; // LD C, B
-        case 0x49: cpu->c = cpu->c; cycles = 4; break; // LD C, C
-        case 0x4A: cpu->c = cpu->d; cycles = 4; break; // LD C, D
-        case 0x4B: cpu->c = cpu->e; cycles = 4; break; // LD C, E
-        case 0x4C: cpu->c = cpu->h; cycles = 4; break; // LD C, H
-        case 0x4D: cpu->c = cpu->l; cycles = 4; break; // LD C, L
-        case 0x4E: cpu->c = gb_mmu_read(mmu, CPU_GET_HL(cpu)); cycles = 8; break; // LD C, (HL)
-        case 0x4F: cpu->c = cpu->a; cycles = 4; break; // LD C, A
-
-        case 0x50: cpu->d = cpu->b; cycles = 4; break; // LD D, B
-        case 0x51: cpu->d = cpu->c; cycles = 4; break; // LD D, C
-        case 0x52: cpu->d = cpu->d; cycles = 4; break; // LD D, D
-        case 0x53: cpu->d = cpu->e; cycles = 4; break; // LD D, E
-        case 0x54: cpu->d = cpu->h; cycles = 4; break; // LD D, H
-        case 0x55: cpu->d = cpu->l; cycles = 4; break; // LD D, L
-        case 0x56: cpu->d = gb_mmu_read(mmu, CPU_GET_HL(cpu)); cycles = 8; break; // LD D, (HL)
-        case 0x57: cpu->d = cpu->a; cycles = 4; break; // LD D, A
-
-        case 0x58: cpu->e = cpu->b; cycles = 4; break; // LD E, B
-        case 0x59: cpu->e = cpu->c; cycles = 4; break; // LD E, C
-        case 0x5A: cpu->e = cpu->d; cycles = 4; break; // LD E, D
-        case 0x5B: cpu->e = cpu->e; cycles = 4; break; // LD E, E
-        case 0x5C: cpu->e = cpu->h; cycles = 4; break; // LD E, H
-        case 0x5D: cpu->e = cpu->l; cycles = 4; break; // LD E, L
-        case 0x5E: cpu->e = gb_mmu_read(mmu, CPU_GET_HL(cpu)); cycles = 8; break; // LD E, (HL)
-        case 0x5F: cpu->e = cpu->a; cycles = 4; break; // LD E, A
-
-        case 0x60: cpu->h = cpu->b; cycles = 4; break; // LD H, B
-        case 0x61: cpu->h = cpu->c; cycles = 4; break; // LD H, C
-        case 0x62: cpu->h = cpu->d; cycles = 4; break; // LD H, D
-        case 0x63: cpu->h = cpu->e; cycles = 4; break; // LD H, E
-        case 0x64: cpu->h = cpu->h; cycles = 4; break; // LD H, H
-        case 0x65: cpu->h = cpu->l; cycles = 4; break; // LD H, L
-        case 0x66: cpu->h = gb_mmu_read(mmu, CPU_GET_HL(cpu)); cycles = 8; break; // LD H, (HL)
-        case 0x67: cpu->h = cpu->a; cycles = 4; break; // LD H, A
-
-        case 0x68: cpu->l = cpu->b; cycles = 4; break; // LD L, B
-        case 0x69: cpu->l = cpu->c; cycles = 4; break; // LD L, C
-        case 0x6A: cpu->l = cpu->d; cycles = 4; break; // LD L, D
-        case 0x6B: cpu->l = cpu->e; cycles = 4; break; // LD L, E
-        case 0x6C: cpu->l = cpu->h; cycles = 4; break; // LD L, H
-        case 0x6D: cpu->l = cpu->l; cycles = 4; break; // LD L, L
-        case 0x6E: cpu->l = gb_mmu_read(mmu, CPU_GET_HL(cpu)); cycles = 8; break; // LD L, (HL)
-        case 0x6F: cpu->l = cpu->a; cycles = 4; break; // LD L, A
-
-        case 0x70: gb_mmu_write(mmu, CPU_GET_HL(cpu), cpu->b); cycles = 8; break; // LD (HL), B
-        case 0x71: gb_mmu_write(mmu, CPU_GET_HL(cpu), cpu->c); cycles = 8; break; // LD (HL), C
-        case 0x72: gb_mmu_write(mmu, CPU_GET_HL(cpu), cpu->d); cycles = 8; break; // LD (HL), D
-        case 0x73: gb_mmu_write(mmu, CPU_GET_HL(cpu), cpu->e); cycles = 8; break; // LD (HL), E
-        case 0x74: gb_mmu_write(mmu, CPU_GET_HL(cpu), cpu->h); cycles = 8; break; // LD (HL), H
-        case 0x75: gb_mmu_write(mmu, CPU_GET_HL(cpu), cpu->l); cycles = 8; break; // LD (HL), L
-        case 0x77: gb_mmu_write(mmu, CPU_GET_HL(cpu), cpu->a); cycles = 8; break; // LD (HL), A
-
-        // LD A, (nn) / (nn), A
-        case 0xFA: cpu->a = gb_mmu_read(mmu, fetch_u16(cpu, mmu)); cycles = 16; break; // LD A, (nn)
-        case 0xEA: gb_mmu_write(mmu, fetch_u16(cpu, mmu), cpu->a); cycles = 16; break; // LD (nn), A
-
-        // LDH (FF00+n), A / LDH A, (FF00+n)
-        case 0xE0: gb_mmu_write(mmu, 0xFF00 + fetch_u8(cpu, mmu), cpu->a); cycles = 12; break; // LDH (n), A
-        case 0xF0: cpu->a = gb_mmu_read(mmu, 0xFF00 + fetch_u8(cpu, mmu)); cycles = 12; break; // LDH A, (n)
-
-        // LD (BC), A / LD (DE), A / LD A, (BC) / LD A, (DE)
-        case 0x02: gb_mmu_write(mmu, CPU_GET_BC(cpu), cpu->a); cycles = 8; break;
-        case 0x12: gb_mmu_write(mmu, CPU_GET_DE(cpu), cpu->a); cycles = 8; break;
-        case 0x0A: cpu->a = gb_mmu_read(mmu, CPU_GET_BC(cpu)); cycles = 8; break;
-        case 0x1A: cpu->a = gb_mmu_read(mmu, CPU_GET_DE(cpu)); cycles = 8; break;
-
-        // LD (HL+), A / LD (HL-), A / LD A, (HL+) / LD A, (HL-)
-        case 0x22: 
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            gb_mmu_write(mmu, hl++, cpu->a);
-            CPU_SET_HL(cpu, hl);
-            cycles = 8;
-            break;
-        }
-        case 0x32:
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            gb_mmu_write(mmu, hl--, cpu->a);
-            CPU_SET_HL(cpu, hl);
-            cycles = 8;
-            break;
-        }
-        case 0x2A:
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            cpu->a = gb_mmu_read(mmu, hl++);
-            CPU_SET_HL(cpu, hl);
-            cycles = 8;
-            break;
-        }
-        case 0x3A:
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            cpu->a = gb_mmu_read(mmu, hl--);
-            CPU_SET_HL(cpu, hl);
-            cycles = 8;
-            break;
+/* True if the run should stop before executing the instruction at PC */
+static bool cpu_breakpoint(gb_cpu_t *cpu, gb_scheduler_t *sched) {
+    if (!(sched->stop_mask & GB_STOP_BREAKPOINT)) {
+        return false;
+    }
+    if (gb_cpu_breakpoints.resume) {
+        gb_cpu_breakpoints.resume = false;
+        if (cpu->pc == gb_cpu_breakpoints.resume_pc) {
+            return false;
         }
-
-        /* --- 16-bit Loads --- */
-
-        case 0x01: CPU_SET_BC(cpu, fetch_u16(cpu, mmu)); cycles = 12; break; // LD BC, nn
-        case 0x11: CPU_SET_DE(cpu, fetch_u16(cpu, mmu)); cycles = 12; break; // LD DE, nn
-        case 0x21: CPU_SET_HL(cpu, fetch_u16(cpu, mmu)); cycles = 12; break; // LD HL, nn
-        case 0x31: cpu->sp = fetch_u16(cpu, mmu); cycles = 12; break;         // LD SP, nn
-        case 0x08: gb_mmu_write16(mmu, fetch_u16(cpu, mmu), cpu->sp); cycles = 20; break; // LD (nn), SP
-
-        case 0xF9: cpu->sp = CPU_GET_HL(cpu); cycles = 8; break; // LD SP, HL
-
-        /* --- 8-bit Arithmetic/Logic --- */
-
-        // ADD A, r
-        case 0x87: alu_add(cpu, cpu->a); cycles = 4; break;
-        case 0x80: alu_add(cpu, cpu->b); cycles = 4; break;
-        case 0x81: alu_add(cpu, cpu->c); cycles = 4; break;
-        case 0x82: alu_add(cpu, cpu->d); cycles = 4; break;
-        case 0x83: alu_add(cpu, cpu->e); cycles = 4; break;
-        case 0x84: alu_add(cpu, cpu->h); cycles = 4; break;
-        case 0x85: alu_add(cpu, cpu->l); cycles = 4; break;
-        case 0x86: alu_add(cpu, gb_mmu_read(mmu, CPU_GET_HL(cpu))); cycles = 8; break;
-        case 0xC6: alu_add(cpu, fetch_u8(cpu, mmu)); cycles = 8; break; // ADD A, n
-
-        // ADC A, r
-        case 0x8F: alu_adc(cpu, cpu->a); cycles = 4; break;
-        case 0x88: alu_adc(cpu, cpu->b); cycles = 4; break;
-        case 0x89: alu_adc(cpu, cpu->c); cycles = 4; break;
-        case 0x8A: alu_adc(cpu, cpu->d); cycles = 4; break;
-        case 0x8B: alu_adc(cpu, cpu->e); cycles = 4; break;
-        case 0x8C: alu_adc(cpu, cpu->h); cycles = 4; break;
-        case 0x8D: alu_adc(cpu, cpu->l); cycles = 4; break;
-        case 0x8E: alu_adc(cpu, gb_mmu_read(mmu, CPU_GET_HL(cpu))); cycles = 8; break;
-        case 0xCE: alu_adc(cpu, fetch_u8(cpu, mmu)); cycles = 8; break; // ADC A, n
-
-        // SUB r
-        case 0x97: alu_sub(cpu, cpu->a); cycles = 4; break;
-        case 0x90: alu_sub(cpu, cpu->b); cycles = 4; break;
-        case 0x91: alu_sub(cpu, cpu->c); cycles = 4; break;
-        case 0x92: alu_sub(cpu, cpu->d); cycles = 4; break;
-        case 0x93: alu_sub(cpu, cpu->e); cycles = 4; break;
-        case 0x94: alu_sub(cpu, cpu->h); cycles = 4; break;
-        case 0x95: alu_sub(cpu, cpu->l); cycles = 4; break;
-        case 0x96: alu_sub(cpu, gb_mmu_read(mmu, CPU_GET_HL(cpu))); cycles = 8; break;
-        case 0xD6: alu_sub(cpu, fetch_u8(cpu, mmu)); cycles = 8; break; // SUB n
-
-        // SBC A, r
-        case 0x9F: alu_sbc(cpu, cpu->a); cycles = 4; break;
-        case 0x98: alu_sbc(cpu, cpu->b); cycles = 4; break;
-        case 0x99: alu_sbc(cpu, cpu->c); cycles = 4; break;
-        case 0x9A: alu_sbc(cpu, cpu->d); cycles = 4; break;
-        case 0x9B: alu_sbc(cpu, cpu->e); cycles = 4; break;
-        case 0x9C: alu_sbc(cpu, cpu->h); cycles = 4; break;
-        case 0x9D: alu_sbc(cpu, cpu->l); cycles = 4; break;
-        case 0x9E: alu_sbc(cpu, gb_mmu_read(mmu, CPU_GET_HL(cpu))); cycles = 8; break;
-        case 0xDE: alu_sbc(cpu, fetch_u8(cpu, mmu)); cycles = 8; break; // SBC A, n
-
-        // AND r
-        case 0xA7: alu_and(cpu, cpu->a); cycles = 4; break;
-        case 0xA0: alu_and(cpu, cpu->b); cycles = 4; break;
-        case 0xA1: alu_and(cpu, cpu->c); cycles = 4; break;
-        case 0xA2: alu_and(cpu, cpu->d); cycles = 4; break;
-        case 0xA3: alu_and(cpu, cpu->e); cycles = 4; break;
-        case 0xA4: alu_and(cpu, cpu->h); cycles = 4; break;
-        case 0xA5: alu_and(cpu, cpu->l); cycles = 4; break;
-        case 0xA6: alu_and(cpu, gb_mmu_read(mmu, CPU_GET_HL(cpu))); cycles = 8; break;
-        case 0xE6: alu_and(cpu, fetch_u8(cpu, mmu)); cycles = 8; break; // AND n
-
-        // XOR r
-        case 0xAF: alu_xor(cpu, cpu->a); cycles = 4; break;
-        case 0xA8: alu_xor(cpu, cpu->b); cycles = 4; break;
-        case 0xA9: alu_xor(cpu, cpu->c); cycles = 4; break;
-        case 0xAA: alu_xor(cpu, cpu->d); cycles = 4; break;
-        case 0xAB: alu_xor(cpu, cpu->e); cycles = 4; break;
-        case 0xAC: alu_xor(cpu, cpu->h); cycles = 4; break;
-        case 0xAD: alu_xor(cpu, cpu->l); cycles = 4; break;
-        case 0xAE: alu_xor(cpu, gb_mmu_read(mmu, CPU_GET_HL(cpu))); cycles = 8; break;
-        case 0xEE: alu_xor(cpu, fetch_u8(cpu, mmu)); cycles = 8; break; // XOR n
-
-        // OR r
-        case 0xB7: alu_or(cpu, cpu->a); cycles = 4; break;
-        case 0xB0: alu_or(cpu, cpu->b); cycles = 4; break;
-        case 0xB1: alu_or(cpu, cpu->c); cycles = 4; break;
-        case 0xB2: alu_or(cpu, cpu->d); cycles = 4; break;
-        case 0xB3: alu_or(cpu, cpu->e); cycles = 4; break;
-        case 0xB4: alu_or(cpu, cpu->h); cycles = 4; break;
-        case 0xB5: alu_or(cpu, cpu->l); cycles = 4; break;
-        case 0xB6: alu_or(cpu, gb_mmu_read(mmu, CPU_GET_HL(cpu))); cycles = 8; break;
-        case 0xF6: alu_or(cpu, fetch_u8(cpu, mmu)); cycles = 8; break; // OR n
-
-        // CP r
-        case 0xBF: alu_cp(cpu, cpu->a); cycles = 4; break;
-        case 0xB8: alu_cp(cpu, cpu->b); cycles = 4; break;
-        case 0xB9: alu_cp(cpu, cpu->c); cycles = 4; break;
-        case 0xBA: alu_cp(cpu, cpu->d); cycles = 4; break;
-        case 0xBB: alu_cp(cpu, cpu->e); cycles = 4; break;
-        case 0xBC: alu_cp(cpu, cpu->h); cycles = 4; break;
-        case 0xBD: alu_cp(cpu, cpu->l); cycles = 4; break;
-        case 0xBE: alu_cp(cpu, gb_mmu_read(mmu, CPU_GET_HL(cpu))); cycles = 8; break;
-        case 0xFE: alu_cp(cpu, fetch_u8(cpu, mmu)); cycles = 8; break; // CP n
-
-        // INC r
-        case 0x3C: alu_inc(cpu, &cpu->a); cycles = 4; break;
-        case 0x04: alu_inc(cpu, &cpu->b); cycles = 4; break;
-        case 0x0C: alu_inc(cpu, &cpu->c); cycles = 4; break;
-        case 0x14: alu_inc(cpu, &cpu->d); cycles = 4; break;
-        case 0x1C: alu_inc(cpu, &cpu->e); cycles = 4; break;
-        case 0x24: alu_inc(cpu, &cpu->h); cycles = 4; break;
-        case 0x2C: alu_inc(cpu, &cpu->l); cycles = 4; break;
-        case 0x34: 
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            u8 val = gb_mmu_read(mmu, hl);
-            alu_inc(cpu, &val);
-            gb_mmu_write(mmu, hl, val);
-            cycles = 12;
-            break;
+    }
+    for (u8 i = 0; i < gb_cpu_breakpoints.count; i++) {
+        if (gb_cpu_breakpoints.addr[i] == cpu->pc) {
+            gb_cpu_breakpoints.resume = true;
+            gb_cpu_breakpoints.resume_pc = cpu->pc;
+            sched->stop_reason |= GB_STOP_BREAKPOINT;
+            return true;
         }
+    }
+    return false;
+}
 
-        // DEC r
-        case 0x3D: alu_dec(cpu, &cpu->a); cycles = 4; break;
-        case 0x05: alu_dec(cpu, &cpu->b); cycles = 4; break;
-        case 0x0D: alu_dec(cpu, &cpu->c); cycles = 4; break;
-        case 0x15: alu_dec(cpu, &cpu->d); cycles = 4; break;
-        case 0x1D: alu_dec(cpu, &cpu->e); cycles = 4; break;
-        case 0x25: alu_dec(cpu, &cpu->h); cycles = 4; break;
-        case 0x2D: alu_dec(cpu, &cpu->l); cycles = 4; break;
-        case 0x35:
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            u8 val = gb_mmu_read(mmu, hl);
-            alu_dec(cpu, &val);
-            gb_mmu_write(mmu, hl, val);
-            cycles = 12;
-            break;
-        }
+/* True when the full tail cpu_run_block() runs after an instruction would
+ * do nothing: no interrupt pending, no event or deadline due at `now` and
+ * the block still valid and mapped */
+static inline bool cpu_block_quiet(const gb_mmu_t *mmu, const gb_scheduler_t *sched,
+                                   const gb_block_t *block, u64 now) {
+    return !mmu->irq.pending && now < sched->next && now < sched->deadline &&
+           block->gen == gb_block_cache.page_gen[block->page] &&
+           mmu->read_page[block->page] == block->base;
+}
 
-        /* --- 16-bit Arithmetic --- */
-
-        // INC rr
-        case 0x03: CPU_SET_BC(cpu, CPU_GET_BC(cpu) + 1); cycles = 8; break;
-        case 0x13: CPU_SET_DE(cpu, CPU_GET_DE(cpu) + 1); cycles = 8; break;
-        case 0x23: CPU_SET_HL(cpu, CPU_GET_HL(cpu) + 1); cycles = 8; break;
-        case 0x33: cpu->sp++; cycles = 8; break;
-
-        // DEC rr
-        case 0x0B: CPU_SET_BC(cpu, CPU_GET_BC(cpu) - 1); cycles = 8; break;
-        case 0x1B: CPU_SET_DE(cpu, CPU_GET_DE(cpu) - 1); cycles = 8; break;
-        case 0x2B: CPU_SET_HL(cpu, CPU_GET_HL(cpu) - 1); cycles = 8; break;
-        case 0x3B: cpu->sp--; cycles = 8; break;
-
-        // ADD HL, rr
-        case 0x09: 
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            u16 rr = CPU_GET_BC(cpu);
-            CPU_CLEAR_FLAG(cpu, FLAG_N);
-            if ((hl & 0x0FFF) + (rr & 0x0FFF) > 0x0FFF) CPU_SET_FLAG(cpu, FLAG_H);
-            if ((u32)hl + rr > 0xFFFF) CPU_SET_FLAG(cpu, FLAG_C);
-            CPU_SET_HL(cpu, hl + rr);
-            cycles = 8;
-            break;
-        }
-        case 0x19:
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            u16 rr = CPU_GET_DE(cpu);
-            CPU_CLEAR_FLAG(cpu, FLAG_N);
-            if ((hl & 0x0FFF) + (rr & 0x0FFF) > 0x0FFF) CPU_SET_FLAG(cpu, FLAG_H);
-            if ((u32)hl + rr > 0xFFFF) CPU_SET_FLAG(cpu, FLAG_C);
-            CPU_SET_HL(cpu, hl + rr);
-            cycles = 8;
-            break;
-        }
-        case 0x29:
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            u16 rr = CPU_GET_HL(cpu);
-            CPU_CLEAR_FLAG(cpu, FLAG_N);
-            if ((hl & 0x0FFF) + (rr & 0x0FFF) > 0x0FFF) CPU_SET_FLAG(cpu, FLAG_H);
-            if ((u32)hl + rr > 0xFFFF) CPU_SET_FLAG(cpu, FLAG_C);
-            CPU_SET_HL(cpu, hl + rr);
-            cycles = 8;
-            break;
-        }
-        case 0x39:
-        {
-            u16 hl = CPU_GET_HL(cpu);
-            u16 rr = cpu->sp;
-            CPU_CLEAR_FLAG(cpu, FLAG_N);
-            if ((hl & 0x0FFF) + (rr & 0x0FFF) > 0x0FFF) CPU_SET_FLAG(cpu, FLAG_H);
-            if ((u32)hl + rr > 0xFFFF) CPU_SET_FLAG(cpu, FLAG_C);
-            CPU_SET_HL(cpu, hl + rr);
-            cycles = 8;
-            break;
+/* Superinstruction: the pair's first handler, then, if nothing would happen
+ * between the two, the second one in the same dispatch. `cycles` ends up
+ * with the cost of whichever instruction ran last and `op`/`pc` point at
+ * it, so the tail in cpu_run_block() treats it like any other. */
+#define FUSED_CASE(id, op1, name1, cyc1, op2, name2, cyc2) \
+    case id: \
+        cycles = cyc1 + op_##name1(cpu, mmu); \
+        if (cpu_block_quiet(mmu, sched, block, sched->now + cycles)) { \
+            FUSED_COUNT(); \
+            sched->now += cycles; \
+            pc += op->length; \
+            op++; \
+            cpu->pc = pc + 1; \
+            limit = MIN(sched->next, sched->deadline); \
+            cycles = cyc2 + op_##name2(cpu, mmu); \
+        } \
+        break;
+
+#ifdef GB_BENCH
+#define FUSED_COUNT() gb_cpu_instructions++
+#else
+#define FUSED_COUNT() ((void)0)
+#endif
+
+/*
+ * Run a translated block (block.h) with the same per-instruction semantics
+ * as gb_cpu_run(). An instruction that neither touches memory nor ends the
+ * block cannot raise an interrupt, reschedule an event or end the run, so
+ * while no interrupt is pending and the clock is short of the next event
+ * and the deadline, it skips the event and interrupt checks entirely.
+ * Everything else goes through the full sequence. Returns early when an
+ * interrupt was taken, the run must end or a write invalidated or banked
+ * out the rest of the block.
+ *
+ * A fused pair (op->fuse) runs both instructions in one handler when the
+ * boundary between them is quiet, and falls back to the tail otherwise.
+ *
+ * With GB_JIT the leading register-only run may be compiled: when the
+ * whole run ends short of the limit, every instruction in it would have
+ * taken the fast path, so one call replaces them all.
+ */
+static void cpu_run_block(gb_cpu_t *cpu, gb_mmu_t *mmu, gb_scheduler_t *sched, gb_block_t *block) {
+    const gb_block_op_t *op = block->ops;
+    u16 pc = block->pc;
+    u64 limit = mmu->irq.pending ? 0 : MIN(sched->next, sched->deadline);
+
+#if GB_JIT
+    if (block->jit_ops >= GB_JIT_MIN_OPS && gb_block_cache.jit) {
+        if (!block->jit) {
+            if (block->heat < GB_JIT_THRESHOLD && ++block->heat == GB_JIT_THRESHOLD) {
+                gb_block_compile(block);
+            }
+        } else if (sched->now + block->jit_cycles < limit) {
+            block->jit(cpu);
+            sched->now += block->jit_cycles;
+            pc += block->jit_bytes;
+            op += block->jit_ops;
+#ifdef GB_BENCH
+            gb_cpu_instructions += block->jit_ops;
+#endif
         }
-
-        case 0xE8: // ADD SP, n
-        {
-            s8 rel = (s8)fetch_u8(cpu, mmu);
-            cpu->f = 0;
-            if ((cpu->sp & 0xF) + (rel & 0xF) > 0xF) CPU_SET_FLAG(cpu, FLAG_H);
-            if ((cpu->sp & 0xFF) + (rel & 0xFF) > 0xFF) CPU_SET_FLAG(cpu, FLAG_C);
-            cpu->sp += rel;
-            cycles = 16;
-            break;
+    }
+#endif
+
+    for (;;) {
+        u32 cycles;
+        cpu->pc = pc + 1; /* Handlers fetch their operands from here */
+        if (op->fuse) {
+            switch (op->fuse) {
+                GB_CPU_FUSION_TABLE(FUSED_CASE)
+                default: /* fusion_id() (block.c) only hands out table ids */
+                    __builtin_unreachable();
+            }
+        } else {
+            CPU_EXECUTE(op->opcode);
         }
-
-        case 0xF8: // LD HL, SP+n
-        {
-            s8 rel = (s8)fetch_u8(cpu, mmu);
-            cpu->f = 0;
-            if ((cpu->sp & 0xF) + (rel & 0xF) > 0xF) CPU_SET_FLAG(cpu, FLAG_H);
-            if ((cpu->sp & 0xFF) + (rel & 0xFF) > 0xFF) CPU_SET_FLAG(cpu, FLAG_C);
-            CPU_SET_HL(cpu, cpu->sp + rel);
-            cycles = 12;
-            break;
+#ifdef GB_BENCH
+        gb_cpu_instructions++;
+#endif
+        sched->now += cycles;
+        pc += op->length;
+
+        if (!(op->flags & (GB_CPU_OP_MEM | GB_CPU_OP_END)) && sched->now < limit) {
+            op++;
+            continue;
         }
 
-        /* --- Stack Operations --- */
-
-        case 0xC5: push16(cpu, mmu, CPU_GET_BC(cpu)); cycles = 16; break; // PUSH BC
-        case 0xD5: push16(cpu, mmu, CPU_GET_DE(cpu)); cycles = 16; break; // PUSH DE
-        case 0xE5: push16(cpu, mmu, CPU_GET_HL(cpu)); cycles = 16; break; // PUSH HL
-        case 0xF5: push16(cpu, mmu, CPU_GET_AF(cpu)); cycles = 16; break; // PUSH AF
-
-        case 0xC1: CPU_SET_BC(cpu, pop16(cpu, mmu)); cycles = 12; break; // POP BC
-        case 0xD1: CPU_SET_DE(cpu, pop16(cpu, mmu)); cycles = 12; break; // POP DE
-        case 0xE1: CPU_SET_HL(cpu, pop16(cpu, mmu)); cycles = 12; break; // POP HL
-        case 0xF1: CPU_SET_AF(cpu, pop16(cpu, mmu)); cycles = 12; break; // POP AF
-
-        /* --- Control Flow --- */
-
-        case 0xC3: // JP nn
-            cpu->pc = fetch_u16(cpu, mmu);
-            cycles = 16;
-            break;
-
-        case 0xC2: if (!CPU_GET_FLAG(cpu, FLAG_Z)) { cpu->pc = fetch_u16(cpu, mmu); cycles = 16; } else { cpu->pc += 2; cycles = 12; } break; // JP NZ, nn
-        case 0xCA: if (CPU_GET_FLAG(cpu, FLAG_Z)) { cpu->pc = fetch_u16(cpu, mmu); cycles = 16; } else { cpu->pc += 2; cycles = 12; } break; // JP Z, nn
-        case 0xD2: if (!CPU_GET_FLAG(cpu, FLAG_C)) { cpu->pc = fetch_u16(cpu, mmu); cycles = 16; } else { cpu->pc += 2; cycles = 12; } break; // JP NC, nn
-        case 0xDA: if (CPU_GET_FLAG(cpu, FLAG_C)) { cpu->pc = fetch_u16(cpu, mmu); cycles = 16; } else { cpu->pc += 2; cycles = 12; } break; // JP C, nn
-
-        case 0xE9: cpu->pc = CPU_GET_HL(cpu); cycles = 4; break; // JP (HL)
-
-        // JR n
-        case 0x18: 
-        {
-            s8 rel = (s8)fetch_u8(cpu, mmu);
-            cpu->pc += rel;
-            cycles = 12;
-            break;
-        }
-        case 0x20: // JR NZ, n
-        {
-            s8 rel = (s8)fetch_u8(cpu, mmu);
-            if (!CPU_GET_FLAG(cpu, FLAG_Z)) { cpu->pc += rel; cycles = 12; } else { cycles = 8; }
-            break;
+#if GB_EVENT_CATCH_UP
+        if (sched->now >= sched->next) {
+            gb_sched_dispatch(sched, mmu);
         }
-        case 0x28: // JR Z, n
-        {
-            s8 rel = (s8)fetch_u8(cpu, mmu);
-            if (CPU_GET_FLAG(cpu, FLAG_Z)) { cpu->pc += rel; cycles = 12; } else { cycles = 8; }
-            break;
+#endif
+        sched->now += gb_cpu_handle_interrupts(cpu, mmu);
+
+        /* An MBC or SVBK/VBK write may have banked the block out */
+        if ((op->flags & GB_CPU_OP_END) || cpu->pc != pc ||
+            block->gen != gb_block_cache.page_gen[block->page] ||
+            mmu->read_page[block->page] != block->base) {
+            return;
         }
-        case 0x30: // JR NC, n
-        {
-            s8 rel = (s8)fetch_u8(cpu, mmu);
-            if (!CPU_GET_FLAG(cpu, FLAG_C)) { cpu->pc += rel; cycles = 12; } else { cycles = 8; }
-            break;
+        op++;
+        if (sched->now >= sched->next) {
+            gb_sched_dispatch(sched, mmu);
         }
-        case 0x38: // JR C, n
-        {
-            s8 rel = (s8)fetch_u8(cpu, mmu);
-            if (CPU_GET_FLAG(cpu, FLAG_C)) { cpu->pc += rel; cycles = 12; } else { cycles = 8; }
-            break;
+        if (sched->now >= sched->deadline) {
+            return;
         }
+        limit = mmu->irq.pending ? 0 : MIN(sched->next, sched->deadline);
+    }
+}
 
-        // CALL nn
-        case 0xCD:
-        {
-            u16 dest = fetch_u16(cpu, mmu);
-            push16(cpu, mmu, cpu->pc);
-            cpu->pc = dest;
-            cycles = 24;
-            break;
-        }
-        case 0xC4: // CALL NZ, nn
-        {
-            u16 dest = fetch_u16(cpu, mmu);
-            if (!CPU_GET_FLAG(cpu, FLAG_Z)) { push16(cpu, mmu, cpu->pc); cpu->pc = dest; cycles = 24; } else { cycles = 12; }
-            break;
-        }
-        case 0xCC: // CALL Z, nn
-        {
-            u16 dest = fetch_u16(cpu, mmu);
-            if (CPU_GET_FLAG(cpu, FLAG_Z)) { push16(cpu, mmu, cpu->pc); cpu->pc = dest; cycles = 24; } else { cycles = 12; }
-            break;
-        }
-        case 0xD4: // CALL NC, nn
-        {
-            u16 dest = fetch_u16(cpu, mmu);
-            if (!CPU_GET_FLAG(cpu, FLAG_C)) { push16(cpu, mmu, cpu->pc); cpu->pc = dest; cycles = 24; } else { cycles = 12; }
-            break;
+void gb_cpu_run(gb_cpu_t *cpu, void *mmu_ptr, gb_scheduler_t *sched) {
+    gb_mmu_t *mmu = (gb_mmu_t *)mmu_ptr;
+
+    for (;;) {
+        /* Events that fell due during the last interrupt dispatch */
+        if (sched->now >= sched->next) {
+            gb_sched_dispatch(sched, mmu);
         }
-        case 0xDC: // CALL C, nn
-        {
-            u16 dest = fetch_u16(cpu, mmu);
-            if (CPU_GET_FLAG(cpu, FLAG_C)) { push16(cpu, mmu, cpu->pc); cpu->pc = dest; cycles = 24; } else { cycles = 12; }
+        if (sched->now >= sched->deadline) {
             break;
         }
 
-        // RET
-        case 0xC9: cpu->pc = pop16(cpu, mmu); cycles = 16; break;
-        case 0xC0: if (!CPU_GET_FLAG(cpu, FLAG_Z)) { cpu->pc = pop16(cpu, mmu); cycles = 20; } else { cycles = 8; } break; // RET NZ
-        case 0xC8: if (CPU_GET_FLAG(cpu, FLAG_Z)) { cpu->pc = pop16(cpu, mmu); cycles = 20; } else { cycles = 8; } break; // RET Z
-        case 0xD0: if (!CPU_GET_FLAG(cpu, FLAG_C)) { cpu->pc = pop16(cpu, mmu); cycles = 20; } else { cycles = 8; } break; // RET NC
-        case 0xD8: if (CPU_GET_FLAG(cpu, FLAG_C)) { cpu->pc = pop16(cpu, mmu); cycles = 20; } else { cycles = 8; } break; // RET C
-        case 0xD9: cpu->pc = pop16(cpu, mmu); cpu->ime = true; cycles = 16; break; // RETI
-
-        // RST
-        case 0xC7: push16(cpu, mmu, cpu->pc); cpu->pc = 0x00; cycles = 16; break;
-        case 0xCF: push16(cpu, mmu, cpu->pc); cpu->pc = 0x08; cycles = 16; break;
-        case 0xD7: push16(cpu, mmu, cpu->pc); cpu->pc = 0x10; cycles = 16; break;
-        case 0xDF: push16(cpu, mmu, cpu->pc); cpu->pc = 0x18; cycles = 16; break;
-        case 0xE7: push16(cpu, mmu, cpu->pc); cpu->pc = 0x20; cycles = 16; break;
-        case 0xEF: push16(cpu, mmu, cpu->pc); cpu->pc = 0x28; cycles = 16; break;
-        case 0xF7: push16(cpu, mmu, cpu->pc); cpu->pc = 0x30; cycles = 16; break;
-        case 0xFF: 
-            printf("[CRASH DETECTED] Executing RST 38 (0xFF) at PC: 0x%04X\n", old_pc);
-            push16(cpu, mmu, cpu->pc); cpu->pc = 0x38; cycles = 16; break;
-
-        /* --- Miscellaneous --- */
-
-        case 0x27: // DAA (Decimal Adjust Accumulator)
-        {
-            u8 correction = 0;
-            if (CPU_GET_FLAG(cpu, FLAG_H) || (!CPU_GET_FLAG(cpu, FLAG_N) && (cpu->a & 0x0F) > 9)) {
-                correction |= 0x06;
-            }
-            if (CPU_GET_FLAG(cpu, FLAG_C) || (!CPU_GET_FLAG(cpu, FLAG_N) && cpu->a > 0x99)) {
-                correction |= 0x60;
-                CPU_SET_FLAG(cpu, FLAG_C);
+        GB_PROF_FETCH(mmu, cpu->pc);
+        u32 cycles;
+        if (cpu_suspended(cpu, mmu)) {
+            cycles = cpu_idle_cycles(cpu, mmu, sched);
+        } else {
+            if (gb_cpu_breakpoints.count) {
+                if (cpu_breakpoint(cpu, sched)) {
+                    break;
+                }
+            } else if (gb_block_cache.enabled && !cpu->ei_delay && !cpu->halt_bug && !gb_trace.ring &&
+                       !GB_PROF_ACTIVE()) {
+                gb_block_t *block = gb_block_lookup(mmu, cpu->pc);
+                if (block) {
+                    cpu_run_block(cpu, mmu, sched, block);
+                    continue;
+                }
             }
-            if (CPU_GET_FLAG(cpu, FLAG_N)) {
-                cpu->a -= correction;
-            } else {
-                cpu->a += correction;
+            u16 at = cpu->pc;
+            u8 opcode = cpu_fetch_opcode(cpu, mmu);
+            if (gb_trace.ring) {
+                gb_trace_record(cpu, mmu, sched->now, at, opcode);
             }
-            CPU_CLEAR_FLAG(cpu, FLAG_Z);
-            CPU_CLEAR_FLAG(cpu, FLAG_H);
-            if (cpu->a == 0) CPU_SET_FLAG(cpu, FLAG_Z);
-            cycles = 4;
-            break;
+            CPU_EXECUTE(opcode);
+#ifdef GB_BENCH
+            gb_cpu_instructions++;
+#endif
+#ifdef GB_PAIR_STATS
+            cpu_count_pair(at, opcode, cpu->pc);
+#endif
         }
+        sched->now += cycles;
+        GB_PROF_RETIRE(cycles);
 
-        case 0x2F: cpu->a = ~cpu->a; CPU_SET_FLAG(cpu, FLAG_N); CPU_SET_FLAG(cpu, FLAG_H); cycles = 4; break; // CPL
-        case 0x37: CPU_CLEAR_FLAG(cpu, FLAG_N); CPU_CLEAR_FLAG(cpu, FLAG_H); CPU_SET_FLAG(cpu, FLAG_C); cycles = 4; break; // SCF
-        case 0x3F: CPU_CLEAR_FLAG(cpu, FLAG_N); CPU_CLEAR_FLAG(cpu, FLAG_H); if (CPU_GET_FLAG(cpu, FLAG_C)) CPU_CLEAR_FLAG(cpu, FLAG_C); else CPU_SET_FLAG(cpu, FLAG_C); cycles = 4; break; // CCF
-
-        case 0x76: // HALT
-        {
-            u8 ie = gb_mmu_read(mmu, 0xFFFF);
-            u8 if_reg = gb_mmu_read(mmu, 0xFF0F);
-            if (!cpu->ime && (ie & if_reg & 0x1F)) {
-                // HALT bug: HALT mode not entered, next instruction executed twice
-                cpu->halt_bug = true;
-            } else {
-                cpu->halted = true;
-            }
-            cycles = 4;
-            break;
-        }
-        case 0x10: cpu->stopped = true; fetch_u8(cpu, mmu); cycles = 4; break; // STOP
-        case 0xF3: cpu->ime = false; cpu->ei_delay = false; cycles = 4; break; // DI
-        case 0xFB: cpu->ei_delay = true; cycles = 4; break; // EI
-
-        // Rotates (Acc only)
-        case 0x07: // RLCA
-        {
-            u8 carry = (cpu->a & 0x80) >> 7;
-            cpu->a = (cpu->a << 1) | carry;
-            cpu->f = 0;
-            if (carry) CPU_SET_FLAG(cpu, FLAG_C);
-            cycles = 4;
-            break;
+#if GB_EVENT_CATCH_UP
+        /* Components catch up before interrupts are sampled */
+        if (sched->now >= sched->next) {
+            gb_sched_dispatch(sched, mmu);
         }
-        case 0x0F: // RRCA
-        {
-            u8 carry = cpu->a & 0x01;
-            cpu->a = (cpu->a >> 1) | (carry << 7);
-            cpu->f = 0;
-            if (carry) CPU_SET_FLAG(cpu, FLAG_C);
-            cycles = 4;
-            break;
-        }
-        case 0x17: // RLA
-        {
-            u8 old_carry = CPU_GET_FLAG(cpu, FLAG_C);
-            u8 new_carry = (cpu->a & 0x80) >> 7;
-            cpu->a = (cpu->a << 1) | old_carry;
-            cpu->f = 0;
-            if (new_carry) CPU_SET_FLAG(cpu, FLAG_C);
-            cycles = 4;
-            break;
-        }
-        case 0x1F: // RRA
-        {
-            u8 old_carry = CPU_GET_FLAG(cpu, FLAG_C);
-            u8 new_carry = cpu->a & 0x01;
-            cpu->a = (cpu->a >> 1) | (old_carry << 7);
-            cpu->f = 0;
-            if (new_carry) CPU_SET_FLAG(cpu, FLAG_C);
-            cycles = 4;
-            break;
-        }
-
-        /* --- CB Prefix (Extended Instructions) --- */
-        case 0xCB:
-            cycles = 4 + gb_cpu_execute_cb(cpu, mmu);
-            break;
-
-        default:
-            /* For now, just NOP unknown opcodes but log them (if we had logging) */
-            cycles = 4;
-            break;
+#endif
+        sched->now += gb_cpu_handle_interrupts(cpu, mmu);
     }
-    
-    cpu->cycles += cycles;
-    return cycles;
 }
 
 u32 gb_cpu_handle_interrupts(gb_cpu_t *cpu, void *mmu_ptr) {
     gb_mmu_t *mmu = (gb_mmu_t *)mmu_ptr;
     
-    u8 ie = gb_mmu_read(mmu, 0xFFFF);
-    u8 if_reg = gb_mmu_read(mmu, 0xFF0F);
-    u8 triggered = ie & if_reg;
+    u8 triggered = mmu->irq.pending;
     
     if (triggered == 0) {
         return 0;
@@ -956,10 +1155,10 @@ u32 gb_cpu_handle_interrupts(gb_cpu_t *cpu, void *mmu_ptr) {
     
     if (interrupt) {
         cpu->ime = false;
-        gb_mmu_write(mmu, 0xFF0F, if_reg & ~interrupt);
+        gb_irq_ack(&mmu->irq, interrupt);
         push16(cpu, mmu, cpu->pc);
         cpu->pc = vector;
-        cpu->cycles += 20;
+        GB_PROF_IRQ_ENTRY(mmu, vector, cpu->sp);
         return 20;
     }
     return 0;
@@ -19,13 +19,35 @@
 
 #include "../common/common.h"
 
+struct gb_scheduler_t;
+
+/*
+ * 16-bit register pair whose halves alias the 8-bit registers, so BC/DE/HL
+ * are read and written directly instead of being shifted together.
+ * WebAssembly (and every native target we build the bench on) is
+ * little-endian; the byte order flips for big-endian hosts.
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define GB_REG_PAIR(hi, lo) union { struct { u8 hi, lo; }; u16 hi##lo; }
+#else
+#define GB_REG_PAIR(hi, lo) union { struct { u8 lo, hi; }; u16 hi##lo; }
+#endif
+
 /* CPU Registers */
 typedef struct gb_cpu_t {
-    /* 8-bit registers */
-    u8 a, f;  /* Accumulator and Flags */
-    u8 b, c;
-    u8 d, e;
-    u8 h, l;
+    /* 8-bit registers, paired as BC, DE, HL */
+    GB_REG_PAIR(b, c);
+    GB_REG_PAIR(d, e);
+    GB_REG_PAIR(h, l);
+    u8 a;     /* Accumulator */
+    
+    /* Flags (lazy): F is not stored. Each flag is kept in the form the
+     * last ALU operation produced it and F is only assembled by
+     * gb_cpu_get_f() when something needs the packed byte. */
+    u8 flag_z;  /* Result byte of the last op; Z = (flag_z == 0) */
+    u8 flag_n;  /* N, 0 or 1 */
+    u8 flag_h;  /* Bit 4 is H: operand ^ operand ^ result of the last add/sub */
+    u8 flag_c;  /* C, 0 or 1 */
     
     /* 16-bit registers */
     u16 sp;   /* Stack Pointer */
@@ -37,8 +59,6 @@ typedef struct gb_cpu_t {
     bool halted;  /* CPU halted state */
     bool stopped; /* CPU stopped state */
     bool halt_bug; /* CPU halt bug state */
-    
-    u64 cycles;   /* Total cycles executed */
 } gb_cpu_t;
 
 /* Flag register bit positions */
@@ -47,21 +67,73 @@ typedef struct gb_cpu_t {
 #define FLAG_H 5  /* Half-carry flag */
 #define FLAG_C 4  /* Carry flag */
 
-/* Flag manipulation macros */
-#define CPU_GET_FLAG(cpu, flag) (((cpu)->f >> (flag)) & 1)
-#define CPU_SET_FLAG(cpu, flag) ((cpu)->f |= (1 << (flag)))
-#define CPU_CLEAR_FLAG(cpu, flag) ((cpu)->f &= ~(1 << (flag)))
+/* Flag reads (each yields 0 or 1) */
+#define CPU_FLAG_Z(cpu) ((cpu)->flag_z == 0)
+#define CPU_FLAG_N(cpu) ((cpu)->flag_n)
+#define CPU_FLAG_H(cpu) (((cpu)->flag_h >> 4) & 1)
+#define CPU_FLAG_C(cpu) ((cpu)->flag_c)
+
+/* Materialize F from the lazy flag state */
+static inline u8 gb_cpu_get_f(const gb_cpu_t *cpu) {
+    return (u8)((CPU_FLAG_Z(cpu) << FLAG_Z) | (cpu->flag_n << FLAG_N) |
+                ((cpu->flag_h & 0x10) << 1) | (cpu->flag_c << FLAG_C));
+}
+
+/* Load F (POP AF, power-on values) into the lazy flag state */
+static inline void gb_cpu_set_f(gb_cpu_t *cpu, u8 f) {
+    cpu->flag_z = (u8)(~f & (1 << FLAG_Z));
+    cpu->flag_n = (f >> FLAG_N) & 1;
+    cpu->flag_h = (f >> 1) & 0x10;
+    cpu->flag_c = (f >> FLAG_C) & 1;
+}
 
 /* 16-bit register pair access */
-#define CPU_GET_AF(cpu) (((u16)(cpu)->a << 8) | (cpu)->f)
-#define CPU_GET_BC(cpu) (((u16)(cpu)->b << 8) | (cpu)->c)
-#define CPU_GET_DE(cpu) (((u16)(cpu)->d << 8) | (cpu)->e)
-#define CPU_GET_HL(cpu) (((u16)(cpu)->h << 8) | (cpu)->l)
+#define CPU_GET_AF(cpu) (((u16)(cpu)->a << 8) | gb_cpu_get_f(cpu))
+#define CPU_GET_BC(cpu) ((cpu)->bc)
+#define CPU_GET_DE(cpu) ((cpu)->de)
+#define CPU_GET_HL(cpu) ((cpu)->hl)
+
+/* `val` is evaluated once: callers pass fetch_u16()/pop16() directly */
+#define CPU_SET_AF(cpu, val) do { u16 v_ = (val); (cpu)->a = v_ >> 8; gb_cpu_set_f((cpu), (u8)v_); } while(0)
+#define CPU_SET_BC(cpu, val) ((cpu)->bc = (val))
+#define CPU_SET_DE(cpu, val) ((cpu)->de = (val))
+#define CPU_SET_HL(cpu, val) ((cpu)->hl = (val))
 
-#define CPU_SET_AF(cpu, val) do { (cpu)->a = (val) >> 8; (cpu)->f = (val) & 0xF0; } while(0)
-#define CPU_SET_BC(cpu, val) do { (cpu)->b = (val) >> 8; (cpu)->c = (val) & 0xFF; } while(0)
-#define CPU_SET_DE(cpu, val) do { (cpu)->d = (val) >> 8; (cpu)->e = (val) & 0xFF; } while(0)
-#define CPU_SET_HL(cpu, val) do { (cpu)->h = (val) >> 8; (cpu)->l = (val) & 0xFF; } while(0)
+/*
+ * Idle-loop detector: a taken backward branch that closes a short loop which
+ * only polls I/O or HRAM (e.g. LDH A,(44) / CP n / JR NZ) is fast-forwarded
+ * in whole iterations to the next event that could change what it reads.
+ */
+typedef struct {
+    bool enabled;  /* Per-ROM switch, on by default */
+    u32 hits;      /* Loops fast-forwarded since the counters were cleared */
+    u32 cycles;    /* Cycles skipped by those fast-forwards */
+} gb_idle_loop_t;
+
+extern gb_idle_loop_t gb_cpu_idle_loop;
+
+/* PC breakpoints, checked before each fetch while any are set */
+#define GB_CPU_MAX_BREAKPOINTS 16
+
+typedef struct {
+    u8 count;
+    bool resume;     /* Stopped on a breakpoint: let it run on the next fetch */
+    u16 resume_pc;
+    u16 addr[GB_CPU_MAX_BREAKPOINTS];
+} gb_breakpoints_t;
+
+extern gb_breakpoints_t gb_cpu_breakpoints;
+
+#ifdef GB_BENCH
+/* Instructions executed by gb_cpu_run() (native benchmark builds only) */
+extern u64 gb_cpu_instructions;
+#endif
+
+#ifdef GB_PAIR_STATS
+/* Interpreted executions of each adjacent opcode pair, first << 8 | second
+ * (pair-counting builds only, see tools/gb-pairs.c) */
+extern u32 gb_cpu_pairs[0x10000];
+#endif
 
 /* Function prototypes */
 
@@ -78,14 +150,11 @@ void gb_cpu_init(gb_cpu_t *cpu);
 void gb_cpu_reset(gb_cpu_t *cpu);
 
 /**
- * Execute one CPU instruction
- * Returns the number of cycles taken
- * 
- * @param cpu CPU state
- * @param mmu Memory management unit for memory access
- * @return Number of machine cycles executed
+ * Run instructions until the scheduler deadline is reached
+ * Advances the scheduler clock, dispatches events as they fall due and
+ * services interrupts after each instruction
  */
-u32 gb_cpu_step(gb_cpu_t *cpu, void *mmu);
+void gb_cpu_run(gb_cpu_t *cpu, void *mmu, struct gb_scheduler_t *sched);
 
 /**
  * Handle interrupts
@@ -0,0 +1,803 @@
+/**
+ * NeoBoy - LR35902 Opcode Tables
+ *
+ * GENERATED by scripts/gen-cpu-tables.py - do not edit by hand.
+ *
+ * Each entry is X(opcode, handler, cycles). `cycles` is the base cost of
+ * the instruction; conditional handlers return the extra cycles taken
+ * when the branch is followed. CB cycles exclude the 4-cycle prefix.
+ */
+
+#ifndef GB_CPU_TABLES_H
+#define GB_CPU_TABLES_H
+
+/* Main opcode table (0x00-0xFF) */
+#define GB_CPU_OPCODE_TABLE(X) \
+    X(0x00, nop,          4) \
+    X(0x01, ld_bc_d16,   12) \
+    X(0x02, ld_mbc_a,     8) \
+    X(0x03, inc_bc,       8) \
+    X(0x04, inc_b,        4) \
+    X(0x05, dec_b,        4) \
+    X(0x06, ld_b_d8,      8) \
+    X(0x07, rlca,         4) \
+    X(0x08, ld_ma16_sp,  20) \
+    X(0x09, add_hl_bc,    8) \
+    X(0x0A, ld_a_mbc,     8) \
+    X(0x0B, dec_bc,       8) \
+    X(0x0C, inc_c,        4) \
+    X(0x0D, dec_c,        4) \
+    X(0x0E, ld_c_d8,      8) \
+    X(0x0F, rrca,         4) \
+    X(0x10, stop,         4) \
+    X(0x11, ld_de_d16,   12) \
+    X(0x12, ld_mde_a,     8) \
+    X(0x13, inc_de,       8) \
+    X(0x14, inc_d,        4) \
+    X(0x15, dec_d,        4) \
+    X(0x16, ld_d_d8,      8) \
+    X(0x17, rla,          4) \
+    X(0x18, jr_r8,       12) \
+    X(0x19, add_hl_de,    8) \
+    X(0x1A, ld_a_mde,     8) \
+    X(0x1B, dec_de,       8) \
+    X(0x1C, inc_e,        4) \
+    X(0x1D, dec_e,        4) \
+    X(0x1E, ld_e_d8,      8) \
+    X(0x1F, rra,          4) \
+    X(0x20, jr_nz_r8,     8) \
+    X(0x21, ld_hl_d16,   12) \
+    X(0x22, ld_mhli_a,    8) \
+    X(0x23, inc_hl,       8) \
+    X(0x24, inc_h,        4) \
+    X(0x25, dec_h,        4) \
+    X(0x26, ld_h_d8,      8) \
+    X(0x27, daa,          4) \
+    X(0x28, jr_z_r8,      8) \
+    X(0x29, add_hl_hl,    8) \
+    X(0x2A, ld_a_mhli,    8) \
+    X(0x2B, dec_hl,       8) \
+    X(0x2C, inc_l,        4) \
+    X(0x2D, dec_l,        4) \
+    X(0x2E, ld_l_d8,      8) \
+    X(0x2F, cpl,          4) \
+    X(0x30, jr_nc_r8,     8) \
+    X(0x31, ld_sp_d16,   12) \
+    X(0x32, ld_mhld_a,    8) \
+    X(0x33, inc_sp,       8) \
+    X(0x34, inc_mhl,     12) \
+    X(0x35, dec_mhl,     12) \
+    X(0x36, ld_mhl_d8,   12) \
+    X(0x37, scf,          4) \
+    X(0x38, jr_c_r8,      8) \
+    X(0x39, add_hl_sp,    8) \
+    X(0x3A, ld_a_mhld,    8) \
+    X(0x3B, dec_sp,       8) \
+    X(0x3C, inc_a,        4) \
+    X(0x3D, dec_a,        4) \
+    X(0x3E, ld_a_d8,      8) \
+    X(0x3F, ccf,          4) \
+    X(0x40, ld_b_b,       4) \
+    X(0x41, ld_b_c,       4) \
+    X(0x42, ld_b_d,       4) \
+    X(0x43, ld_b_e,       4) \
+    X(0x44, ld_b_h,       4) \
+    X(0x45, ld_b_l,       4) \
+    X(0x46, ld_b_mhl,     8) \
+    X(0x47, ld_b_a,       4) \
+    X(0x48, ld_c_b,       4) \
+    X(0x49, ld_c_c,       4) \
+    X(0x4A, ld_c_d,       4) \
+    X(0x4B, ld_c_e,       4) \
+    X(0x4C, ld_c_h,       4) \
+    X(0x4D, ld_c_l,       4) \
+    X(0x4E, ld_c_mhl,     8) \
+    X(0x4F, ld_c_a,       4) \
+    X(0x50, ld_d_b,       4) \
+    X(0x51, ld_d_c,       4) \
+    X(0x52, ld_d_d,       4) \
+    X(0x53, ld_d_e,       4) \
+    X(0x54, ld_d_h,       4) \
+    X(0x55, ld_d_l,       4) \
+    X(0x56, ld_d_mhl,     8) \
+    X(0x57, ld_d_a,       4) \
+    X(0x58, ld_e_b,       4) \
+    X(0x59, ld_e_c,       4) \
+    X(0x5A, ld_e_d,       4) \
+    X(0x5B, ld_e_e,       4) \
+    X(0x5C, ld_e_h,       4) \
+    X(0x5D, ld_e_l,       4) \
+    X(0x5E, ld_e_mhl,     8) \
+    X(0x5F, ld_e_a,       4) \
+    X(0x60, ld_h_b,       4) \
+    X(0x61, ld_h_c,       4) \
+    X(0x62, ld_h_d,       4) \
+    X(0x63, ld_h_e,       4) \
+    X(0x64, ld_h_h,       4) \
+    X(0x65, ld_h_l,       4) \
+    X(0x66, ld_h_mhl,     8) \
+    X(0x67, ld_h_a,       4) \
+    X(0x68, ld_l_b,       4) \
+    X(0x69, ld_l_c,       4) \
+    X(0x6A, ld_l_d,       4) \
+    X(0x6B, ld_l_e,       4) \
+    X(0x6C, ld_l_h,       4) \
+    X(0x6D, ld_l_l,       4) \
+    X(0x6E, ld_l_mhl,     8) \
+    X(0x6F, ld_l_a,       4) \
+    X(0x70, ld_mhl_b,     8) \
+    X(0x71, ld_mhl_c,     8) \
+    X(0x72, ld_mhl_d,     8) \
+    X(0x73, ld_mhl_e,     8) \
+    X(0x74, ld_mhl_h,     8) \
+    X(0x75, ld_mhl_l,     8) \
+    X(0x76, halt,         4) \
+    X(0x77, ld_mhl_a,     8) \
+    X(0x78, ld_a_b,       4) \
+    X(0x79, ld_a_c,       4) \
+    X(0x7A, ld_a_d,       4) \
+    X(0x7B, ld_a_e,       4) \
+    X(0x7C, ld_a_h,       4) \
+    X(0x7D, ld_a_l,       4) \
+    X(0x7E, ld_a_mhl,     8) \
+    X(0x7F, ld_a_a,       4) \
+    X(0x80, add_b,        4) \
+    X(0x81, add_c,        4) \
+    X(0x82, add_d,        4) \
+    X(0x83, add_e,        4) \
+    X(0x84, add_h,        4) \
+    X(0x85, add_l,        4) \
+    X(0x86, add_mhl,      8) \
+    X(0x87, add_a,        4) \
+    X(0x88, adc_b,        4) \
+    X(0x89, adc_c,        4) \
+    X(0x8A, adc_d,        4) \
+    X(0x8B, adc_e,        4) \
+    X(0x8C, adc_h,        4) \
+    X(0x8D, adc_l,        4) \
+    X(0x8E, adc_mhl,      8) \
+    X(0x8F, adc_a,        4) \
+    X(0x90, sub_b,        4) \
+    X(0x91, sub_c,        4) \
+    X(0x92, sub_d,        4) \
+    X(0x93, sub_e,        4) \
+    X(0x94, sub_h,        4) \
+    X(0x95, sub_l,        4) \
+    X(0x96, sub_mhl,      8) \
+    X(0x97, sub_a,        4) \
+    X(0x98, sbc_b,        4) \
+    X(0x99, sbc_c,        4) \
+    X(0x9A, sbc_d,        4) \
+    X(0x9B, sbc_e,        4) \
+    X(0x9C, sbc_h,        4) \
+    X(0x9D, sbc_l,        4) \
+    X(0x9E, sbc_mhl,      8) \
+    X(0x9F, sbc_a,        4) \
+    X(0xA0, and_b,        4) \
+    X(0xA1, and_c,        4) \
+    X(0xA2, and_d,        4) \
+    X(0xA3, and_e,        4) \
+    X(0xA4, and_h,        4) \
+    X(0xA5, and_l,        4) \
+    X(0xA6, and_mhl,      8) \
+    X(0xA7, and_a,        4) \
+    X(0xA8, xor_b,        4) \
+    X(0xA9, xor_c,        4) \
+    X(0xAA, xor_d,        4) \
+    X(0xAB, xor_e,        4) \
+    X(0xAC, xor_h,        4) \
+    X(0xAD, xor_l,        4) \
+    X(0xAE, xor_mhl,      8) \
+    X(0xAF, xor_a,        4) \
+    X(0xB0, or_b,         4) \
+    X(0xB1, or_c,         4) \
+    X(0xB2, or_d,         4) \
+    X(0xB3, or_e,         4) \
+    X(0xB4, or_h,         4) \
+    X(0xB5, or_l,         4) \
+    X(0xB6, or_mhl,       8) \
+    X(0xB7, or_a,         4) \
+    X(0xB8, cp_b,         4) \
+    X(0xB9, cp_c,         4) \
+    X(0xBA, cp_d,         4) \
+    X(0xBB, cp_e,         4) \
+    X(0xBC, cp_h,         4) \
+    X(0xBD, cp_l,         4) \
+    X(0xBE, cp_mhl,       8) \
+    X(0xBF, cp_a,         4) \
+    X(0xC0, ret_nz,       8) \
+    X(0xC1, pop_bc,      12) \
+    X(0xC2, jp_nz_a16,   12) \
+    X(0xC3, jp_a16,      16) \
+    X(0xC4, call_nz_a16, 12) \
+    X(0xC5, push_bc,     16) \
+    X(0xC6, add_d8,       8) \
+    X(0xC7, rst_00,      16) \
+    X(0xC8, ret_z,        8) \
+    X(0xC9, ret,         16) \
+    X(0xCA, jp_z_a16,    12) \
+    X(0xCB, prefix_cb,    4) \
+    X(0xCC, call_z_a16,  12) \
+    X(0xCD, call_a16,    24) \
+    X(0xCE, adc_d8,       8) \
+    X(0xCF, rst_08,      16) \
+    X(0xD0, ret_nc,       8) \
+    X(0xD1, pop_de,      12) \
+    X(0xD2, jp_nc_a16,   12) \
+    X(0xD3, illegal,      4) \
+    X(0xD4, call_nc_a16, 12) \
+    X(0xD5, push_de,     16) \
+    X(0xD6, sub_d8,       8) \
+    X(0xD7, rst_10,      16) \
+    X(0xD8, ret_c,        8) \
+    X(0xD9, reti,        16) \
+    X(0xDA, jp_c_a16,    12) \
+    X(0xDB, illegal,      4) \
+    X(0xDC, call_c_a16,  12) \
+    X(0xDD, illegal,      4) \
+    X(0xDE, sbc_d8,       8) \
+    X(0xDF, rst_18,      16) \
+    X(0xE0, ldh_ma8_a,   12) \
+    X(0xE1, pop_hl,      12) \
+    X(0xE2, ld_mc_a,      8) \
+    X(0xE3, illegal,      4) \
+    X(0xE4, illegal,      4) \
+    X(0xE5, push_hl,     16) \
+    X(0xE6, and_d8,       8) \
+    X(0xE7, rst_20,      16) \
+    X(0xE8, add_sp_r8,   16) \
+    X(0xE9, jp_hl,        4) \
+    X(0xEA, ld_ma16_a,   16) \
+    X(0xEB, illegal,      4) \
+    X(0xEC, illegal,      4) \
+    X(0xED, illegal,      4) \
+    X(0xEE, xor_d8,       8) \
+    X(0xEF, rst_28,      16) \
+    X(0xF0, ldh_a_ma8,   12) \
+    X(0xF1, pop_af,      12) \
+    X(0xF2, ld_a_mc,      8) \
+    X(0xF3, di,           4) \
+    X(0xF4, illegal,      4) \
+    X(0xF5, push_af,     16) \
+    X(0xF6, or_d8,        8) \
+    X(0xF7, rst_30,      16) \
+    X(0xF8, ld_hl_sp_r8, 12) \
+    X(0xF9, ld_sp_hl,     8) \
+    X(0xFA, ld_a_ma16,   16) \
+    X(0xFB, ei,           4) \
+    X(0xFC, illegal,      4) \
+    X(0xFD, illegal,      4) \
+    X(0xFE, cp_d8,        8) \
+    X(0xFF, rst_38,      16)
+
+/* CB-prefixed opcode table (0xCB 0x00-0xFF) */
+#define GB_CPU_CB_TABLE(X) \
+    X(0x00, rlc_b,        4) \
+    X(0x01, rlc_c,        4) \
+    X(0x02, rlc_d,        4) \
+    X(0x03, rlc_e,        4) \
+    X(0x04, rlc_h,        4) \
+    X(0x05, rlc_l,        4) \
+    X(0x06, rlc_mhl,     12) \
+    X(0x07, rlc_a,        4) \
+    X(0x08, rrc_b,        4) \
+    X(0x09, rrc_c,        4) \
+    X(0x0A, rrc_d,        4) \
+    X(0x0B, rrc_e,        4) \
+    X(0x0C, rrc_h,        4) \
+    X(0x0D, rrc_l,        4) \
+    X(0x0E, rrc_mhl,     12) \
+    X(0x0F, rrc_a,        4) \
+    X(0x10, rl_b,         4) \
+    X(0x11, rl_c,         4) \
+    X(0x12, rl_d,         4) \
+    X(0x13, rl_e,         4) \
+    X(0x14, rl_h,         4) \
+    X(0x15, rl_l,         4) \
+    X(0x16, rl_mhl,      12) \
+    X(0x17, rl_a,         4) \
+    X(0x18, rr_b,         4) \
+    X(0x19, rr_c,         4) \
+    X(0x1A, rr_d,         4) \
+    X(0x1B, rr_e,         4) \
+    X(0x1C, rr_h,         4) \
+    X(0x1D, rr_l,         4) \
+    X(0x1E, rr_mhl,      12) \
+    X(0x1F, rr_a,         4) \
+    X(0x20, sla_b,        4) \
+    X(0x21, sla_c,        4) \
+    X(0x22, sla_d,        4) \
+    X(0x23, sla_e,        4) \
+    X(0x24, sla_h,        4) \
+    X(0x25, sla_l,        4) \
+    X(0x26, sla_mhl,     12) \
+    X(0x27, sla_a,        4) \
+    X(0x28, sra_b,        4) \
+    X(0x29, sra_c,        4) \
+    X(0x2A, sra_d,        4) \
+    X(0x2B, sra_e,        4) \
+    X(0x2C, sra_h,        4) \
+    X(0x2D, sra_l,        4) \
+    X(0x2E, sra_mhl,     12) \
+    X(0x2F, sra_a,        4) \
+    X(0x30, swap_b,       4) \
+    X(0x31, swap_c,       4) \
+    X(0x32, swap_d,       4) \
+    X(0x33, swap_e,       4) \
+    X(0x34, swap_h,       4) \
+    X(0x35, swap_l,       4) \
+    X(0x36, swap_mhl,    12) \
+    X(0x37, swap_a,       4) \
+    X(0x38, srl_b,        4) \
+    X(0x39, srl_c,        4) \
+    X(0x3A, srl_d,        4) \
+    X(0x3B, srl_e,        4) \
+    X(0x3C, srl_h,        4) \
+    X(0x3D, srl_l,        4) \
+    X(0x3E, srl_mhl,     12) \
+    X(0x3F, srl_a,        4) \
+    X(0x40, bit0_b,       4) \
+    X(0x41, bit0_c,       4) \
+    X(0x42, bit0_d,       4) \
+    X(0x43, bit0_e,       4) \
+    X(0x44, bit0_h,       4) \
+    X(0x45, bit0_l,       4) \
+    X(0x46, bit0_mhl,     8) \
+    X(0x47, bit0_a,       4) \
+    X(0x48, bit1_b,       4) \
+    X(0x49, bit1_c,       4) \
+    X(0x4A, bit1_d,       4) \
+    X(0x4B, bit1_e,       4) \
+    X(0x4C, bit1_h,       4) \
+    X(0x4D, bit1_l,       4) \
+    X(0x4E, bit1_mhl,     8) \
+    X(0x4F, bit1_a,       4) \
+    X(0x50, bit2_b,       4) \
+    X(0x51, bit2_c,       4) \
+    X(0x52, bit2_d,       4) \
+    X(0x53, bit2_e,       4) \
+    X(0x54, bit2_h,       4) \
+    X(0x55, bit2_l,       4) \
+    X(0x56, bit2_mhl,     8) \
+    X(0x57, bit2_a,       4) \
+    X(0x58, bit3_b,       4) \
+    X(0x59, bit3_c,       4) \
+    X(0x5A, bit3_d,       4) \
+    X(0x5B, bit3_e,       4) \
+    X(0x5C, bit3_h,       4) \
+    X(0x5D, bit3_l,       4) \
+    X(0x5E, bit3_mhl,     8) \
+    X(0x5F, bit3_a,       4) \
+    X(0x60, bit4_b,       4) \
+    X(0x61, bit4_c,       4) \
+    X(0x62, bit4_d,       4) \
+    X(0x63, bit4_e,       4) \
+    X(0x64, bit4_h,       4) \
+    X(0x65, bit4_l,       4) \
+    X(0x66, bit4_mhl,     8) \
+    X(0x67, bit4_a,       4) \
+    X(0x68, bit5_b,       4) \
+    X(0x69, bit5_c,       4) \
+    X(0x6A, bit5_d,       4) \
+    X(0x6B, bit5_e,       4) \
+    X(0x6C, bit5_h,       4) \
+    X(0x6D, bit5_l,       4) \
+    X(0x6E, bit5_mhl,     8) \
+    X(0x6F, bit5_a,       4) \
+    X(0x70, bit6_b,       4) \
+    X(0x71, bit6_c,       4) \
+    X(0x72, bit6_d,       4) \
+    X(0x73, bit6_e,       4) \
+    X(0x74, bit6_h,       4) \
+    X(0x75, bit6_l,       4) \
+    X(0x76, bit6_mhl,     8) \
+    X(0x77, bit6_a,       4) \
+    X(0x78, bit7_b,       4) \
+    X(0x79, bit7_c,       4) \
+    X(0x7A, bit7_d,       4) \
+    X(0x7B, bit7_e,       4) \
+    X(0x7C, bit7_h,       4) \
+    X(0x7D, bit7_l,       4) \
+    X(0x7E, bit7_mhl,     8) \
+    X(0x7F, bit7_a,       4) \
+    X(0x80, res0_b,       4) \
+    X(0x81, res0_c,       4) \
+    X(0x82, res0_d,       4) \
+    X(0x83, res0_e,       4) \
+    X(0x84, res0_h,       4) \
+    X(0x85, res0_l,       4) \
+    X(0x86, res0_mhl,    12) \
+    X(0x87, res0_a,       4) \
+    X(0x88, res1_b,       4) \
+    X(0x89, res1_c,       4) \
+    X(0x8A, res1_d,       4) \
+    X(0x8B, res1_e,       4) \
+    X(0x8C, res1_h,       4) \
+    X(0x8D, res1_l,       4) \
+    X(0x8E, res1_mhl,    12) \
+    X(0x8F, res1_a,       4) \
+    X(0x90, res2_b,       4) \
+    X(0x91, res2_c,       4) \
+    X(0x92, res2_d,       4) \
+    X(0x93, res2_e,       4) \
+    X(0x94, res2_h,       4) \
+    X(0x95, res2_l,       4) \
+    X(0x96, res2_mhl,    12) \
+    X(0x97, res2_a,       4) \
+    X(0x98, res3_b,       4) \
+    X(0x99, res3_c,       4) \
+    X(0x9A, res3_d,       4) \
+    X(0x9B, res3_e,       4) \
+    X(0x9C, res3_h,       4) \
+    X(0x9D, res3_l,       4) \
+    X(0x9E, res3_mhl,    12) \
+    X(0x9F, res3_a,       4) \
+    X(0xA0, res4_b,       4) \
+    X(0xA1, res4_c,       4) \
+    X(0xA2, res4_d,       4) \
+    X(0xA3, res4_e,       4) \
+    X(0xA4, res4_h,       4) \
+    X(0xA5, res4_l,       4) \
+    X(0xA6, res4_mhl,    12) \
+    X(0xA7, res4_a,       4) \
+    X(0xA8, res5_b,       4) \
+    X(0xA9, res5_c,       4) \
+    X(0xAA, res5_d,       4) \
+    X(0xAB, res5_e,       4) \
+    X(0xAC, res5_h,       4) \
+    X(0xAD, res5_l,       4) \
+    X(0xAE, res5_mhl,    12) \
+    X(0xAF, res5_a,       4) \
+    X(0xB0, res6_b,       4) \
+    X(0xB1, res6_c,       4) \
+    X(0xB2, res6_d,       4) \
+    X(0xB3, res6_e,       4) \
+    X(0xB4, res6_h,       4) \
+    X(0xB5, res6_l,       4) \
+    X(0xB6, res6_mhl,    12) \
+    X(0xB7, res6_a,       4) \
+    X(0xB8, res7_b,       4) \
+    X(0xB9, res7_c,       4) \
+    X(0xBA, res7_d,       4) \
+    X(0xBB, res7_e,       4) \
+    X(0xBC, res7_h,       4) \
+    X(0xBD, res7_l,       4) \
+    X(0xBE, res7_mhl,    12) \
+    X(0xBF, res7_a,       4) \
+    X(0xC0, set0_b,       4) \
+    X(0xC1, set0_c,       4) \
+    X(0xC2, set0_d,       4) \
+    X(0xC3, set0_e,       4) \
+    X(0xC4, set0_h,       4) \
+    X(0xC5, set0_l,       4) \
+    X(0xC6, set0_mhl,    12) \
+    X(0xC7, set0_a,       4) \
+    X(0xC8, set1_b,       4) \
+    X(0xC9, set1_c,       4) \
+    X(0xCA, set1_d,       4) \
+    X(0xCB, set1_e,       4) \
+    X(0xCC, set1_h,       4) \
+    X(0xCD, set1_l,       4) \
+    X(0xCE, set1_mhl,    12) \
+    X(0xCF, set1_a,       4) \
+    X(0xD0, set2_b,       4) \
+    X(0xD1, set2_c,       4) \
+    X(0xD2, set2_d,       4) \
+    X(0xD3, set2_e,       4) \
+    X(0xD4, set2_h,       4) \
+    X(0xD5, set2_l,       4) \
+    X(0xD6, set2_mhl,    12) \
+    X(0xD7, set2_a,       4) \
+    X(0xD8, set3_b,       4) \
+    X(0xD9, set3_c,       4) \
+    X(0xDA, set3_d,       4) \
+    X(0xDB, set3_e,       4) \
+    X(0xDC, set3_h,       4) \
+    X(0xDD, set3_l,       4) \
+    X(0xDE, set3_mhl,    12) \
+    X(0xDF, set3_a,       4) \
+    X(0xE0, set4_b,       4) \
+    X(0xE1, set4_c,       4) \
+    X(0xE2, set4_d,       4) \
+    X(0xE3, set4_e,       4) \
+    X(0xE4, set4_h,       4) \
+    X(0xE5, set4_l,       4) \
+    X(0xE6, set4_mhl,    12) \
+    X(0xE7, set4_a,       4) \
+    X(0xE8, set5_b,       4) \
+    X(0xE9, set5_c,       4) \
+    X(0xEA, set5_d,       4) \
+    X(0xEB, set5_e,       4) \
+    X(0xEC, set5_h,       4) \
+    X(0xED, set5_l,       4) \
+    X(0xEE, set5_mhl,    12) \
+    X(0xEF, set5_a,       4) \
+    X(0xF0, set6_b,       4) \
+    X(0xF1, set6_c,       4) \
+    X(0xF2, set6_d,       4) \
+    X(0xF3, set6_e,       4) \
+    X(0xF4, set6_h,       4) \
+    X(0xF5, set6_l,       4) \
+    X(0xF6, set6_mhl,    12) \
+    X(0xF7, set6_a,       4) \
+    X(0xF8, set7_b,       4) \
+    X(0xF9, set7_c,       4) \
+    X(0xFA, set7_d,       4) \
+    X(0xFB, set7_e,       4) \
+    X(0xFC, set7_h,       4) \
+    X(0xFD, set7_l,       4) \
+    X(0xFE, set7_mhl,    12) \
+    X(0xFF, set7_a,       4)
+
+/* Decode info for the block translator (block.c): X(opcode, length, flags).
+ * Memory access of a CB-prefixed opcode depends on its second byte. */
+#define GB_CPU_OP_MEM 0x01 /* Accesses memory beyond its own operand bytes */
+#define GB_CPU_OP_END 0x02 /* Ends a block: jumps, calls, returns, HALT, STOP, EI */
+
+#define GB_CPU_OPCODE_DECODE(X) \
+    X(0x00, 1, 0) \
+    X(0x01, 3, 0) \
+    X(0x02, 1, GB_CPU_OP_MEM) \
+    X(0x03, 1, 0) \
+    X(0x04, 1, 0) \
+    X(0x05, 1, 0) \
+    X(0x06, 2, 0) \
+    X(0x07, 1, 0) \
+    X(0x08, 3, GB_CPU_OP_MEM) \
+    X(0x09, 1, 0) \
+    X(0x0A, 1, GB_CPU_OP_MEM) \
+    X(0x0B, 1, 0) \
+    X(0x0C, 1, 0) \
+    X(0x0D, 1, 0) \
+    X(0x0E, 2, 0) \
+    X(0x0F, 1, 0) \
+    X(0x10, 2, GB_CPU_OP_END) \
+    X(0x11, 3, 0) \
+    X(0x12, 1, GB_CPU_OP_MEM) \
+    X(0x13, 1, 0) \
+    X(0x14, 1, 0) \
+    X(0x15, 1, 0) \
+    X(0x16, 2, 0) \
+    X(0x17, 1, 0) \
+    X(0x18, 2, GB_CPU_OP_END) \
+    X(0x19, 1, 0) \
+    X(0x1A, 1, GB_CPU_OP_MEM) \
+    X(0x1B, 1, 0) \
+    X(0x1C, 1, 0) \
+    X(0x1D, 1, 0) \
+    X(0x1E, 2, 0) \
+    X(0x1F, 1, 0) \
+    X(0x20, 2, GB_CPU_OP_END) \
+    X(0x21, 3, 0) \
+    X(0x22, 1, GB_CPU_OP_MEM) \
+    X(0x23, 1, 0) \
+    X(0x24, 1, 0) \
+    X(0x25, 1, 0) \
+    X(0x26, 2, 0) \
+    X(0x27, 1, 0) \
+    X(0x28, 2, GB_CPU_OP_END) \
+    X(0x29, 1, 0) \
+    X(0x2A, 1, GB_CPU_OP_MEM) \
+    X(0x2B, 1, 0) \
+    X(0x2C, 1, 0) \
+    X(0x2D, 1, 0) \
+    X(0x2E, 2, 0) \
+    X(0x2F, 1, 0) \
+    X(0x30, 2, GB_CPU_OP_END) \
+    X(0x31, 3, 0) \
+    X(0x32, 1, GB_CPU_OP_MEM) \
+    X(0x33, 1, 0) \
+    X(0x34, 1, GB_CPU_OP_MEM) \
+    X(0x35, 1, GB_CPU_OP_MEM) \
+    X(0x36, 2, GB_CPU_OP_MEM) \
+    X(0x37, 1, 0) \
+    X(0x38, 2, GB_CPU_OP_END) \
+    X(0x39, 1, 0) \
+    X(0x3A, 1, GB_CPU_OP_MEM) \
+    X(0x3B, 1, 0) \
+    X(0x3C, 1, 0) \
+    X(0x3D, 1, 0) \
+    X(0x3E, 2, 0) \
+    X(0x3F, 1, 0) \
+    X(0x40, 1, 0) \
+    X(0x41, 1, 0) \
+    X(0x42, 1, 0) \
+    X(0x43, 1, 0) \
+    X(0x44, 1, 0) \
+    X(0x45, 1, 0) \
+    X(0x46, 1, GB_CPU_OP_MEM) \
+    X(0x47, 1, 0) \
+    X(0x48, 1, 0) \
+    X(0x49, 1, 0) \
+    X(0x4A, 1, 0) \
+    X(0x4B, 1, 0) \
+    X(0x4C, 1, 0) \
+    X(0x4D, 1, 0) \
+    X(0x4E, 1, GB_CPU_OP_MEM) \
+    X(0x4F, 1, 0) \
+    X(0x50, 1, 0) \
+    X(0x51, 1, 0) \
+    X(0x52, 1, 0) \
+    X(0x53, 1, 0) \
+    X(0x54, 1, 0) \
+    X(0x55, 1, 0) \
+    X(0x56, 1, GB_CPU_OP_MEM) \
+    X(0x57, 1, 0) \
+    X(0x58, 1, 0) \
+    X(0x59, 1, 0) \
+    X(0x5A, 1, 0) \
+    X(0x5B, 1, 0) \
+    X(0x5C, 1, 0) \
+    X(0x5D, 1, 0) \
+    X(0x5E, 1, GB_CPU_OP_MEM) \
+    X(0x5F, 1, 0) \
+    X(0x60, 1, 0) \
+    X(0x61, 1, 0) \
+    X(0x62, 1, 0) \
+    X(0x63, 1, 0) \
+    X(0x64, 1, 0) \
+    X(0x65, 1, 0) \
+    X(0x66, 1, GB_CPU_OP_MEM) \
+    X(0x67, 1, 0) \
+    X(0x68, 1, 0) \
+    X(0x69, 1, 0) \
+    X(0x6A, 1, 0) \
+    X(0x6B, 1, 0) \
+    X(0x6C, 1, 0) \
+    X(0x6D, 1, 0) \
+    X(0x6E, 1, GB_CPU_OP_MEM) \
+    X(0x6F, 1, 0) \
+    X(0x70, 1, GB_CPU_OP_MEM) \
+    X(0x71, 1, GB_CPU_OP_MEM) \
+    X(0x72, 1, GB_CPU_OP_MEM) \
+    X(0x73, 1, GB_CPU_OP_MEM) \
+    X(0x74, 1, GB_CPU_OP_MEM) \
+    X(0x75, 1, GB_CPU_OP_MEM) \
+    X(0x76, 1, GB_CPU_OP_END) \
+    X(0x77, 1, GB_CPU_OP_MEM) \
+    X(0x78, 1, 0) \
+    X(0x79, 1, 0) \
+    X(0x7A, 1, 0) \
+    X(0x7B, 1, 0) \
+    X(0x7C, 1, 0) \
+    X(0x7D, 1, 0) \
+    X(0x7E, 1, GB_CPU_OP_MEM) \
+    X(0x7F, 1, 0) \
+    X(0x80, 1, 0) \
+    X(0x81, 1, 0) \
+    X(0x82, 1, 0) \
+    X(0x83, 1, 0) \
+    X(0x84, 1, 0) \
+    X(0x85, 1, 0) \
+    X(0x86, 1, GB_CPU_OP_MEM) \
+    X(0x87, 1, 0) \
+    X(0x88, 1, 0) \
+    X(0x89, 1, 0) \
+    X(0x8A, 1, 0) \
+    X(0x8B, 1, 0) \
+    X(0x8C, 1, 0) \
+    X(0x8D, 1, 0) \
+    X(0x8E, 1, GB_CPU_OP_MEM) \
+    X(0x8F, 1, 0) \
+    X(0x90, 1, 0) \
+    X(0x91, 1, 0) \
+    X(0x92, 1, 0) \
+    X(0x93, 1, 0) \
+    X(0x94, 1, 0) \
+    X(0x95, 1, 0) \
+    X(0x96, 1, GB_CPU_OP_MEM) \
+    X(0x97, 1, 0) \
+    X(0x98, 1, 0) \
+    X(0x99, 1, 0) \
+    X(0x9A, 1, 0) \
+    X(0x9B, 1, 0) \
+    X(0x9C, 1, 0) \
+    X(0x9D, 1, 0) \
+    X(0x9E, 1, GB_CPU_OP_MEM) \
+    X(0x9F, 1, 0) \
+    X(0xA0, 1, 0) \
+    X(0xA1, 1, 0) \
+    X(0xA2, 1, 0) \
+    X(0xA3, 1, 0) \
+    X(0xA4, 1, 0) \
+    X(0xA5, 1, 0) \
+    X(0xA6, 1, GB_CPU_OP_MEM) \
+    X(0xA7, 1, 0) \
+    X(0xA8, 1, 0) \
+    X(0xA9, 1, 0) \
+    X(0xAA, 1, 0) \
+    X(0xAB, 1, 0) \
+    X(0xAC, 1, 0) \
+    X(0xAD, 1, 0) \
+    X(0xAE, 1, GB_CPU_OP_MEM) \
+    X(0xAF, 1, 0) \
+    X(0xB0, 1, 0) \
+    X(0xB1, 1, 0) \
+    X(0xB2, 1, 0) \
+    X(0xB3, 1, 0) \
+    X(0xB4, 1, 0) \
+    X(0xB5, 1, 0) \
+    X(0xB6, 1, GB_CPU_OP_MEM) \
+    X(0xB7, 1, 0) \
+    X(0xB8, 1, 0) \
+    X(0xB9, 1, 0) \
+    X(0xBA, 1, 0) \
+    X(0xBB, 1, 0) \
+    X(0xBC, 1, 0) \
+    X(0xBD, 1, 0) \
+    X(0xBE, 1, GB_CPU_OP_MEM) \
+    X(0xBF, 1, 0) \
+    X(0xC0, 1, GB_CPU_OP_END) \
+    X(0xC1, 1, GB_CPU_OP_MEM) \
+    X(0xC2, 3, GB_CPU_OP_END) \
+    X(0xC3, 3, GB_CPU_OP_END) \
+    X(0xC4, 3, GB_CPU_OP_END) \
+    X(0xC5, 1, GB_CPU_OP_MEM) \
+    X(0xC6, 2, 0) \
+    X(0xC7, 1, GB_CPU_OP_END) \
+    X(0xC8, 1, GB_CPU_OP_END) \
+    X(0xC9, 1, GB_CPU_OP_END) \
+    X(0xCA, 3, GB_CPU_OP_END) \
+    X(0xCB, 2, 0) \
+    X(0xCC, 3, GB_CPU_OP_END) \
+    X(0xCD, 3, GB_CPU_OP_END) \
+    X(0xCE, 2, 0) \
+    X(0xCF, 1, GB_CPU_OP_END) \
+    X(0xD0, 1, GB_CPU_OP_END) \
+    X(0xD1, 1, GB_CPU_OP_MEM) \
+    X(0xD2, 3, GB_CPU_OP_END) \
+    X(0xD3, 1, 0) \
+    X(0xD4, 3, GB_CPU_OP_END) \
+    X(0xD5, 1, GB_CPU_OP_MEM) \
+    X(0xD6, 2, 0) \
+    X(0xD7, 1, GB_CPU_OP_END) \
+    X(0xD8, 1, GB_CPU_OP_END) \
+    X(0xD9, 1, GB_CPU_OP_END) \
+    X(0xDA, 3, GB_CPU_OP_END) \
+    X(0xDB, 1, 0) \
+    X(0xDC, 3, GB_CPU_OP_END) \
+    X(0xDD, 1, 0) \
+    X(0xDE, 2, 0) \
+    X(0xDF, 1, GB_CPU_OP_END) \
+    X(0xE0, 2, GB_CPU_OP_MEM) \
+    X(0xE1, 1, GB_CPU_OP_MEM) \
+    X(0xE2, 1, GB_CPU_OP_MEM) \
+    X(0xE3, 1, 0) \
+    X(0xE4, 1, 0) \
+    X(0xE5, 1, GB_CPU_OP_MEM) \
+    X(0xE6, 2, 0) \
+    X(0xE7, 1, GB_CPU_OP_END) \
+    X(0xE8, 2, 0) \
+    X(0xE9, 1, GB_CPU_OP_END) \
+    X(0xEA, 3, GB_CPU_OP_MEM) \
+    X(0xEB, 1, 0) \
+    X(0xEC, 1, 0) \
+    X(0xED, 1, 0) \
+    X(0xEE, 2, 0) \
+    X(0xEF, 1, GB_CPU_OP_END) \
+    X(0xF0, 2, GB_CPU_OP_MEM) \
+    X(0xF1, 1, GB_CPU_OP_MEM) \
+    X(0xF2, 1, GB_CPU_OP_MEM) \
+    X(0xF3, 1, 0) \
+    X(0xF4, 1, 0) \
+    X(0xF5, 1, GB_CPU_OP_MEM) \
+    X(0xF6, 2, 0) \
+    X(0xF7, 1, GB_CPU_OP_END) \
+    X(0xF8, 2, 0) \
+    X(0xF9, 1, 0) \
+    X(0xFA, 3, GB_CPU_OP_MEM) \
+    X(0xFB, 1, GB_CPU_OP_END) \
+    X(0xFC, 1, 0) \
+    X(0xFD, 1, 0) \
+    X(0xFE, 2, 0) \
+    X(0xFF, 1, GB_CPU_OP_END)
+
+/* Superinstructions (scripts/cpu-fusion.txt), ids from 1:
+ * X(id, op1, handler1, cycles1, op2, handler2, cycles2) */
+#define GB_CPU_FUSION_TABLE(X) \
+    X(1, 0x2A, ld_a_mhli, 8, 0x12, ld_mde_a, 8) \
+    X(2, 0x05, dec_b, 4, 0x20, jr_nz_r8, 8) \
+    X(3, 0xF0, ldh_a_ma8, 12, 0xE6, and_d8, 8) \
+    X(4, 0xFE, cp_d8, 8, 0x28, jr_z_r8, 8)
+
+#endif /* GB_CPU_TABLES_H */
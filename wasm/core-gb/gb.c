@@ -7,14 +7,19 @@
  */
 
 #include "core.h"
+#include "block.h"
 #include "cpu.h"
 #include "ppu.h"
+#include "tile_cache.h"
 #include "mmu.h"
 #include "apu.h"
 #include "cartridge.h"
+#include "prof.h"
+#include "trace.h"
+#include "scheduler.h"
+#include "../common/log.h"
 #include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
 #include <stddef.h>
 
 /* Global emulator state */
@@ -24,10 +29,12 @@ typedef struct {
     gb_mmu_t mmu;
     gb_apu_t apu;
     gb_cartridge_t cart;
+    gb_scheduler_t sched;
     
     bool running;
     bool cgb_mode; /* New: CGB Mode Flag */
     uint32_t frame_count;
+    uint32_t run_cycles; /* Cycles consumed by the last gb_run_cycles() */
 } gb_state_t;
 
 static gb_state_t *gb = NULL;
@@ -39,7 +46,7 @@ void gb_init(void) {
     
     gb = (gb_state_t*)malloc(sizeof(gb_state_t));
     if (gb == NULL) {
-        printf("[NeoBoy] [ERROR] Failed to allocate global state!\n");
+        LOG_ERROR(LOG_CORE, "Failed to allocate global state");
         return;
     }
     memset(gb, 0, sizeof(gb_state_t));
@@ -49,12 +56,13 @@ void gb_init(void) {
     gb_ppu_init(&gb->ppu);
     gb_apu_init(&gb->apu);
     gb_cart_init(&gb->cart);
-    gb_mmu_init(&gb->mmu, &gb->ppu, &gb->apu, &gb->cart);
+    gb_sched_init(&gb->sched);
+    gb_mmu_init(&gb->mmu, &gb->ppu, &gb->apu, &gb->cart, &gb->sched);
     
     gb->running = false;
     gb->cgb_mode = false;
     gb->frame_count = 0;
-    printf("[NeoBoy] Core initialized\n");
+    LOG_INFO(LOG_CORE, "Core initialized");
 }
 
 int gb_load_rom(const uint8_t* rom_data, uint32_t size) {
@@ -64,43 +72,48 @@ int gb_load_rom(const uint8_t* rom_data, uint32_t size) {
     
     if (gb == NULL) return -1;
     
-    printf("[NeoBoy] Loading ROM: %u bytes at %p\n", size, rom_data);
+    LOG_INFO(LOG_CORE, "Loading ROM: %u bytes at %p", size, (const void *)rom_data);
     if(size >= 0x150) {
         /* Detect CGB Mode */
         u8 cgb_flag = rom_data[0x143];
         if (cgb_flag == 0x80 || cgb_flag == 0xC0) {
             gb->cgb_mode = true;
-            printf("[NeoBoy] CGB Mode Detected (Flag: %02X)\n", cgb_flag);
+            LOG_INFO(LOG_CORE, "CGB mode detected (flag %02X)", cgb_flag);
         } else {
             gb->cgb_mode = false;
-            printf("[NeoBoy] DMG Mode Detected (Flag: %02X)\n", cgb_flag);
+            LOG_INFO(LOG_CORE, "DMG mode detected (flag %02X)", cgb_flag);
         }
     }
     
     int result = gb_cart_load(&gb->cart, rom_data, size);
     if (result == 0) {
+        /* The idle-loop switch is per ROM: every new cartridge starts enabled */
+        gb_cpu_idle_loop.enabled = true;
         gb_reset();
         gb->running = true;
-        printf("[NeoBoy] ROM loaded successfully\n");
+        LOG_INFO(LOG_CORE, "ROM loaded");
     } else {
-        printf("[NeoBoy] [ERROR] ROM load failed: %d\n", result);
+        LOG_ERROR(LOG_CORE, "ROM load failed: %d", result);
     }
     
     return result;
 }
 
-static int trace_count = 0;
-
 void gb_reset(void) {
     if (gb == NULL) {
         return;
     }
     
+    gb_sched_init(&gb->sched);
     gb_cpu_reset(&gb->cpu);
     gb_ppu_reset(&gb->ppu);
     gb_apu_reset(&gb->apu);
     gb_mmu_reset(&gb->mmu);
     
+    /* Queue the first PPU and APU events on the fresh clock */
+    gb_ppu_start(&gb->ppu, &gb->mmu);
+    gb_apu_start(&gb->apu, &gb->mmu);
+    
     /* CGB Specific Initialization */
     if (gb->cgb_mode) {
         gb->cpu.a = 0x11;
@@ -112,7 +125,7 @@ void gb_reset(void) {
     }
     
     gb->frame_count = 0;
-    trace_count = 0; /* Reset trace on reset */
+    GB_PROF_UNWIND();
 }
 void gb_step_frame(void) {
     if (gb == NULL || !gb->running) {
@@ -126,60 +139,24 @@ void gb_step_frame(void) {
         CYCLES_PER_FRAME = 140448;
     }
 
-    uint32_t frame_cycles = 0;
+    gb_scheduler_t *sched = &gb->sched;
+    u64 frame_start = sched->now;
+    u64 frame_end = frame_start + CYCLES_PER_FRAME;
+    sched->stop_mask = GB_STOP_VBLANK;
+    sched->stop_reason = 0;
+    gb_cpu_idle_loop.hits = 0;
+    gb_cpu_idle_loop.cycles = 0;
     
-    while (frame_cycles < CYCLES_PER_FRAME) {
-        /* High-detail trace for first few steps */
-        if (trace_count < 200) {
-            u8 op = gb_mmu_read(&gb->mmu, gb->cpu.pc);
-            printf("[TRACE-%d] PC: 0x%04X, SP: 0x%04X, Op: 0x%02X, A: 0x%02X, F: 0x%02X\n", 
-                   trace_count, gb->cpu.pc, gb->cpu.sp, op, gb->cpu.a, gb->cpu.f);
-            trace_count++;
-        }
-
-        /* Step CPU */
-        uint32_t cpu_cycles = gb_cpu_step(&gb->cpu, &gb->mmu);
-        
-        /* Calculate component cycles */
-        /* PPU always runs at 4MHz. If CPU is 8MHz (Double Speed), PPU sees half cycles. */
-        uint32_t ppu_cycles = gb->mmu.speed ? (cpu_cycles >> 1) : cpu_cycles;
-        if (ppu_cycles == 0 && cpu_cycles > 0) ppu_cycles = 1; /* Safety minimum */
-        
-        /* Step PPU */
-        bool vblank = gb_ppu_step(&gb->ppu, &gb->mmu, ppu_cycles);
-        
-        /* Step APU */
-        /* APU sample generation should stay consistent? Assuming 4MHz base for now. */
-        gb_apu_step(&gb->apu, ppu_cycles);
-        
-        /* Step Timers */
-        /* Timers run at system clock (so they run faster in double speed) */
-        gb_mmu_step_timers(&gb->mmu, cpu_cycles);
-        
-        /* Handle interrupts and catch extra cycles */
-        uint32_t int_cycles = gb_cpu_handle_interrupts(&gb->cpu, &gb->mmu);
-        if (int_cycles > 0) {
-            uint32_t int_ppu_cycles = gb->mmu.speed ? (int_cycles >> 1) : int_cycles;
-            gb_ppu_step(&gb->ppu, &gb->mmu, int_ppu_cycles);
-            gb_apu_step(&gb->apu, int_ppu_cycles);
-            gb_mmu_step_timers(&gb->mmu, int_cycles);
-            cpu_cycles += int_cycles;
-        }
-        
-        frame_cycles += cpu_cycles;
-        
-        /* Exit on VBlank */
-        if (vblank) {
-            break;
-        }
-    }
+    /* Run until VBlank (the PPU event ends the run) or the frame budget */
+    sched->deadline = frame_end;
+    gb_cpu_run(&gb->cpu, &gb->mmu, sched);
+    
+    uint32_t frame_cycles = (uint32_t)(sched->now - frame_start);
     
     if (gb->frame_count % 60 == 0) {
-        u8 vram_sample1 = gb->ppu.vram[0x0000]; // 0x8000
-        u8 vram_sample2 = gb->ppu.vram[0x1800]; // 0x9800
-        printf("[NeoBoy] Status | Frame: %u | PC: 0x%04X | SP: 0x%04X | LY: %3u | LCDC: 0x%02X | STAT: 0x%02X | BGP: 0x%02X | VRAM[8000]: 0x%02X | VRAM[9800]: 0x%02X\n", 
-               gb->frame_count, gb->cpu.pc, gb->cpu.sp, gb->ppu.ly, gb->ppu.lcdc, gb->ppu.stat, gb->ppu.bgp, vram_sample1, vram_sample2);
-        fflush(stdout);
+        LOG_DEBUG(LOG_CORE, "Frame %u | PC %04X SP %04X | LY %3u LCDC %02X STAT %02X BGP %02X | VRAM[8000] %02X [9800] %02X",
+                  gb->frame_count, gb->cpu.pc, gb->cpu.sp, gb->ppu.ly, gb->ppu.lcdc, gb->ppu.stat, gb->ppu.bgp,
+                  gb->ppu.vram[0x0000], gb->ppu.vram[0x1800]);
     }
     
     /* Update Cartridge (RTC) */
@@ -188,17 +165,80 @@ void gb_step_frame(void) {
     gb->frame_count++;
 }
 
+uint32_t gb_run_cycles(uint32_t budget, uint32_t stop_mask) {
+    if (gb == NULL || !gb->running) {
+        return GB_STOP_BUDGET;
+    }
+    
+    gb_scheduler_t *sched = &gb->sched;
+    u64 start = sched->now;
+    sched->stop_mask = (u8)stop_mask;
+    sched->stop_reason = 0;
+    sched->deadline = start + budget;
+    gb_cpu_run(&gb->cpu, &gb->mmu, sched);
+    
+    gb->run_cycles = (uint32_t)(sched->now - start);
+    gb_cart_step(&gb->cart, gb->run_cycles);
+    
+    return sched->stop_reason;
+}
+
+uint32_t gb_get_run_cycles(void) {
+    return gb ? gb->run_cycles : 0;
+}
+
+int gb_set_breakpoint(uint16_t addr) {
+    if (gb_cpu_breakpoints.count >= GB_CPU_MAX_BREAKPOINTS) {
+        return -1;
+    }
+    gb_cpu_breakpoints.addr[gb_cpu_breakpoints.count++] = addr;
+    return 0;
+}
+
+void gb_clear_breakpoints(void) {
+    gb_cpu_breakpoints.count = 0;
+    gb_cpu_breakpoints.resume = false;
+}
+
+void gb_set_deferred_render(bool enabled) {
+    if (gb == NULL) {
+        return;
+    }
+    gb_ppu_set_deferred(&gb->ppu, enabled);
+    /* The tile maps lose (or regain) their write pages */
+    gb_mmu_remap(&gb->mmu);
+}
+
+void gb_set_color_correction(bool enabled) {
+    if (gb == NULL) {
+        return;
+    }
+    gb_ppu_set_color_correction(&gb->ppu, enabled);
+}
+
 void gb_set_button(GameBoyButton button, bool pressed) {
     if (gb == NULL) {
         return;
     }
     
+    u8 old_joypad = gb->mmu.joypad;
+    
     /* Update joypad state in MMU */
     if (pressed) {
         gb->mmu.joypad &= ~(1 << button);
     } else {
         gb->mmu.joypad |= (1 << button);
     }
+    
+    /* Joypad interrupt: high-to-low edge on a P1 line whose group is selected.
+     * This is also the only thing that wakes the CPU from STOP. */
+    if (pressed && (old_joypad & (1 << button))) {
+        u8 p1 = gb->mmu.io[IO_JOYP - 0xFF00];
+        bool selected = (button >= BTN_RIGHT) ? !(p1 & 0x10) : !(p1 & 0x20);
+        if (selected) {
+            gb_irq_raise(&gb->mmu.irq, GB_IRQ_JOYPAD);
+        }
+    }
 }
 
 uint8_t* gb_get_framebuffer(void) {
@@ -221,6 +261,99 @@ uint32_t gb_get_audio_buffer_size(void) {
     return 4096;
 }
 
+void gb_set_idle_loop_skip(bool enabled) {
+    gb_cpu_idle_loop.enabled = enabled;
+}
+
+uint32_t gb_get_idle_loop_hits(void) {
+    return gb_cpu_idle_loop.hits;
+}
+
+uint32_t gb_get_idle_loop_cycles(void) {
+    return gb_cpu_idle_loop.cycles;
+}
+
+void gb_set_block_cache(bool enabled) {
+    gb_block_cache.enabled = enabled;
+    gb_block_cache.hits = 0;
+    gb_block_cache.misses = 0;
+    gb_block_cache.invalidations = 0;
+}
+
+uint32_t gb_get_block_cache_hits(void) {
+    return gb_block_cache.hits;
+}
+
+uint32_t gb_get_block_cache_misses(void) {
+    return gb_block_cache.misses;
+}
+
+uint32_t gb_get_block_cache_bytes(void) {
+    return (uint32_t)sizeof(gb_block_cache);
+}
+
+void gb_set_jit(bool enabled) {
+    gb_block_cache.jit = enabled && GB_JIT;
+}
+
+uint32_t gb_get_jit_blocks(void) {
+    return gb_block_cache.jit_blocks;
+}
+
+uint32_t gb_get_log(uint8_t* buffer, uint32_t size) {
+    if (buffer == NULL) {
+        return 0;
+    }
+    return neoboy_log_drain((char*)buffer, size);
+}
+
+int gb_set_trace(uint32_t records) {
+    return gb_trace_enable(records) ? 0 : -1;
+}
+
+uint32_t gb_get_trace(GameBoyTraceRecord* buffer, uint32_t max) {
+    if (buffer == NULL) {
+        return 0;
+    }
+    return gb_trace_snapshot(buffer, max);
+}
+
+uint32_t gb_get_trace_count(void) {
+    return (uint32_t)gb_trace.count;
+}
+
+#if GB_GUEST_PROFILER
+static uint32_t guest_profile_size;
+
+void gb_set_guest_profiler(bool enabled) {
+    if (enabled && !gb_prof.enabled) {
+        gb_prof_reset();
+    }
+    gb_prof.enabled = enabled;
+}
+
+const char* gb_get_guest_profile(uint32_t format) {
+    return gb_prof_export((int)format, &guest_profile_size);
+}
+
+uint32_t gb_get_guest_profile_size(void) {
+    return guest_profile_size;
+}
+#else
+void gb_set_guest_profiler(bool enabled) {
+    (void)enabled;
+}
+
+const char* gb_get_guest_profile(uint32_t format) {
+    (void)format;
+    return "";
+}
+
+uint32_t gb_get_guest_profile_size(void) {
+    return 0;
+}
+#endif
+
 uint32_t gb_save_state(uint8_t* buffer) {
     if (gb == NULL || buffer == NULL) {
         return 0;
@@ -228,6 +361,9 @@ uint32_t gb_save_state(uint8_t* buffer) {
     
     uint8_t* ptr = buffer;
     
+    /* Lines still logged for deferred rendering belong in the framebuffer */
+    gb_ppu_flush_lines(&gb->ppu);
+    
     /* 1. CPU */
     memcpy(ptr, &gb->cpu, sizeof(gb_cpu_t));
     ptr += sizeof(gb_cpu_t);
@@ -263,6 +399,10 @@ uint32_t gb_save_state(uint8_t* buffer) {
     memcpy(ptr, &gb->frame_count, sizeof(uint32_t));
     ptr += sizeof(uint32_t);
     
+    /* 8. Scheduler (master clock and pending events) */
+    memcpy(ptr, &gb->sched, sizeof(gb_scheduler_t));
+    ptr += sizeof(gb_scheduler_t);
+    
     return (uint32_t)(ptr - buffer);
 }
 
@@ -277,8 +417,10 @@ int gb_load_state(const uint8_t* buffer, uint32_t size) {
     memcpy(&gb->cpu, ptr, sizeof(gb_cpu_t));
     ptr += sizeof(gb_cpu_t);
     
-    /* 2. PPU */
+    /* 2. PPU (keeping the current colour correction setting) */
+    bool color_correction = gb->ppu.color_correction;
     memcpy(&gb->ppu, ptr, sizeof(gb_ppu_t));
+    gb->ppu.color_correction = color_correction;
     ptr += sizeof(gb_ppu_t);
     
     /* 3. APU */
@@ -307,12 +449,24 @@ int gb_load_state(const uint8_t* buffer, uint32_t size) {
     memcpy(&gb->frame_count, ptr, sizeof(uint32_t));
     ptr += sizeof(uint32_t);
     
+    /* 8. Scheduler */
+    memcpy(&gb->sched, ptr, sizeof(gb_scheduler_t));
+    ptr += sizeof(gb_scheduler_t);
+    
+    /* Page tables follow the restored MBC, VBK and SVBK state */
+    gb_mmu_remap(&gb->mmu);
+    gb_tile_cache_flush();
+    gb_ppu_refresh_palettes(&gb->ppu);
+    gb_ppu_drop_lines();
+    GB_PROF_UNWIND();
+    
     return 0;
 }
 
 
 
 void gb_destroy(void) {
+    gb_trace_enable(0);
     if (gb != NULL) {
         gb_cart_destroy(&gb->cart);
         free(gb);
@@ -0,0 +1,63 @@
+/**
+ * NeoBoy - Game Boy Interrupt Controller Header
+ *
+ * Purpose: IE/IF registers and the interrupt line sampled by the CPU
+ *
+ * The controller keeps `pending = IE & IF & 0x1F` current on every change
+ * to either register, so the check the CPU makes after each instruction is
+ * a single test of a cached byte rather than two MMU reads. Components
+ * raise their request bit directly with gb_irq_raise().
+ */
+
+#ifndef GB_INTERRUPT_H
+#define GB_INTERRUPT_H
+
+#include "../common/common.h"
+
+/* Interrupt sources (IE/IF bits), highest priority first */
+#define GB_IRQ_VBLANK 0x01
+#define GB_IRQ_STAT   0x02
+#define GB_IRQ_TIMER  0x04
+#define GB_IRQ_SERIAL 0x08
+#define GB_IRQ_JOYPAD 0x10
+#define GB_IRQ_MASK   0x1F
+
+typedef struct gb_irq_t {
+    u8 ie;       /* Interrupt Enable (0xFFFF) */
+    u8 flags;    /* Interrupt Flag (0xFF0F) */
+    u8 pending;  /* Enabled and requested: ie & flags & GB_IRQ_MASK */
+} gb_irq_t;
+
+static inline void gb_irq_update(gb_irq_t *irq) {
+    irq->pending = irq->ie & irq->flags & GB_IRQ_MASK;
+}
+
+static inline void gb_irq_reset(gb_irq_t *irq) {
+    irq->ie = 0;
+    irq->flags = 0;
+    irq->pending = 0;
+}
+
+/* Request one or more interrupts */
+static inline void gb_irq_raise(gb_irq_t *irq, u8 lines) {
+    irq->flags |= lines;
+    gb_irq_update(irq);
+}
+
+/* Clear a request as the CPU dispatches it */
+static inline void gb_irq_ack(gb_irq_t *irq, u8 line) {
+    irq->flags &= (u8)~line;
+    gb_irq_update(irq);
+}
+
+static inline void gb_irq_write_ie(gb_irq_t *irq, u8 value) {
+    irq->ie = value;
+    gb_irq_update(irq);
+}
+
+static inline void gb_irq_write_if(gb_irq_t *irq, u8 value) {
+    irq->flags = value;
+    gb_irq_update(irq);
+}
+
+#endif /* GB_INTERRUPT_H */
@@ -0,0 +1,360 @@
+/**
+ * NeoBoy - Game Boy Block JIT (Emscripten JS library)
+ *
+ * Purpose: Compile hot register-only LR35902 runs into WebAssembly
+ *
+ * Linked into the web build with --js-library. Once a translated block
+ * (block.h) has been entered GB_JIT_THRESHOLD times, block.c passes the
+ * guest code of its leading register-only instructions to gb_jit_compile().
+ * That emits a one-function module `run(cpu)`, instantiates it against the
+ * core's own linear memory and adds the function to the indirect function
+ * table; the returned table index is what C calls through a gb_jit_fn_t.
+ *
+ * The generated code keeps the registers in locals: it loads them from
+ * gb_cpu_t on entry, computes every instruction exactly as the handlers in
+ * cpu.c do (lazy flags included) and stores back what changed. Nothing else
+ * in memory is touched, which is why only instructions without memory
+ * operands are ever compiled: loads, stores and I/O stay with the
+ * interpreter.
+ *
+ * Only the standard WebAssembly JS API is used, so the JIT works the same
+ * in the browser and in Node.
+ */
+
+var LibraryGBJit = {
+    $GBJit: {
+        /* Byte offsets of the registers in gb_cpu_t (jit_layout in block.c) */
+        layout: null,
+
+        /* Browsers refuse to compile larger modules synchronously on the
+         * main thread; longer runs stay interpreted */
+        maxModuleBytes: 4096,
+
+        uleb: function (out, value) {
+            do {
+                var byte = value & 0x7F;
+                value >>>= 7;
+                out.push(value ? byte | 0x80 : byte);
+            } while (value);
+        },
+
+        sleb: function (out, value) {
+            for (;;) {
+                var byte = value & 0x7F;
+                value >>= 7;
+                if ((value === 0 && !(byte & 0x40)) || (value === -1 && (byte & 0x40))) {
+                    out.push(byte);
+                    return;
+                }
+                out.push(byte | 0x80);
+            }
+        },
+
+        /* Function body for `count` instructions at code[0..] */
+        emitBody: function (code, count, layout) {
+            // Locals: 0 is the gb_cpu_t pointer, then the registers in
+            // jit_layout order and two temporaries
+            var B = 1, C = 2, D = 3, E = 4, H = 5, L = 6, A = 7;
+            var FZ = 8, FN = 9, FH = 10, FC = 11, SP = 12, T0 = 13, T1 = 14;
+            var R8 = [B, C, D, E, H, L, -1, A]; // Operand encoding order, (HL) never compiled
+            var IME = 12, EI_DELAY = 13;        // Layout indices of the non-register fields
+            var UNUSED = [0xD3, 0xDB, 0xDD, 0xE3, 0xE4, 0xEB, 0xEC, 0xED, 0xF4, 0xFC, 0xFD];
+
+            var body = [];
+            var written = {};
+            var di = false;
+
+            function emit() {
+                for (var i = 0; i < arguments.length; i++) {
+                    var part = arguments[i];
+                    if (typeof part === 'number') {
+                        body.push(part);
+                    } else {
+                        for (var j = 0; j < part.length; j++) body.push(part[j]);
+                    }
+                }
+            }
+            function get(r) { return [0x20, r]; }
+            function set(r) { written[r] = true; return [0x21, r]; }
+            function tee(r) { written[r] = true; return [0x22, r]; }
+            function k(n) { var out = [0x41]; GBJit.sleb(out, n); return out; }
+
+            var ADD = 0x6A, SUB = 0x6B, MUL = 0x6C, AND = 0x71, OR = 0x72, XOR = 0x73;
+            var SHL = 0x74, SHR_U = 0x76, EQZ = 0x45, GT_U = 0x4B, SELECT = 0x1B;
+
+            // Register pairs, as a 16-bit value and back
+            function pair(hi, lo) { return [].concat(get(hi), k(8), SHL, get(lo), OR); }
+            function setPair(hi, lo, value) {
+                emit(value, set(T0),
+                     get(T0), k(8), SHR_U, k(0xFF), AND, set(hi),
+                     get(T0), k(0xFF), AND, set(lo));
+            }
+            var PAIRS = [[B, C], [D, E], [H, L]];
+            function rr(index) { return index < 3 ? pair(PAIRS[index][0], PAIRS[index][1]) : get(SP); }
+            function setRR(index, value) {
+                if (index < 3) {
+                    setPair(PAIRS[index][0], PAIRS[index][1], value);
+                } else {
+                    emit(value, set(SP));
+                }
+            }
+
+            // Flag constants
+            function flags(z, n, h) {
+                if (z !== null) emit(k(z), set(FZ));
+                if (n !== null) emit(k(n), set(FN));
+                if (h !== null) emit(k(h), set(FH));
+            }
+
+            // ADD/ADC/SUB/SBC/AND/XOR/OR/CP on A, operand pushed by `value`
+            function alu(kind, value) {
+                switch (kind) {
+                    case 0: case 1: case 2: case 3: case 7: {
+                        var sub = kind >= 2;
+                        emit(value, set(T0), get(A), get(T0), sub ? SUB : ADD);
+                        if (kind === 1 || kind === 3) emit(get(FC), sub ? SUB : ADD);
+                        emit(set(T1),
+                             k(sub ? 1 : 0), set(FN),
+                             get(A), get(T0), XOR, get(T1), XOR, k(0xFF), AND, set(FH),
+                             get(T1), k(8), SHR_U, k(1), AND, set(FC),
+                             get(T1), k(0xFF), AND);
+                        emit(kind === 7 ? set(FZ) : [].concat(tee(FZ), set(A)));
+                        break;
+                    }
+                    case 4: case 5: case 6:
+                        emit(get(A), value, kind === 4 ? AND : kind === 5 ? XOR : OR, tee(FZ), set(A));
+                        flags(null, 0, kind === 4 ? 0x10 : 0);
+                        emit(k(0), set(FC));
+                        break;
+                }
+            }
+
+            // CB shifts and rotates on local r: 0 RLC, 1 RRC, 2 RL, 3 RR,
+            // 4 SLA, 5 SRA, 6 SWAP, 7 SRL. Leaves N/H/Z to the caller.
+            function shift(kind, r) {
+                switch (kind) {
+                    case 0: // C = bit 7, r = r << 1 | C
+                        emit(get(r), k(7), SHR_U, set(FC),
+                             get(r), k(1), SHL, get(FC), OR, k(0xFF), AND, set(r));
+                        break;
+                    case 1: // C = bit 0, r = r >> 1 | C << 7
+                        emit(get(r), k(1), AND, set(FC),
+                             get(r), k(1), SHR_U, get(FC), k(7), SHL, OR, set(r));
+                        break;
+                    case 2:
+                        emit(get(r), k(7), SHR_U, set(T0),
+                             get(r), k(1), SHL, get(FC), OR, k(0xFF), AND, set(r),
+                             get(T0), set(FC));
+                        break;
+                    case 3:
+                        emit(get(r), k(1), AND, set(T0),
+                             get(r), k(1), SHR_U, get(FC), k(7), SHL, OR, set(r),
+                             get(T0), set(FC));
+                        break;
+                    case 4:
+                        emit(get(r), k(7), SHR_U, set(FC),
+                             get(r), k(1), SHL, k(0xFF), AND, set(r));
+                        break;
+                    case 5:
+                        emit(get(r), k(1), AND, set(FC),
+                             get(r), k(1), SHR_U, get(r), k(0x80), AND, OR, set(r));
+                        break;
+                    case 6:
+                        emit(get(r), k(4), SHL, get(r), k(4), SHR_U, OR, k(0xFF), AND, set(r),
+                             k(0), set(FC));
+                        break;
+                    case 7:
+                        emit(get(r), k(1), AND, set(FC),
+                             get(r), k(1), SHR_U, set(r));
+                        break;
+                }
+            }
+
+            // SP + signed immediate (ADD SP,n and LD HL,SP+n) into T1
+            function spRel(imm) {
+                var rel = ((imm << 24) >> 24) & 0xFFFF;
+                emit(get(SP), k(rel), ADD, k(0xFFFF), AND, set(T1),
+                     get(SP), k(rel), XOR, get(T1), XOR, set(T0),
+                     get(T0), k(0xFF), AND, set(FH),
+                     get(T0), k(8), SHR_U, k(1), AND, set(FC));
+                flags(1, 0, null);
+            }
+
+            var pc = 0;
+            for (var n = 0; n < count; n++) {
+                var op = code[pc];
+                var imm8 = code[pc + 1];
+                var imm16 = code[pc + 1] | (code[pc + 2] << 8);
+                var x = op >> 6, y = (op >> 3) & 7, z = op & 7;
+
+                if (op === 0xCB) {
+                    var cb = code[pc + 1];
+                    var r = R8[cb & 7];
+                    var bit = 1 << ((cb >> 3) & 7);
+                    switch (cb >> 6) {
+                        case 0:
+                            shift((cb >> 3) & 7, r);
+                            emit(get(r), set(FZ));
+                            flags(null, 0, 0);
+                            break;
+                        case 1: emit(get(r), k(bit), AND, set(FZ)); flags(null, 0, 0x10); break;
+                        case 2: emit(get(r), k(0xFF ^ bit), AND, set(r)); break;
+                        case 3: emit(get(r), k(bit), OR, set(r)); break;
+                    }
+                    pc += 2;
+                    continue;
+                }
+
+                if (x === 1) {
+                    emit(get(R8[z]), set(R8[y]));                 // LD r, r
+                } else if (x === 2) {
+                    alu(y, get(R8[z]));                           // ALU A, r
+                } else if (x === 3 && z === 6) {
+                    alu(y, k(imm8));                              // ALU A, d8
+                } else if (x === 0 && z === 6) {
+                    emit(k(imm8), set(R8[y]));                    // LD r, d8
+                } else if (x === 0 && z === 1 && !(y & 1)) {
+                    setRR(y >> 1, k(imm16));                      // LD rr, d16
+                } else if (x === 0 && z === 3) {                  // INC rr / DEC rr
+                    setRR(y >> 1, [].concat(rr(y >> 1), k(1), (y & 1) ? SUB : ADD, k(0xFFFF), AND));
+                } else if (x === 0 && (z === 4 || z === 5)) {     // INC r / DEC r
+                    var reg = R8[y];
+                    emit(get(reg), k(1), z === 4 ? ADD : SUB, k(0xFF), AND, set(T1),
+                         k(z === 4 ? 0 : 1), set(FN),
+                         get(reg), k(1), XOR, get(T1), XOR, set(FH),
+                         get(T1), tee(FZ), set(reg));
+                } else if (x === 0 && z === 1) {                  // ADD HL, rr
+                    emit(rr(y >> 1), set(T0),
+                         pair(H, L), get(T0), ADD, set(T1),
+                         k(0), set(FN),
+                         pair(H, L), get(T0), XOR, get(T1), XOR, k(8), SHR_U, k(0xFF), AND, set(FH),
+                         get(T1), k(16), SHR_U, set(FC));
+                    setPair(H, L, [].concat(get(T1), k(0xFFFF), AND));
+                } else if (x === 0 && z === 7) {
+                    switch (y) {
+                        case 0: case 1: case 2: case 3:           // RLCA RRCA RLA RRA
+                            shift(y, A);
+                            flags(1, 0, 0);
+                            break;
+                        case 4:                                   // DAA
+                            emit(get(FH), k(4), SHR_U, k(1), AND,
+                                 get(FN), EQZ, get(A), k(0x0F), AND, k(9), GT_U, AND, OR,
+                                 k(0x06), MUL, set(T0),
+                                 get(FC), get(FN), EQZ, get(A), k(0x99), GT_U, AND, OR, set(T1),
+                                 get(T0), get(T1), k(0x60), MUL, OR, set(T0),
+                                 get(T1), set(FC),
+                                 get(A), get(T0), SUB, get(A), get(T0), ADD, get(FN), SELECT,
+                                 k(0xFF), AND, tee(FZ), set(A),
+                                 k(0), set(FH));
+                            break;
+                        case 5:                                   // CPL
+                            emit(get(A), k(0xFF), XOR, set(A));
+                            flags(null, 1, 0x10);
+                            break;
+                        case 6:                                   // SCF
+                            flags(null, 0, 0);
+                            emit(k(1), set(FC));
+                            break;
+                        case 7:                                   // CCF
+                            flags(null, 0, 0);
+                            emit(get(FC), k(1), XOR, set(FC));
+                            break;
+                    }
+                } else if (op === 0xE8) {                         // ADD SP, r8
+                    spRel(imm8);
+                    emit(get(T1), set(SP));
+                } else if (op === 0xF8) {                         // LD HL, SP+r8
+                    spRel(imm8);
+                    setPair(H, L, get(T1));
+                } else if (op === 0xF9) {                         // LD SP, HL
+                    emit(pair(H, L), set(SP));
+                } else if (op === 0xF3) {                         // DI
+                    di = true;
+                } else if (op !== 0x00 && UNUSED.indexOf(op) < 0) {
+                    return null; // Not a register-only instruction: leave it to the interpreter
+                }
+                // NOP and the unused opcodes do nothing
+
+                var length = (x === 0 && z === 1 && !(y & 1)) ? 3
+                           : (x === 0 && z === 6) || (x === 3 && z === 6) || op === 0xE8 || op === 0xF8 ? 2 : 1;
+                pc += length;
+            }
+
+            // Prologue: registers into locals. Epilogue: changed ones back.
+            var prologue = [];
+            var epilogue = [];
+            for (var local = B; local <= SP; local++) {
+                var offset = layout[local - 1];
+                var wide = local === SP;
+                prologue.push(0x20, 0, wide ? 0x2F : 0x2D, wide ? 1 : 0);
+                GBJit.uleb(prologue, offset);
+                prologue.push(0x21, local);
+                if (written[local]) {
+                    epilogue.push(0x20, 0, 0x20, local, wide ? 0x3B : 0x3A, wide ? 1 : 0);
+                    GBJit.uleb(epilogue, offset);
+                }
+            }
+            if (di) {
+                [IME, EI_DELAY].forEach(function (field) {
+                    epilogue.push(0x20, 0, 0x41, 0, 0x3A, 0);
+                    GBJit.uleb(epilogue, layout[field]);
+                });
+            }
+
+            // One local declaration: 14 x i32
+            return [1, T1, 0x7F].concat(prologue, body, epilogue, [0x0B]);
+        },
+
+        section: function (out, id, content) {
+            out.push(id);
+            GBJit.uleb(out, content.length);
+            for (var i = 0; i < content.length; i++) out.push(content[i]);
+        },
+
+        /* Complete module: imports env.memory, exports run(cpu) */
+        emitModule: function (body) {
+            var out = [0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00];
+            GBJit.section(out, 1, [1, 0x60, 1, 0x7F, 0]);                    // type (i32) -> ()
+            GBJit.section(out, 2, [1, 3, 0x65, 0x6E, 0x76,                    // "env"
+                                   6, 0x6D, 0x65, 0x6D, 0x6F, 0x72, 0x79,     // "memory"
+                                   0x02, 0x00, 1]);                           // memory, min 1 page
+            GBJit.section(out, 3, [1, 0]);                                    // func 0 : type 0
+            GBJit.section(out, 7, [1, 3, 0x72, 0x75, 0x6E, 0x00, 0]);         // export "run"
+            var code = [1];
+            GBJit.uleb(code, body.length);
+            GBJit.section(out, 10, code.concat(body));
+            return new Uint8Array(out);
+        },
+    },
+
+    /* Returns the table index of the compiled run, 0 if it was not compiled */
+    gb_jit_compile__deps: ['$GBJit', '$addFunction'],
+    gb_jit_compile: function (code, count, layout) {
+        if (!GBJit.layout) {
+            GBJit.layout = Array.from(HEAPU8.subarray(layout, layout + 14));
+        }
+        var body = GBJit.emitBody(HEAPU8.subarray(code, code + count * 3), count, GBJit.layout);
+        if (!body) {
+            return 0;
+        }
+        var bytes = GBJit.emitModule(body);
+        if (bytes.length > GBJit.maxModuleBytes) {
+            return 0;
+        }
+        try {
+            var instance = new WebAssembly.Instance(new WebAssembly.Module(bytes), {
+                env: { memory: wasmMemory },
+            });
+            return addFunction(instance.exports.run, 'vi');
+        } catch (e) {
+            return 0; // No runtime compilation here (CSP, table growth disabled): interpret
+        }
+    },
+
+    gb_jit_free__deps: ['$removeFunction'],
+    gb_jit_free: function (fn) {
+        removeFunction(fn);
+    },
+};
+
+mergeInto(LibraryManager.library, LibraryGBJit);
@@ -4,20 +4,26 @@
  * Purpose: Memory access routing and I/O register handling
  */
 
+#include "core.h"
 #include "mmu.h"
+#include "block.h"
+#include "tile_cache.h"
 #include "ppu.h"
 #include "apu.h"
 #include "cartridge.h"
+#include "scheduler.h"
+#include "../common/log.h"
 #include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
 
-void gb_mmu_init(gb_mmu_t *mmu, gb_ppu_t *ppu, gb_apu_t *apu, gb_cartridge_t *cart) {
+void gb_mmu_init(gb_mmu_t *mmu, gb_ppu_t *ppu, gb_apu_t *apu, gb_cartridge_t *cart, gb_scheduler_t *sched) {
     memset(mmu, 0, sizeof(gb_mmu_t));
     mmu->ppu = ppu;
     mmu->apu = apu;
     mmu->cart = cart;
+    mmu->sched = sched;
     mmu->joypad = 0xFF;
+    gb_mmu_remap(mmu);
 }
 
 void gb_mmu_reset(gb_mmu_t *mmu) {
@@ -30,97 +36,338 @@ void gb_mmu_reset(gb_mmu_t *mmu) {
     mmu->svbk = 0x01;  /* WRAM bank 1 selected by default */
     mmu->key1 = 0x00;
     mmu->speed = false; /* Normal speed */
+    mmu->hdma5 = 0xFF;
     mmu->hdma_active = false;
+    mmu->oam_dma = false;
+    mmu->timer_sync = mmu->sched->now;
+    gb_irq_reset(&mmu->irq);
     
     if (mmu->ppu) {
         mmu->ppu->vbk = 0x00; /* VRAM bank 0 selected by default */
     }
+    gb_mmu_remap(mmu);
 }
 
-static void request_interrupt(gb_mmu_t *mmu, u8 interrupt) {
-    u8 if_reg = gb_mmu_read(mmu, 0xFF0F);
-    gb_mmu_write(mmu, 0xFF0F, if_reg | interrupt);
+/* --- Page tables --- */
+
+#ifdef GB_BENCH
+u64 gb_mmu_fetch_misses = 0;
+bool gb_mmu_fetch_window = true;
+#endif
+
+/* Any page-table change may move the memory under the fetch window */
+static inline void close_fetch_window(gb_mmu_t *mmu) {
+    mmu->fetch_len = 0;
 }
 
-void gb_mmu_step_timers(gb_mmu_t *mmu, u32 cycles) {
-    /* DIV is always incremented at 16384Hz (every 256 cycles) */
-    u16 old_div = mmu->div_counter;
-    mmu->div_counter += cycles;
-    mmu->io[IO_DIV - 0xFF00] = (u8)(mmu->div_counter >> 8);
+/* Pages [first, first + count) of a 16KB ROM or 8KB RAM region. A bank
+ * that lies wholly inside the image is contiguous, so it is filled from its
+ * first page; otherwise each page is looked up (and may stay unmapped). */
+static void map_cart_region(gb_mmu_t *mmu, u16 first, u16 count, bool rom) {
+    u16 last = first + count - 1;
+    u8 *base = rom ? gb_cart_rom_page(mmu->cart, first << 8)
+                   : gb_cart_ram_page(mmu->cart, (first - 0xA0) << 8);
+    u8 *end = rom ? gb_cart_rom_page(mmu->cart, last << 8)
+                  : gb_cart_ram_page(mmu->cart, (last - 0xA0) << 8);
 
-    /* TIMA (Timer Counter) */
-    u8 tac = mmu->io[IO_TAC - 0xFF00];
-    if (tac & 0x04) { /* Timer enabled */
-        u32 threshold = 0;
-        switch (tac & 0x03) {
-            case 0: threshold = 1024; break; /* 4096 Hz */
-            case 1: threshold = 16;   break; /* 262144 Hz */
-            case 2: threshold = 64;   break; /* 65536 Hz */
-            case 3: threshold = 256;  break; /* 16384 Hz */
+    for (u16 page = first; page <= last; page++) {
+        u8 *ptr;
+        if (base && end == base + ((last - first) << 8)) {
+            ptr = base + ((page - first) << 8);
+        } else {
+            ptr = rom ? gb_cart_rom_page(mmu->cart, page << 8)
+                      : gb_cart_ram_page(mmu->cart, (page - 0xA0) << 8);
         }
+        mmu->read_page[page] = ptr;
+        mmu->write_page[page] = rom ? NULL : ptr; /* ROM writes are MBC commands */
+    }
+}
 
-        mmu->tima_counter += cycles;
-        while (mmu->tima_counter >= threshold) {
-            mmu->tima_counter -= threshold;
-            if (mmu->io[IO_TIMA - 0xFF00] == 0xFF) {
-                /* Overflow: set TIMA to TMA and request interrupt */
-                mmu->io[IO_TIMA - 0xFF00] = mmu->io[IO_TMA - 0xFF00];
-                request_interrupt(mmu, 0x04); /* Timer interrupt */
-            } else {
-                mmu->io[IO_TIMA - 0xFF00]++;
-            }
+/* ROM and external RAM under the current MBC state */
+static void map_cart(gb_mmu_t *mmu) {
+    close_fetch_window(mmu);
+    gb_block_invalidate_range(mmu, 0xA0, 0xBF);
+    map_cart_region(mmu, 0x00, 0x40, true);
+    map_cart_region(mmu, 0x40, 0x40, true);
+    map_cart_region(mmu, 0xA0, 0x20, false);
+}
+
+/* VRAM bank selected by VBK */
+static void map_vram(gb_mmu_t *mmu) {
+    close_fetch_window(mmu);
+    gb_block_invalidate_range(mmu, 0x80, 0x9F);
+    u8 *vram = mmu->ppu->vram + ((mmu->ppu->vbk & 0x01) ? 0x2000 : 0);
+    for (u16 page = 0x80; page < 0xA0; page++) {
+        mmu->read_page[page] = vram + ((page - 0x80) << 8);
+        /* Tile data writes go to the slow path to reach the tile cache, and
+         * with deferred rendering the tile maps' too, for the PPU's journal */
+        mmu->write_page[page] = (page < 0x98 || gb_ppu_deferred) ? NULL : vram + ((page - 0x80) << 8);
+    }
+}
+
+/* WRAM bank 0, the bank selected by SVBK (0 reads as 1) and their echo */
+static void map_wram(gb_mmu_t *mmu) {
+    close_fetch_window(mmu);
+    gb_block_invalidate_range(mmu, 0xC0, 0xFD);
+    u8 bank = mmu->svbk & 0x07;
+    if (bank == 0) bank = 1;
+    u8 *banked = mmu->wram + bank * 0x1000;
+
+    for (u16 page = 0; page < 0x10; page++) {
+        u8 *fixed = mmu->wram + (page << 8);
+        mmu->read_page[0xC0 + page] = mmu->write_page[0xC0 + page] = fixed;
+        mmu->read_page[0xE0 + page] = mmu->write_page[0xE0 + page] = fixed;
+        mmu->read_page[0xD0 + page] = mmu->write_page[0xD0 + page] = banked + (page << 8);
+        if (page < 0x0E) { /* Echo stops at 0xFDFF */
+            mmu->read_page[0xF0 + page] = mmu->write_page[0xF0 + page] = banked + (page << 8);
         }
     }
 }
 
-u8 gb_mmu_read(gb_mmu_t *mmu, u16 addr) {
-    /* ROM Banks (via cartridge) */
-    if (addr < 0x8000) {
-        return gb_cart_read(mmu->cart, addr);
+/* While OAM DMA runs the CPU sees only I/O and HRAM: every page below
+ * OAM is taken out of the tables so accesses reach the slow handlers, which
+ * ignore them. The entries are set aside as they are, write protection
+ * included, and put back by bus_unlock(). */
+static void bus_lock(gb_mmu_t *mmu) {
+    close_fetch_window(mmu);
+    memcpy(mmu->dma_read_page, mmu->read_page, sizeof(mmu->dma_read_page));
+    memcpy(mmu->dma_write_page, mmu->write_page, sizeof(mmu->dma_write_page));
+    memset(mmu->read_page, 0, sizeof(mmu->dma_read_page));
+    memset(mmu->write_page, 0, sizeof(mmu->dma_write_page));
+}
+
+static void bus_unlock(gb_mmu_t *mmu) {
+    close_fetch_window(mmu);
+    memcpy(mmu->read_page, mmu->dma_read_page, sizeof(mmu->dma_read_page));
+    memcpy(mmu->write_page, mmu->dma_write_page, sizeof(mmu->dma_write_page));
+}
+
+/* Re-map a region with map_vram()/map_wram() (VBK and SVBK stay writable
+ * during OAM DMA), on the real tables */
+static void remap_region(gb_mmu_t *mmu, void (*map)(gb_mmu_t *)) {
+    if (mmu->oam_dma) {
+        bus_unlock(mmu);
+        map(mmu);
+        bus_lock(mmu);
+    } else {
+        map(mmu);
     }
-    
-    /* VRAM (Banked) */
-    if (addr >= 0x8000 && addr < 0xA000) {
-        /* Route to PPU with bank info. For now, since gb_ppu_read_vram expects offset from start of VRAM,
-           we need to update it to support banking. But wait, mmu.h struct has array. 
-           Let's handle banking here by calculating the correct offset into the flat 16KB array. */
-        u16 vram_offset = addr - 0x8000;
-        if (mmu->ppu->vbk & 0x01) {
-            vram_offset += 0x2000; /* Bank 1 at offset 8KB */
+}
+
+void gb_mmu_remap(gb_mmu_t *mmu) {
+    close_fetch_window(mmu);
+    gb_block_flush(mmu);
+    memset(mmu->read_page, 0, sizeof(mmu->read_page));
+    memset(mmu->write_page, 0, sizeof(mmu->write_page));
+    map_cart(mmu);
+    if (mmu->ppu) {
+        map_vram(mmu);
+    }
+    map_wram(mmu);
+    if (mmu->oam_dma) {
+        bus_lock(mmu); /* State loaded mid-transfer */
+    }
+}
+
+static void oam_dma_start(gb_mmu_t *mmu, u8 page) {
+    mmu->io[IO_DMA - 0xFF00] = page;
+    if (!mmu->oam_dma) {
+        mmu->oam_dma = true;
+        bus_lock(mmu);
+    }
+    /* A restart runs the full transfer again from the new source */
+    gb_sched_schedule(mmu->sched, GB_EVENT_OAM_DMA, mmu->sched->now + GB_OAM_DMA_CYCLES);
+}
+
+void gb_mmu_oam_dma_event(gb_mmu_t *mmu) {
+    bus_unlock(mmu);
+    mmu->oam_dma = false;
+
+    /* Sources from E000 up read WRAM, as the echo does */
+    u8 page = mmu->io[IO_DMA - 0xFF00];
+    if (page >= 0xE0) {
+        page -= 0x20;
+    }
+    gb_ppu_log_write(mmu->ppu, GB_PPU_LOG_OAM, 0xA0);
+    const u8 *src = mmu->read_page[page];
+    if (src) {
+        memcpy(mmu->ppu->oam, src, 0xA0);
+    } else {
+        /* Cartridge RAM that is disabled, banked out or an RTC register */
+        for (u16 i = 0; i < 0xA0; i++) {
+            mmu->ppu->oam[i] = gb_mmu_read_slow(mmu, (page << 8) | i);
         }
-        return mmu->ppu->vram[vram_offset];
     }
-    
-    /* External RAM (via cartridge) */
-    if (addr >= 0xA000 && addr < 0xC000) {
-        return gb_cart_read_ram(mmu->cart, addr - 0xA000);
+    gb_ppu_refresh_oam(mmu->ppu);
+}
+
+u16 gb_mmu_code_bank(const gb_mmu_t *mmu, u16 pc) {
+    const gb_cartridge_t *cart = mmu->cart;
+    if (pc >= 0x8000 || !cart || !cart->rom) {
+        return 0;
     }
-    
-    /* Work RAM (Bank 0) */
-    if (addr >= 0xC000 && addr < 0xD000) {
-        return mmu->wram[addr - 0xC000];
+    /* Whichever bank the page table points into, whatever the MBC */
+    const u8 *page = mmu->read_page[pc >> 8];
+    if (page < cart->rom || page >= cart->rom + cart->rom_size) {
+        return 0;
+    }
+    return (u16)((page - cart->rom) >> 14);
+}
+
+/* TIMA input clock periods in CPU cycles, indexed by TAC bits 0-1. TIMA
+ * counts the falling edges of divider bit log2(period) - 1. */
+static const u32 timer_periods[4] = {
+    1024, /* 4096 Hz, bit 9 */
+    16,   /* 262144 Hz, bit 3 */
+    64,   /* 65536 Hz, bit 5 */
+    256   /* 16384 Hz, bit 7 */
+};
+
+/* Level of the TIMA input: the selected divider bit, gated by TAC enable */
+static bool timer_input(const gb_mmu_t *mmu) {
+    u8 tac = mmu->io[IO_TAC - 0xFF00];
+    return (tac & 0x04) && (mmu->div_counter & (timer_periods[tac & 0x03] >> 1));
+}
+
+static void timer_tick(gb_mmu_t *mmu, u64 ticks) {
+    while (ticks > 0) {
+        u32 to_overflow = 0x100 - mmu->io[IO_TIMA - 0xFF00];
+        if (ticks < to_overflow) {
+            mmu->io[IO_TIMA - 0xFF00] += (u8)ticks;
+            break;
+        }
+        /* Overflow: set TIMA to TMA and request interrupt */
+        ticks -= to_overflow;
+        mmu->io[IO_TIMA - 0xFF00] = mmu->io[IO_TMA - 0xFF00];
+        gb_irq_raise(&mmu->irq, GB_IRQ_TIMER);
+    }
+}
+
+/* Bring DIV/TIMA up to `target`. The timer is not ticked per instruction:
+ * the counters catch up here whenever a timer register is accessed, and the
+ * scheduler fires GB_EVENT_TIMER on the cycle TIMA overflows. */
+static void timer_sync(gb_mmu_t *mmu, u64 target) {
+    u64 elapsed = target - mmu->timer_sync;
+    u32 div = mmu->div_counter;
+    mmu->timer_sync = target;
+
+    /* DIV is always incremented at 16384Hz (every 256 cycles) */
+    mmu->div_counter = (u16)(div + elapsed);
+    mmu->io[IO_DIV - 0xFF00] = (u8)(mmu->div_counter >> 8);
+
+    /* TIMA (Timer Counter): one tick per falling edge passed */
+    u8 tac = mmu->io[IO_TAC - 0xFF00];
+    if (!(tac & 0x04)) return; /* Timer disabled */
+
+    u32 period = timer_periods[tac & 0x03];
+    timer_tick(mmu, ((div & (period - 1)) + elapsed) / period);
+}
+
+/* Schedule the next TIMA overflow from the state at `timer_sync`: the
+ * falling edge that takes TIMA past 0xFF */
+static void timer_schedule(gb_mmu_t *mmu) {
+    u8 tac = mmu->io[IO_TAC - 0xFF00];
+    if (!(tac & 0x04)) {
+        gb_sched_cancel(mmu->sched, GB_EVENT_TIMER);
+        return;
+    }
+
+    u32 period = timer_periods[tac & 0x03];
+    u64 delay = (u64)(0x100 - mmu->io[IO_TIMA - 0xFF00]) * period - (mmu->div_counter & (period - 1));
+    gb_sched_schedule(mmu->sched, GB_EVENT_TIMER, mmu->timer_sync + delay);
+}
+
+void gb_mmu_timer_event(gb_mmu_t *mmu, u64 when) {
+    timer_sync(mmu, when);
+    timer_schedule(mmu);
+}
+
+/* Text sent over the link port (test ROMs report results this way), logged
+ * a line at a time */
+static void serial_log(u8 byte) {
+#if LOG_ENABLED(LOG_LEVEL_INFO)
+    static char line[LOG_TEXT_MAX + 1];
+    static u32 length;
+    if (byte != '\n') {
+        line[length++] = (char)byte;
+    }
+    if (byte == '\n' || length == LOG_TEXT_MAX) {
+        line[length] = '\0';
+        LOG_INFO(LOG_SERIAL, "%s", line);
+        length = 0;
+    }
+#else
+    (void)byte;
+#endif
+}
+
+void gb_mmu_serial_event(gb_mmu_t *mmu) {
+    /* No link partner: the bits shifted in are all 1s */
+    mmu->io[IO_SB - 0xFF00] = 0xFF;
+    mmu->io[IO_SC - 0xFF00] &= 0x7F; /* Transfer complete */
+    gb_irq_raise(&mmu->irq, GB_IRQ_SERIAL);
+}
+
+/* First and last page of the mapping region each 4KB block belongs to.
+ * The map_* functions lay a region out either as one contiguous host block
+ * or page by page, so matching end pages mean the whole region is one block. */
+static const u8 fetch_regions[16][2] = {
+    {0x00, 0x3F}, {0x00, 0x3F}, {0x00, 0x3F}, {0x00, 0x3F}, /* ROM bank 0 */
+    {0x40, 0x7F}, {0x40, 0x7F}, {0x40, 0x7F}, {0x40, 0x7F}, /* ROM bank N */
+    {0x80, 0x9F}, {0x80, 0x9F},                             /* VRAM */
+    {0xA0, 0xBF}, {0xA0, 0xBF},                             /* External RAM */
+    {0xC0, 0xCF}, {0xD0, 0xDF},                             /* WRAM 0, WRAM N */
+    {0xE0, 0xEF}, {0xF0, 0xFD},                             /* Echo */
+};
+
+u8 gb_mmu_fetch_miss(gb_mmu_t *mmu, u16 addr) {
+#ifdef GB_BENCH
+    gb_mmu_fetch_misses++;
+    if (!gb_mmu_fetch_window) return gb_mmu_read(mmu, addr);
+#endif
+    u8 page = addr >> 8;
+    const u8 *ptr = mmu->read_page[page];
+    if (!ptr) {
+        /* I/O, HRAM, OAM or unmapped cartridge space: no window */
+        mmu->fetch_len = 0;
+        return gb_mmu_read_slow(mmu, addr);
+    }
+
+    u8 first = fetch_regions[addr >> 12][0];
+    u8 last = fetch_regions[addr >> 12][1];
+    const u8 *base = mmu->read_page[first];
+    if (page <= last && base && ptr == base + ((page - first) << 8) &&
+        mmu->read_page[last] == base + ((last - first) << 8)) {
+        mmu->fetch_ptr = base;
+        mmu->fetch_start = first << 8;
+        mmu->fetch_len = (last - first + 1) << 8;
+    } else {
+        mmu->fetch_ptr = ptr;
+        mmu->fetch_start = page << 8;
+        mmu->fetch_len = 0x100;
+    }
+    return ptr[addr & 0xFF];
+}
+
+u8 gb_mmu_read_slow(gb_mmu_t *mmu, u16 addr) {
+    /* High RAM (shares page 0xFF with I/O, so it never gets a page pointer) */
+    if (addr >= 0xFF80 && addr < 0xFFFF) {
+        return mmu->hram[addr - 0xFF80];
+    }
+
+    /* The OAM DMA owns the bus */
+    if (mmu->oam_dma && addr < 0xFF00) {
+        return 0xFF;
     }
     
-    /* Work RAM (Bank 1-7, Switchable) */
-    if (addr >= 0xD000 && addr < 0xE000) {
-        u8 bank = mmu->svbk & 0x07;
-        if (bank == 0) bank = 1; /* Bank 0 is treated as Bank 1 for 0xD000-0xDFFF access */
-        u32 offset = (bank * 0x1000) + (addr - 0xD000);
-        return mmu->wram[offset];
+    /* ROM pages that wrap around a short image */
+    if (addr < 0x8000) {
+        return gb_cart_read(mmu->cart, addr);
     }
     
-    /* Echo RAM (mirror of WRAM) */
-    if (addr >= 0xE000 && addr < 0xFE00) {
-        /* Echo varies depending on bank, but usually mirrors C000-DDFF. 
-           Let's just map it to WRAM simply for now as standard behavior. */
-        if (addr < 0xF000) { /* Mirror of Bank 0 */
-            return mmu->wram[addr - 0xE000];
-        } else { /* Mirror of Bank N */
-            u8 bank = mmu->svbk & 0x07;
-            if (bank == 0) bank = 1;
-            u32 offset = (bank * 0x1000) + (addr - 0xF000);
-            return mmu->wram[offset];
-        }
+    /* External RAM while disabled, absent or replaced by the RTC */
+    if (addr >= 0xA000 && addr < 0xC000) {
+        return gb_cart_read_ram(mmu->cart, addr - 0xA000);
     }
     
     /* OAM */
@@ -136,6 +383,7 @@ u8 gb_mmu_read(gb_mmu_t *mmu, u16 addr) {
     /* I/O Registers */
     if (addr >= 0xFF00 && addr < 0xFF80) {
         if (addr == 0xFF00) {
+            gb_sched_stop(mmu->sched, GB_STOP_JOYPAD);
             u8 val = mmu->io[0x00] & 0xF0;
             if (!(val & 0x10)) { /* Direction buttons */
                 val |= (mmu->joypad >> 4) & 0x0F;
@@ -146,6 +394,15 @@ u8 gb_mmu_read(gb_mmu_t *mmu, u16 addr) {
             return val;
         }
 
+        if (addr == IO_DIV || addr == IO_TIMA) {
+            timer_sync(mmu, mmu->sched->now);
+            return mmu->io[addr - 0xFF00];
+        }
+
+        if (addr == IO_IF) {
+            return mmu->irq.flags;
+        }
+
         if (addr >= 0xFF10 && addr < 0xFF40) {
             return gb_apu_read(mmu->apu, addr);
         }
@@ -157,6 +414,7 @@ u8 gb_mmu_read(gb_mmu_t *mmu, u16 addr) {
         if (addr == IO_VBK) return mmu->ppu->vbk;
         if (addr == IO_SVBK) return mmu->svbk;
         if (addr == IO_KEY1) return mmu->key1 | (mmu->speed ? 0x80 : 0x00);
+        if (addr == IO_HDMA5) return mmu->hdma5;
         
         /* Palette Routes */
         if (addr == IO_BCPS) return mmu->ppu->bcps;
@@ -167,70 +425,149 @@ u8 gb_mmu_read(gb_mmu_t *mmu, u16 addr) {
         return mmu->io[addr - 0xFF00];
     }
     
-    /* High RAM */
-    if (addr >= 0xFF80 && addr < 0xFFFF) {
-        return mmu->hram[addr - 0xFF80];
-    }
-    
     /* Interrupt Enable */
     if (addr == 0xFFFF) {
-        return mmu->ie;
+        return mmu->irq.ie;
     }
     
     return 0xFF;
 }
 
-void gb_mmu_write(gb_mmu_t *mmu, u16 addr, u8 value) {
-    /* ROM Banks (may trigger MBC commands) */
-    if (addr < 0x8000) {
-        gb_cart_write(mmu->cart, addr, value);
-        return;
+/* Everything caching VRAM contents (decoded tiles, translated blocks)
+ * learns of a DMA transfer once, for the whole range; `offset` is relative
+ * to 0x8000 */
+static void vram_written(gb_mmu_t *mmu, u16 offset, u16 len) {
+    u16 bank = (mmu->ppu->vbk & 0x01) ? 0x2000 : 0;
+    u16 wrapped = offset + len > 0x2000 ? offset + len - 0x2000 : 0;
+    gb_tile_cache_invalidate(bank + offset, len - wrapped);
+    if (wrapped) {
+        gb_tile_cache_invalidate(bank, wrapped);
     }
-    
-    /* VRAM (Banked) */
-    if (addr >= 0x8000 && addr < 0xA000) {
-        u16 vram_offset = addr - 0x8000;
-        if (mmu->ppu->vbk & 0x01) {
-            vram_offset += 0x2000;
+
+    u8 first = 0x80 + (offset >> 8);
+    u8 last = wrapped ? 0x9F : 0x80 + ((offset + len - 1) >> 8);
+    if (mmu->oam_dma) {
+        bus_unlock(mmu);
+    }
+    gb_block_invalidate_range(mmu, first, last);
+    if (wrapped) {
+        gb_block_invalidate_range(mmu, 0x80, 0x80 + ((wrapped - 1) >> 8));
+    }
+    if (mmu->oam_dma) {
+        bus_lock(mmu);
+    }
+}
+
+/*
+ * Copy `blocks` 16-byte blocks from HDMA1/HDMA2 into the selected VRAM bank
+ * at HDMA3/HDMA4, advance both addresses and stall the CPU for the transfer.
+ * A block never crosses a page, so each one is a single memcpy from the
+ * source page; unmapped sources (disabled cartridge RAM, RTC) go byte by
+ * byte through the slow path.
+ */
+static void vram_dma(gb_mmu_t *mmu, u8 blocks, u64 from) {
+    u16 source = (mmu->hdma1 << 8) | (mmu->hdma2 & 0xF0);
+    u16 dest = ((mmu->hdma3 & 0x1F) << 8) | (mmu->hdma4 & 0xF0);
+    u16 start = dest;
+    u16 bank = (mmu->ppu->vbk & 0x01) ? 0x2000 : 0;
+    u8 *vram = mmu->ppu->vram + bank;
+    bool held = mmu->oam_dma;
+
+    for (u8 i = 0; i < blocks; i++) {
+        gb_ppu_log_write(mmu->ppu, bank + dest, 16);
+        /* An OAM DMA in progress keeps the CPU off the bus, not this
+         * transfer: its pages are in the tables bus_lock() set aside */
+        u8 page = source >> 8;
+        const u8 *src = held && page < 0xFE ? mmu->dma_read_page[page] : mmu->read_page[page];
+        if (src) {
+            memcpy(vram + dest, src + (source & 0xFF), 16);
+        } else {
+            mmu->oam_dma = false;
+            for (u8 j = 0; j < 16; j++) {
+                vram[dest + j] = gb_mmu_read_slow(mmu, source + j);
+            }
+            mmu->oam_dma = held;
+        }
+        source += 16;
+        dest = (dest + 16) & 0x1FF0;
+    }
+
+    mmu->hdma1 = source >> 8;
+    mmu->hdma2 = source & 0xF0;
+    mmu->hdma3 = dest >> 8;
+    mmu->hdma4 = dest & 0xF0;
+
+    vram_written(mmu, start, blocks * 16);
+    gb_sched_stall(mmu->sched, from, (u32)blocks * GB_VRAM_DMA_BLOCK_CYCLES << mmu->speed);
+}
+
+/*
+ * HDMA5: bit 7 set starts an H-Blank DMA of (bits 0-6) + 1 blocks, one per
+ * H-Blank (GB_EVENT_HDMA, scheduled by the PPU). Bit 7 clear runs the whole
+ * transfer now as a general purpose DMA, or stops a running H-Blank DMA,
+ * which then reads back with bit 7 set and the blocks it had left.
+ */
+static void hdma5_write(gb_mmu_t *mmu, u8 value) {
+    if (value & 0x80) {
+        mmu->hdma5 = value & 0x7F;
+        mmu->hdma_active = true;
+        /* Started inside H-Blank: the first block goes right away */
+        if (mmu->ppu->mode == PPU_MODE_HBLANK && (mmu->ppu->lcdc & LCDC_ENABLE)) {
+            gb_sched_schedule(mmu->sched, GB_EVENT_HDMA, mmu->sched->now);
         }
-        mmu->ppu->vram[vram_offset] = value;
         return;
     }
-    
-    /* External RAM */
-    if (addr >= 0xA000 && addr < 0xC000) {
-        gb_cart_write_ram(mmu->cart, addr - 0xA000, value);
+    if (mmu->hdma_active) {
+        mmu->hdma_active = false;
+        mmu->hdma5 |= 0x80;
+        gb_sched_cancel(mmu->sched, GB_EVENT_HDMA);
         return;
     }
-    
-    /* Work RAM (Bank 0) */
-    if (addr >= 0xC000 && addr < 0xD000) {
-        mmu->wram[addr - 0xC000] = value;
+    vram_dma(mmu, (value & 0x7F) + 1, mmu->sched->now);
+    mmu->hdma5 = 0xFF;
+}
+
+void gb_mmu_write_slow(gb_mmu_t *mmu, u16 addr, u8 value) {
+    if (mmu->oam_dma && addr < 0xFF00) {
         return;
     }
-    
-    /* Work RAM (Switchable Bank 1-7) */
-    if (addr >= 0xD000 && addr < 0xE000) {
-        u8 bank = mmu->svbk & 0x07;
-        if (bank == 0) bank = 1;
-        u32 offset = (bank * 0x1000) + (addr - 0xD000);
-        mmu->wram[offset] = value;
+
+    /* RAM page holding translated blocks (write-protected by block.c) */
+    if (gb_block_cache.code[addr >> 8] && (addr < 0xFF00 || (addr >= 0xFF80 && addr < 0xFFFF))) {
+        gb_block_invalidate(mmu, addr >> 8);
+        if (mmu->write_page[addr >> 8]) {
+            mmu->write_page[addr >> 8][addr & 0xFF] = value;
+            return;
+        }
+    }
+
+    /* High RAM */
+    if (addr >= 0xFF80 && addr < 0xFFFF) {
+        mmu->hram[addr - 0xFF80] = value;
         return;
     }
     
-    /* Echo RAM */
-    if (addr >= 0xE000 && addr < 0xFE00) {
-        if (addr < 0xF000) {
-            mmu->wram[addr - 0xE000] = value;
-        } else {
-            u8 bank = mmu->svbk & 0x07;
-            if (bank == 0) bank = 1;
-            u32 offset = (bank * 0x1000) + (addr - 0xF000);
-            mmu->wram[offset] = value;
+    /* ROM Banks (may trigger MBC commands) */
+    if (addr < 0x8000) {
+        if (gb_cart_write(mmu->cart, addr, value)) {
+            map_cart(mmu);
         }
         return;
     }
     
+    /* VRAM tile data (the tile maps have a page pointer unless rendering
+     * is deferred) */
+    if (addr >= 0x8000 && addr < 0xA000) {
+        gb_ppu_write_vram(mmu->ppu, addr - 0x8000, value);
+        return;
+    }
+
+    /* External RAM */
+    if (addr >= 0xA000 && addr < 0xC000) {
+        gb_cart_write_ram(mmu->cart, addr - 0xA000, value);
+        return;
+    }
+    
     /* OAM */
     if (addr >= 0xFE00 && addr < 0xFEA0) {
         gb_ppu_write_oam(mmu->ppu, addr - 0xFE00, value);
@@ -239,19 +576,41 @@ void gb_mmu_write(gb_mmu_t *mmu, u16 addr, u8 value) {
     
     /* I/O Registers */
     if (addr >= 0xFF00 && addr < 0xFF80) {
-        if (addr == IO_DIV) {
-            mmu->div_counter = 0;
-            mmu->io[0x04] = 0;
+        if (addr >= IO_DIV && addr <= IO_TAC) {
+            /* Settle the elapsed cycles under the old timer configuration first */
+            timer_sync(mmu, mmu->sched->now);
+            bool input = timer_input(mmu);
+            if (addr == IO_DIV) {
+                mmu->div_counter = 0;
+                mmu->io[0x04] = 0;
+            } else {
+                mmu->io[addr - 0xFF00] = value;
+            }
+            /* Resetting DIV or changing TAC can pull the TIMA input low,
+             * which counts as a falling edge like any other */
+            if (input && !timer_input(mmu)) {
+                timer_tick(mmu, 1);
+            }
+            if (addr != IO_TMA) {
+                timer_schedule(mmu);
+            }
+            return;
+        }
+        
+        if (addr == IO_IF) {
+            gb_irq_write_if(&mmu->irq, value);
             return;
         }
         
         if (addr == IO_SC) {
-            if (value == 0x81) {
-                printf("%c", mmu->io[IO_SB - 0xFF00]);
-                fflush(stdout);
-                mmu->io[IO_SC - 0xFF00] = 0x01; /* Reset transfer bit */
-                return;
+            mmu->io[IO_SC - 0xFF00] = value;
+            if ((value & 0x81) == 0x81) {
+                /* Internal clock: 8 bits at 8192 Hz */
+                serial_log(mmu->io[IO_SB - 0xFF00]);
+                gb_sched_stop(mmu->sched, GB_STOP_SERIAL);
+                gb_sched_schedule(mmu->sched, GB_EVENT_SERIAL, mmu->sched->now + 4096);
             }
+            return;
         }
         
         /* Route APU registers (0xFF10-0xFF3F) */
@@ -262,13 +621,10 @@ void gb_mmu_write(gb_mmu_t *mmu, u16 addr, u8 value) {
 
         /* Route PPU registers (0xFF40-0xFF4B) */
         if (addr >= 0xFF40 && addr <= 0xFF4B) {
-            if (addr == 0xFF46) { /* DMA */
-                u16 source = value << 8;
-                for (int i = 0; i < 0xA0; i++) {
-                    gb_mmu_write(mmu, 0xFE00 + i, gb_mmu_read(mmu, source + i));
-                }
+            if (addr == IO_DMA) {
+                oam_dma_start(mmu, value);
             } else {
-                gb_ppu_write_reg(mmu->ppu, addr, value);
+                gb_ppu_write_reg(mmu->ppu, mmu, addr, value);
             }
             return;
         }
@@ -277,11 +633,13 @@ void gb_mmu_write(gb_mmu_t *mmu, u16 addr, u8 value) {
         if (addr == IO_VBK) {
             mmu->ppu->vbk = value & 0x01;
             /* Bit 0 determines bank (0 or 1) */
+            remap_region(mmu, map_vram);
             return;
         }
         if (addr == IO_SVBK) {
             mmu->svbk = value & 0x07;
             /* Bits 0-2 determine bank (0-7, 0 -> 1) */
+            remap_region(mmu, map_wram);
             return;
         }
         if (addr == IO_KEY1) {
@@ -296,29 +654,7 @@ void gb_mmu_write(gb_mmu_t *mmu, u16 addr, u8 value) {
             if (addr == IO_HDMA3) mmu->hdma3 = value;
             if (addr == IO_HDMA4) mmu->hdma4 = value;
             if (addr == IO_HDMA5) {
-                /* Start HDMA or GDMA */
-                /* Mode 0: GDMA (General Purpose DMA) - Instant transfer */
-                /* Mode 1: HDMA (H-Blank DMA) - 16 bytes per H-Blank */
-                
-                u16 source = (mmu->hdma1 << 8) | (mmu->hdma2 & 0xF0);
-                u16 dest = ((mmu->hdma3 & 0x1F) << 8) | (mmu->hdma4 & 0xF0);
-                dest |= 0x8000; /* Always VRAM */
-                
-                u8 length = (value & 0x7F) + 1; /* Length in 16-byte units */
-                
-                if (value & 0x80) {
-                    /* HDMA (H-Blank) */
-                    mmu->hdma5 = value & 0x7F;
-                    mmu->hdma_active = true;
-                } else {
-                    /* GDMA (General Purpose) */
-                    for (int i = 0; i < length * 16; i++) {
-                        u8 byte = gb_mmu_read(mmu, source + i);
-                        gb_mmu_write(mmu, dest + i, byte);
-                    }
-                    mmu->hdma5 = 0xFF; /* Transfer completed */
-                    mmu->hdma_active = false;
-                }
+                hdma5_write(mmu, value);
             }
             return;
         }
@@ -326,7 +662,7 @@ void gb_mmu_write(gb_mmu_t *mmu, u16 addr, u8 value) {
         /* Palette Data handling - Route to PPU helper would be cleaner, but implementing here for now */
         /* Actually lets route to PPU writes for these */
         if (addr == IO_BCPS || addr == IO_BCPD || addr == IO_OCPS || addr == IO_OCPD) {
-            gb_ppu_write_reg(mmu->ppu, addr, value);
+            gb_ppu_write_reg(mmu->ppu, mmu, addr, value);
             return;
         }
 
@@ -334,59 +670,21 @@ void gb_mmu_write(gb_mmu_t *mmu, u16 addr, u8 value) {
         return;
     }
     
-    /* High RAM */
-    if (addr >= 0xFF80 && addr < 0xFFFF) {
-        mmu->hram[addr - 0xFF80] = value;
-        return;
-    }
-    
     /* Interrupt Enable */
     if (addr == 0xFFFF) {
-        mmu->ie = value;
+        gb_irq_write_ie(&mmu->irq, value);
         return;
     }
 }
 
-u16 gb_mmu_read16(gb_mmu_t *mmu, u16 addr) {
-    u8 lo = gb_mmu_read(mmu, addr);
-    u8 hi = gb_mmu_read(mmu, addr + 1);
-    return (hi << 8) | lo;
-}
+void gb_mmu_execute_hdma(gb_mmu_t *mmu, u64 when) {
+    if (!mmu->hdma_active) return;
 
-void gb_mmu_write16(gb_mmu_t *mmu, u16 addr, u16 value) {
-    gb_mmu_write(mmu, addr, value & 0xFF);
-    gb_mmu_write(mmu, addr + 1, value >> 8);
-}
+    vram_dma(mmu, 1, when);
 
-void gb_mmu_execute_hdma(gb_mmu_t *mmu) {
-    if (!mmu->hdma_active) return;
-    
-    /* Perform 16-byte transfer */
-    u16 source = (mmu->hdma1 << 8) | (mmu->hdma2 & 0xF0);
-    u16 dest = ((mmu->hdma3 & 0x1F) << 8) | (mmu->hdma4 & 0xF0);
-    dest |= 0x8000; /* Always VRAM */
-    
-    for (int i = 0; i < 16; i++) {
-        u8 byte = gb_mmu_read(mmu, source + i);
-        gb_mmu_write(mmu, dest + i, byte);
-    }
-    
-    /* Update source/dest registers */
-    source += 16;
-    dest += 16;
-    
-    mmu->hdma1 = (source >> 8) & 0xFF;
-    mmu->hdma2 = source & 0xF0;
-    mmu->hdma3 = (dest >> 8) & 0x1F;
-    mmu->hdma4 = dest & 0xF0;
-    
-    /* Decrement length (blocks remaining) */
+    /* HDMA5 counts the remaining blocks minus one down to 0xFF (done) */
     mmu->hdma5--;
-    
     if (mmu->hdma5 == 0xFF) {
         mmu->hdma_active = false;
-        mmu->hdma5 = 0xFF; /* Completed */
-    } else {
-        mmu->hdma5 &= 0x7F; /* Keep bit 7 clear to indicate ongoing? Or just bits 0-6 */
     }
 }
@@ -22,10 +22,20 @@
 #define GB_MMU_H
 
 #include "../common/common.h"
+#include "interrupt.h"
+#include <string.h>
 
 struct gb_ppu_t;
 struct gb_apu_t;
 struct gb_cartridge_t;
+struct gb_scheduler_t;
+
+/* OAM DMA: one M-cycle of setup, then 160 bytes at one per M-cycle */
+#define GB_OAM_DMA_CYCLES (4 + 160 * 4)
+
+/* VRAM DMA: the CPU stalls this long per 16-byte block (doubled in double
+ * speed, where the transfer keeps the PPU's pace) */
+#define GB_VRAM_DMA_BLOCK_CYCLES 32
 
 typedef struct gb_mmu_t {
     /* Work RAM */
@@ -35,31 +45,57 @@ typedef struct gb_mmu_t {
     /* I/O Registers array */
     u8 io[0x80];
     
-    /* Component references */
-    struct gb_ppu_t *ppu;
-    struct gb_cartridge_t *cart;
+    /* Timer state (DIV/TIMA are brought up to date lazily, see timer_sync) */
+    u16 div_counter;      /* Internal 16-bit counter for DIV, TIMA clocks off it */
+    u64 timer_sync;       /* Scheduler time the counters were last synced to */
     
-    /* Joypad state */
-    u8 joypad;
+    /* Interrupt controller (IE at 0xFFFF, IF at 0xFF0F) */
+    gb_irq_t irq;
+
+    /* OAM DMA in progress (GB_EVENT_OAM_DMA ends it): the CPU only reaches
+     * I/O and HRAM, see bus_lock() */
+    bool oam_dma;
 
-    /* Timer state */
-    u16 div_counter;      /* Internal 16-bit counter for DIV */
-    u32 tima_counter;     /* Internal counter for TIMA */
-    
     /* GBC Control */
     u8 svbk;      /* WRAM Bank (0xFF70) */
     u8 key1;      /* Speed Switch (0xFF4D) */
     bool speed;   /* Current speed: 0=Normal, 1=Double */
-    
-    /* GBC HDMA */
+
+    /* GBC HDMA (hdma5 holds the value HDMA5 reads back) */
     u8 hdma1, hdma2, hdma3, hdma4, hdma5;
     bool hdma_active;
+    
+    /* Component references */
+    struct gb_ppu_t *ppu;
+    struct gb_cartridge_t *cart;
+    
+    /* Joypad state */
+    u8 joypad;
 
     /* APU reference */
     struct gb_apu_t *apu;
 
-    /* Interrupt Enable register (0xFFFF) */
-    u8 ie;
+    /* Event scheduler (owns the master clock) */
+    struct gb_scheduler_t *sched;
+
+    /* Page tables: host pointer to each 256-byte page of the address space,
+     * rebuilt by gb_mmu_remap() and on bank switches. NULL pages (MBC
+     * registers, disabled or RTC cartridge RAM, OAM, I/O and HRAM) go
+     * through gb_mmu_read_slow()/gb_mmu_write_slow(), as do writes to RAM
+     * pages the block cache has write-protected (block.h). */
+    const u8 *read_page[0x100];
+    u8 *write_page[0x100];
+
+    /* Opcode fetch window: guest [fetch_start, fetch_start + fetch_len) is
+     * contiguous host memory at fetch_ptr. Opened by gb_mmu_fetch_miss()
+     * around the page PC is in and closed whenever the page tables change. */
+    const u8 *fetch_ptr;
+    u16 fetch_start;
+    u16 fetch_len;
+
+    /* Page-table entries below OAM, set aside while OAM DMA holds the bus */
+    const u8 *dma_read_page[0xFE];
+    u8 *dma_write_page[0xFE];
 } gb_mmu_t;
 
 /* I/O Register addresses */
@@ -99,26 +135,118 @@ typedef struct gb_mmu_t {
 #define IO_IE    0xFFFF  /* Interrupt enable */
 
 /* Function prototypes */
-void gb_mmu_init(gb_mmu_t *mmu, struct gb_ppu_t *ppu, struct gb_apu_t *apu, struct gb_cartridge_t *cart);
+void gb_mmu_init(gb_mmu_t *mmu, struct gb_ppu_t *ppu, struct gb_apu_t *apu, struct gb_cartridge_t *cart,
+                 struct gb_scheduler_t *sched);
 void gb_mmu_reset(gb_mmu_t *mmu);
 
 /**
- * Step timers by given number of cycles
+ * GB_EVENT_TIMER handler: TIMA overflows at `when`
+ * Reloads TIMA from TMA, requests the timer interrupt and schedules the next overflow
+ */
+void gb_mmu_timer_event(gb_mmu_t *mmu, u64 when);
+
+/**
+ * GB_EVENT_OAM_DMA handler: copy the 160 bytes into OAM and release the bus
+ */
+void gb_mmu_oam_dma_event(gb_mmu_t *mmu);
+
+/**
+ * GB_EVENT_SERIAL handler: the 8-bit transfer started by writing SC has completed
+ */
+void gb_mmu_serial_event(gb_mmu_t *mmu);
+
+/**
+ * Rebuild every page-table entry from the current banking state
+ * (after reset or loading a save state)
+ */
+void gb_mmu_remap(gb_mmu_t *mmu);
+
+/**
+ * ROM bank the code at `pc` is currently mapped from (0 outside ROM),
+ * for traces and profiles
  */
-void gb_mmu_step_timers(gb_mmu_t *mmu, u32 cycles);
+u16 gb_mmu_code_bank(const gb_mmu_t *mmu, u16 pc);
+
+/**
+ * Handlers for unmapped pages: MBC, cartridge RAM/RTC, OAM, I/O, HRAM, IE
+ */
+u8 gb_mmu_read_slow(gb_mmu_t *mmu, u16 addr);
+void gb_mmu_write_slow(gb_mmu_t *mmu, u16 addr, u8 value);
 
 /**
  * Read a byte from memory
  */
-u8 gb_mmu_read(gb_mmu_t *mmu, u16 addr);
-void gb_mmu_write(gb_mmu_t *mmu, u16 addr, u8 value);
+static inline u8 gb_mmu_read(gb_mmu_t *mmu, u16 addr) {
+    const u8 *page = mmu->read_page[addr >> 8];
+    if (page) {
+        return page[addr & 0xFF];
+    }
+    return gb_mmu_read_slow(mmu, addr);
+}
+
+static inline void gb_mmu_write(gb_mmu_t *mmu, u16 addr, u8 value) {
+    u8 *page = mmu->write_page[addr >> 8];
+    if (page) {
+        page[addr & 0xFF] = value;
+        return;
+    }
+    gb_mmu_write_slow(mmu, addr, value);
+}
+
+/**
+ * Fetch a byte at `addr` outside the current fetch window, re-opening the
+ * window around it when its page is mapped
+ */
+u8 gb_mmu_fetch_miss(gb_mmu_t *mmu, u16 addr);
+
+#ifdef GB_BENCH
+/* Fetch window statistics (native benchmark builds only) */
+extern u64 gb_mmu_fetch_misses;      /* Fetches that fell outside the window */
+extern bool gb_mmu_fetch_window;     /* false: never open a window */
+#endif
+
+/**
+ * Instruction stream reads (opcodes and immediates) through the fetch window
+ */
+static inline u8 gb_mmu_fetch8(gb_mmu_t *mmu, u16 addr) {
+    u16 offset = addr - mmu->fetch_start;
+    if (offset < mmu->fetch_len) {
+        return mmu->fetch_ptr[offset];
+    }
+    return gb_mmu_fetch_miss(mmu, addr);
+}
+
+/* Little-endian immediate; a single unaligned load when both bytes are in the window */
+static inline u16 gb_mmu_fetch16(gb_mmu_t *mmu, u16 addr) {
+    u16 offset = addr - mmu->fetch_start;
+    if ((u32)offset + 1 < mmu->fetch_len) {
+        u16 value;
+        memcpy(&value, mmu->fetch_ptr + offset, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        value = (u16)((value << 8) | (value >> 8));
+#endif
+        return value;
+    }
+    u8 lo = gb_mmu_fetch8(mmu, addr);
+    u8 hi = gb_mmu_fetch8(mmu, addr + 1);
+    return (hi << 8) | lo;
+}
+
+static inline u16 gb_mmu_read16(gb_mmu_t *mmu, u16 addr) {
+    u8 lo = gb_mmu_read(mmu, addr);
+    u8 hi = gb_mmu_read(mmu, addr + 1);
+    return (hi << 8) | lo;
+}
 
-u16 gb_mmu_read16(gb_mmu_t *mmu, u16 addr);
-void gb_mmu_write16(gb_mmu_t *mmu, u16 addr, u16 value);
+static inline void gb_mmu_write16(gb_mmu_t *mmu, u16 addr, u16 value) {
+    gb_mmu_write(mmu, addr, value & 0xFF);
+    gb_mmu_write(mmu, addr + 1, value >> 8);
+}
 
 /**
- * Execute one step (16 bytes) of HDMA transfer
+ * GB_EVENT_HDMA handler: transfer one 16-byte H-Blank DMA block, stalling
+ * the CPU from `when`
  */
-void gb_mmu_execute_hdma(gb_mmu_t *mmu);
+void gb_mmu_execute_hdma(gb_mmu_t *mmu, u64 when);
 
 #endif /* GB_MMU_H */
@@ -13,9 +13,58 @@
 
 #include "ppu.h"
 #include "mmu.h"
+#include "scheduler.h"
+#include "tile_cache.h"
+#include "compose.h"
 #include <string.h>
 #include <stdio.h>
 
+/* Mode lengths in PPU cycles (one scanline = 456) */
+#define PPU_OAM_SCAN_CYCLES 80
+#define PPU_DRAWING_CYCLES  172
+#define PPU_HBLANK_CYCLES   204
+#define PPU_LINE_CYCLES     456
+
+/* What a visible line is drawn from besides VRAM and OAM */
+typedef struct {
+    u8 ly, lcdc, scy, scx, wy, wx;
+    u8 bgp, obp0, obp1;
+    u8 sprite_count;
+    u8 sprites[GB_LINE_SPRITES];
+} gb_ppu_line_t;
+
+/*
+ * Deferred rendering (gb_ppu_deferred): the end of mode 3 logs the line's
+ * state instead of drawing it, and gb_ppu_flush_lines() draws the logged
+ * lines in one pass, at VBlank or whenever the log has to be emptied.
+ *
+ * VRAM and OAM writes made while lines are logged are journaled with the
+ * value they replace and the number of lines logged before them. The flush
+ * walks the journal backwards to put memory back as it was when the first
+ * logged line ended, swapping each entry's old value for the one it undoes
+ * (the value written), then forwards again line by line, so every line sees
+ * memory as it was at the end of its mode 3. Journal addresses are VRAM
+ * offsets (bank 1 from 0x2000), OAM from GB_PPU_LOG_OAM (ppu.h).
+ */
+#define GB_PPU_LOG_WRITES 4096
+
+typedef struct {
+    u16 addr;
+    u8 line;   /* Lines logged before the write */
+    u8 value;  /* Value replaced; the value written once the flush undid it */
+} gb_ppu_log_write_t;
+
+static struct {
+    u32 lines;
+    u32 writes;
+    gb_ppu_line_t line[GB_SCREEN_HEIGHT];
+    gb_ppu_log_write_t write[GB_PPU_LOG_WRITES];
+} line_log;
+
+bool gb_ppu_deferred = false;
+
+static void capture_line(const gb_ppu_t *ppu, gb_ppu_line_t *line);
+
 /* Default monochrome palette (darkest to lightest) */
 static const u32 default_palette[4] = {
     0xFF8BBE53,  /* Color 0: Lightest green */
@@ -24,6 +73,70 @@ static const u32 default_palette[4] = {
     0xFF0F380F   /* Color 3: Darkest green */
 };
 
+/* The four colours of a DMG palette register, at `base` in a compose.h table */
+static void dmg_palette_update(u32 *lut, u8 base, u8 value) {
+    for (u8 c = 0; c < 4; c++) {
+        lut[base + c] = default_palette[(value >> (c * 2)) & 3];
+    }
+}
+
+/* RGB555 (little-endian in palette memory) as an RGBA pixel. The corrected
+ * curve mixes the channels the way the CGB LCD does, which tames the
+ * oversaturated colours games were designed around. */
+static u32 cgb_color(const u8 *entry, bool color_correction) {
+    u16 word = entry[0] | (entry[1] << 8);
+    u32 r = word & 0x1F, g = (word >> 5) & 0x1F, b = (word >> 10) & 0x1F;
+    u32 r8, g8, b8;
+    if (color_correction) {
+        r8 = (r * 13 + g * 2 + b) >> 1;
+        g8 = (g * 3 + b) << 1;
+        b8 = (r * 3 + g * 2 + b * 11) >> 1;
+    } else {
+        r8 = (r << 3) | (r >> 2);
+        g8 = (g << 3) | (g >> 2);
+        b8 = (b << 3) | (b >> 2);
+    }
+    return 0xFF000000u | (b8 << 16) | (g8 << 8) | r8;
+}
+
+/* The colour that palette memory byte `index` belongs to */
+static void cgb_palette_update(const gb_ppu_t *ppu, u32 *lut, const u8 *pal, u8 index) {
+    u8 color = index >> 1;
+    lut[color] = cgb_color(pal + color * 2, ppu->color_correction);
+}
+
+void gb_ppu_refresh_palettes(gb_ppu_t *ppu) {
+    memset(ppu->dmg_lut, 0, sizeof(ppu->dmg_lut));
+    dmg_palette_update(ppu->dmg_lut, 0, ppu->bgp);
+    dmg_palette_update(ppu->dmg_lut, GB_COMPOSE_OBP0, ppu->obp0);
+    dmg_palette_update(ppu->dmg_lut, GB_COMPOSE_OBP1, ppu->obp1);
+    for (u8 i = 0; i < 0x40; i += 2) {
+        cgb_palette_update(ppu, ppu->cgb_bg_lut, ppu->cgb_bg_pal, i);
+        cgb_palette_update(ppu, ppu->cgb_obj_lut, ppu->cgb_obj_pal, i);
+    }
+}
+
+void gb_ppu_set_color_correction(gb_ppu_t *ppu, bool enabled) {
+    ppu->color_correction = enabled;
+    gb_ppu_refresh_palettes(ppu);
+}
+
+static void oam_decode(gb_ppu_t *ppu, u8 index) {
+    gb_oam_cache_t *cache = &ppu->oam_cache;
+    const u8 *entry = ppu->oam + index * 4;
+    cache->y[index] = entry[0];
+    cache->x[index] = entry[1];
+    cache->tile[index] = entry[2];
+    cache->attr[index] = entry[3];
+    cache->palette[index] = (entry[3] & (1 << 4)) ? GB_COMPOSE_OBP1 : GB_COMPOSE_OBP0;
+}
+
+void gb_ppu_refresh_oam(gb_ppu_t *ppu) {
+    for (u8 i = 0; i < GB_OAM_SPRITES; i++) {
+        oam_decode(ppu, i);
+    }
+}
+
 void gb_ppu_init(gb_ppu_t *ppu) {
     memset(ppu, 0, sizeof(gb_ppu_t));
     
@@ -35,7 +148,11 @@ void gb_ppu_init(gb_ppu_t *ppu) {
     ppu->obp1 = 0xFF;
     
     ppu->mode = PPU_MODE_OAM_SCAN;
-    ppu->mode_cycles = 0;
+    gb_tile_cache_flush();
+    gb_compose_init();
+    gb_ppu_refresh_palettes(ppu);
+    gb_ppu_refresh_oam(ppu);
+    gb_ppu_drop_lines();
     
     /* Clear framebuffer to black */
     for (u32 i = 0; i < sizeof(ppu->framebuffer); i += 4) {
@@ -47,12 +164,10 @@ void gb_ppu_init(gb_ppu_t *ppu) {
 }
 
 void gb_ppu_reset(gb_ppu_t *ppu) {
+    /* Colour correction is the player's choice, not machine state */
+    bool color_correction = ppu->color_correction;
     gb_ppu_init(ppu);
-}
-
-static void request_interrupt(gb_mmu_t *mmu, u8 interrupt) {
-    u8 if_reg = gb_mmu_read(mmu, 0xFF0F);
-    gb_mmu_write(mmu, 0xFF0F, if_reg | interrupt);
+    gb_ppu_set_color_correction(ppu, color_correction);
 }
 
 static void update_stat(gb_ppu_t *ppu, gb_mmu_t *mmu) {
@@ -66,92 +181,122 @@ static void update_stat(gb_ppu_t *ppu, gb_mmu_t *mmu) {
         ppu->stat |= STAT_LYC_EQUAL;
         /* Trigger LYC interrupt if enabled and bit was just set */
         if ((ppu->stat & STAT_INTERRUPT_LYC) && !(old_stat & STAT_LYC_EQUAL)) {
-            request_interrupt(mmu, 0x02); // LCD STAT interrupt
+            gb_irq_raise(&mmu->irq, GB_IRQ_STAT);
         }
     } else {
         ppu->stat &= ~STAT_LYC_EQUAL;
     }
 }
 
-bool gb_ppu_step(gb_ppu_t *ppu, void *mmu_ptr, u32 cycles) {
+/* PPU cycles are converted to scheduler (CPU) cycles: in double speed the
+ * CPU clock runs twice as fast as the PPU */
+static void schedule_next(gb_mmu_t *mmu, u64 base, u32 ppu_cycles) {
+    gb_sched_schedule(mmu->sched, GB_EVENT_PPU, base + ((u64)ppu_cycles << mmu->speed));
+}
+
+/* OAM scan: the first ten sprites in OAM order that cover LY, kept sorted
+ * into DMG priority order (an insertion sort that leaves equal X in OAM
+ * order) */
+static void select_line_sprites(gb_ppu_t *ppu) {
+    const gb_oam_cache_t *oam = &ppu->oam_cache;
+    u8 height = (ppu->lcdc & LCDC_OBJ_SIZE) ? 16 : 8;
+    u8 line = ppu->ly + 16;
+    u8 count = 0;
+
+    for (u8 i = 0; i < GB_OAM_SPRITES && count < GB_LINE_SPRITES; i++) {
+        if ((u8)(line - oam->y[i]) >= height) continue;
+        u8 pos = count++;
+        while (pos > 0 && oam->x[ppu->line_sprites[pos - 1]] > oam->x[i]) {
+            ppu->line_sprites[pos] = ppu->line_sprites[pos - 1];
+            pos--;
+        }
+        ppu->line_sprites[pos] = i;
+    }
+    ppu->line_sprite_count = count;
+}
+
+void gb_ppu_start(gb_ppu_t *ppu, void *mmu_ptr) {
     gb_mmu_t *mmu = (gb_mmu_t *)mmu_ptr;
     
-    if (!(ppu->lcdc & LCDC_ENABLE)) {
-        ppu->ly = 0;
-        ppu->mode_cycles = 0;
-        ppu->mode = PPU_MODE_HBLANK;
-        return false;
+    if (ppu->lcdc & LCDC_ENABLE) {
+        schedule_next(mmu, mmu->sched->now, ppu->mode == PPU_MODE_OAM_SCAN ? PPU_OAM_SCAN_CYCLES : PPU_HBLANK_CYCLES);
     }
+}
+
+bool gb_ppu_event(gb_ppu_t *ppu, void *mmu_ptr, u64 when) {
+    gb_mmu_t *mmu = (gb_mmu_t *)mmu_ptr;
     
-    ppu->mode_cycles += cycles;
     bool frame_complete = false;
     u8 old_mode = ppu->mode;
+    u32 next = 0;
     
     switch (ppu->mode) {
         case PPU_MODE_OAM_SCAN:
-            if (ppu->mode_cycles >= 80) {
-                ppu->mode = PPU_MODE_DRAWING;
-                ppu->mode_cycles -= 80;
-            }
+            select_line_sprites(ppu);
+            ppu->mode = PPU_MODE_DRAWING;
+            next = PPU_DRAWING_CYCLES;
             break;
             
         case PPU_MODE_DRAWING:
-            if (ppu->mode_cycles >= 172) {
-                ppu->mode = PPU_MODE_HBLANK;
-                ppu->mode_cycles -= 172;
+            ppu->mode = PPU_MODE_HBLANK;
+            next = PPU_HBLANK_CYCLES;
+            if (!gb_ppu_deferred) {
                 gb_ppu_render_scanline(ppu);
-                
-                /* Trigger HDMA (H-Blank DMA) */
-                gb_mmu_execute_hdma(mmu);
-                
-                /* Trigger H-Blank STAT interrupt if enabled */
-                if (ppu->stat & STAT_INTERRUPT_HBL) {
-                    request_interrupt(mmu, 0x02);
-                }
+            } else if ((ppu->lcdc & LCDC_ENABLE) && ppu->ly < GB_SCREEN_HEIGHT) {
+                capture_line(ppu, &line_log.line[line_log.lines++]);
+            }
+            
+            /* Trigger HDMA (H-Blank DMA) */
+            if (mmu->hdma_active) {
+                gb_sched_schedule(mmu->sched, GB_EVENT_HDMA, when);
+            }
+            
+            /* Trigger H-Blank STAT interrupt if enabled */
+            if (ppu->stat & STAT_INTERRUPT_HBL) {
+                gb_irq_raise(&mmu->irq, GB_IRQ_STAT);
             }
             break;
             
         case PPU_MODE_HBLANK:
-            if (ppu->mode_cycles >= 204) {
-                ppu->mode_cycles -= 204;
-                ppu->ly++;
-                
-                update_stat(ppu, mmu);
+            ppu->ly++;
+            
+            update_stat(ppu, mmu);
+            
+            if (ppu->ly >= 144) {
+                gb_ppu_flush_lines(ppu);
+                ppu->mode = PPU_MODE_VBLANK;
+                next = PPU_LINE_CYCLES;
+                gb_irq_raise(&mmu->irq, GB_IRQ_VBLANK);
                 
-                if (ppu->ly >= 144) {
-                    ppu->mode = PPU_MODE_VBLANK;
-                    request_interrupt(mmu, 0x01); // V-Blank interrupt
-                    
-                    /* Trigger V-Blank STAT interrupt if enabled */
-                    if (ppu->stat & STAT_INTERRUPT_VBL) {
-                        request_interrupt(mmu, 0x02);
-                    }
-                    frame_complete = true;
-                } else {
-                    ppu->mode = PPU_MODE_OAM_SCAN;
-                    /* Trigger OAM STAT interrupt if enabled */
-                    if (ppu->stat & STAT_INTERRUPT_OAM) {
-                        request_interrupt(mmu, 0x02);
-                    }
+                /* Trigger V-Blank STAT interrupt if enabled */
+                if (ppu->stat & STAT_INTERRUPT_VBL) {
+                    gb_irq_raise(&mmu->irq, GB_IRQ_STAT);
+                }
+                frame_complete = true;
+            } else {
+                ppu->mode = PPU_MODE_OAM_SCAN;
+                next = PPU_OAM_SCAN_CYCLES;
+                /* Trigger OAM STAT interrupt if enabled */
+                if (ppu->stat & STAT_INTERRUPT_OAM) {
+                    gb_irq_raise(&mmu->irq, GB_IRQ_STAT);
                 }
             }
             break;
             
         case PPU_MODE_VBLANK:
-            if (ppu->mode_cycles >= 456) {
-                ppu->mode_cycles -= 456;
-                ppu->ly++;
-                
-                if (ppu->ly >= 154) {
-                    ppu->ly = 0;
-                    ppu->mode = PPU_MODE_OAM_SCAN;
-                    /* Trigger OAM STAT interrupt if enabled */
-                    if (ppu->stat & STAT_INTERRUPT_OAM) {
-                        request_interrupt(mmu, 0x02);
-                    }
+            ppu->ly++;
+            next = PPU_LINE_CYCLES;
+            
+            if (ppu->ly >= 154) {
+                ppu->ly = 0;
+                ppu->mode = PPU_MODE_OAM_SCAN;
+                next = PPU_OAM_SCAN_CYCLES;
+                /* Trigger OAM STAT interrupt if enabled */
+                if (ppu->stat & STAT_INTERRUPT_OAM) {
+                    gb_irq_raise(&mmu->irq, GB_IRQ_STAT);
                 }
-                update_stat(ppu, mmu);
             }
+            update_stat(ppu, mmu);
             break;
     }
     
@@ -159,304 +304,252 @@ bool gb_ppu_step(gb_ppu_t *ppu, void *mmu_ptr, u32 cycles) {
         update_stat(ppu, mmu);
     }
     
+    schedule_next(mmu, when, next);
     return frame_complete;
 }
 
-void gb_ppu_render_scanline(gb_ppu_t *ppu) {
-    if (!(ppu->lcdc & LCDC_ENABLE)) return;
-
-    u8 scanline_row[GB_SCREEN_WIDTH]; /* Store color indices for priority handling */
-    memset(scanline_row, 0, sizeof(scanline_row));
+static const u8 nibble_reverse[16] = {
+    0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF
+};
 
-    /* 1. Render Background */
-    if (ppu->lcdc & LCDC_BG_ENABLE) {
-        u16 map_base = (ppu->lcdc & LCDC_BG_TILEMAP) ? 0x1C00 : 0x1800;
-        u16 tile_base = (ppu->lcdc & LCDC_BG_WIN_TILES) ? 0x0000 : 0x1000;
-        u8 ty = (ppu->ly + ppu->scy) / 8;
-        u8 py = (ppu->ly + ppu->scy) % 8;
-
-        for (u32 x = 0; x < GB_SCREEN_WIDTH; x++) {
-            u8 tx = (x + ppu->scx) / 8;
-            u8 px = (x + ppu->scx) % 8;
-            u16 map_offset = map_base + (ty % 32) * 32 + (tx % 32);
-            
-            /* Fetch Tile Index */
-            u8 tile_index = ppu->vram[map_offset];
-            
-            /* Fetch Attributes (VRAM Bank 1, same offset) */
-            u8 attr = ppu->vram[map_offset + 0x2000];
-            
-            /* Decode Attributes */
-            u8 cgb_pal_idx = attr & 0x07;
-            u8 cgb_vram_bank = (attr & (1 << 3)) ? 1 : 0;
-            bool x_flip = attr & (1 << 5);
-            bool y_flip = attr & (1 << 6);
-            /* Priority bit 7: 1 = BG over OBJ (if OBJ has priority 0?) - actually 
-               1 = BG Display over OBJ. 0 = OBJ over BG? 
-               Wait, standard behavior:
-               Bit 7=0: OBJ is above BG (unless OBJ priority bit set?)
-               Bit 7=1: BG is above OBJ (always?)
-               We store this in scanline_row for Sprite loop to check. 
-               Scanline row needs to store color_idx AND priority info?
-               Or just store color_idx (0=transparent) and maybe a high bit for priority?
-            */
-            bool bg_priority = attr & (1 << 7);
-            
-            /* Handle Flips */
-            if (y_flip) {
-                /* For BG, y flip means we read the row from bottom up?
-                   No, actually it flips the tile vertically. 
-                   So py should be inverted. 
-                   But py is derived from scanline SCY. 
-                   The flip applies to the 8x8 tile itself. */
-                 /* Re-calculate effective py for tile data fetch */
-                 /* Wait, 'py' here is line within the tile row. */
-                 /* If y_flip, we need line 7-py instead. */
-                 /* BUT, we need to affect the tile_addr calculation only for this column's tile fetch. */
-                 /* Actually, since we loop X, for a given scanline, the tile row TY is constant. 
-                    But if some tiles have Y-flip and others don't...
-                    Wait, if I am on scanline Y, and the tile is flipped, I should draw row (7-py) of the tile. 
-                */
-            }
-            int effective_py = y_flip ? (7 - py) : py;
+/* Tile number in the data area for a map entry: LCDC bit 4 selects
+ * unsigned numbering from 0x8000 or signed from 0x9000 */
+static inline u16 bg_tile(u8 lcdc, u8 index) {
+    return (lcdc & LCDC_BG_WIN_TILES) ? index : (u16)(256 + (int8_t)index);
+}
 
-            u16 tile_addr;
-            if (ppu->lcdc & LCDC_BG_WIN_TILES) {
-                tile_addr = tile_base + tile_index * 16 + effective_py * 2;
-            } else {
-                tile_addr = tile_base + (int8_t)tile_index * 16 + effective_py * 2;
-            }
-            
-            /* Add VRAM Bank offset for tile data */
-            if (cgb_vram_bank == 1) {
-                tile_addr += 0x2000;
-            }
+/* Row `py` of the BG/window tile at a map entry as 8 colour indices, with
+ * the CGB BG-over-OBJ attribute in bit 7. The attribute byte (VRAM bank 1)
+ * picks the tile's bank and flips. */
+static inline void fetch_tile_row(const gb_ppu_t *ppu, u8 lcdc, u16 map_offset, u8 py, u8 *out) {
+    u8 index = ppu->vram[map_offset];
+    u8 attr = ppu->vram[map_offset + 0x2000];
+    u8 row = (attr & (1 << 6)) ? 7 - py : py;
+    const u8 *src = gb_tile_cache_row(ppu->vram, (attr >> 3) & 1, bg_tile(lcdc, index), row, attr & (1 << 5));
+    u8 priority = attr & (1 << 7);
+    for (u8 i = 0; i < 8; i++) {
+        out[i] = src[i] | priority;
+    }
+}
 
-            u8 b1 = ppu->vram[tile_addr];
-            u8 b2 = ppu->vram[tile_addr + 1];
-            
-            u8 bit = x_flip ? px : (7 - px);
-            u8 color_idx = ((b1 >> bit) & 1) | (((b2 >> bit) & 1) << 1);
-            
-            /* Store for Sprite Priority Check */
-            /* We can store color_idx, but also maybe the BG priority bit?
-               Let's just store color_idx for now, and maybe high bit.
-               scanline_row is u8.
-               Bit 0-1: Color Index.
-               Bit 7: BG Priority (1=BG always Top).
-            */
-            scanline_row[x] = color_idx | (bg_priority ? 0x80 : 0x00);
-            
-            /* Render Pixel - Placeholder DMG behavior + TODO CGB */
-             u8 shade = (ppu->bgp >> (color_idx * 2)) & 3;
-             u32 color = default_palette[shade];
-             u32 fb_idx = (ppu->ly * GB_SCREEN_WIDTH + x) * 4;
-             
-             if (fb_idx + 3 < GB_FRAMEBUFFER_SIZE) {
-                 ppu->framebuffer[fb_idx + 0] = (color >> 0) & 0xFF;
-                 ppu->framebuffer[fb_idx + 1] = (color >> 8) & 0xFF;
-                 ppu->framebuffer[fb_idx + 2] = (color >> 16) & 0xFF;
-                 ppu->framebuffer[fb_idx + 3] = (color >> 24) & 0xFF;
-             }
+/* Draw a visible line from its state and the current VRAM and OAM */
+static void render_line(gb_ppu_t *ppu, const gb_ppu_line_t *line, const u32 *lut) {
+    /* Line buffers for the compositor (compose.h) */
+    u8 scanline_row[GB_SCREEN_WIDTH]; /* BG/window colour indices, bit 7 BG-over-OBJ */
+    u8 obj_row[GB_SCREEN_WIDTH];      /* Sprite pixels, 0 where none */
+    memset(scanline_row, 0, sizeof(scanline_row));
+    memset(obj_row, 0, sizeof(obj_row));
+
+    /* 1. Render Background: the 21 tiles SCX overlaps, then the 160 pixels from SCX on */
+    if (line->lcdc & LCDC_BG_ENABLE) {
+        u16 map_base = (line->lcdc & LCDC_BG_TILEMAP) ? 0x1C00 : 0x1800;
+        u8 y = line->ly + line->scy;
+        u16 map_line = map_base + (y / 8) * 32;
+        u8 tx = line->scx / 8;
+        u8 tiles[GB_SCREEN_WIDTH + 8];
+
+        for (u8 i = 0; i < GB_SCREEN_WIDTH / 8 + 1; i++) {
+            fetch_tile_row(ppu, line->lcdc, map_line + ((tx + i) & 31), y % 8, tiles + i * 8);
         }
+        memcpy(scanline_row, tiles + (line->scx & 7), GB_SCREEN_WIDTH);
     }
 
     /* 2. Render Window */
-    if ((ppu->lcdc & LCDC_WIN_ENABLE) && ppu->ly >= ppu->wy) {
-        u16 map_base = (ppu->lcdc & LCDC_WIN_TILEMAP) ? 0x1C00 : 0x1800;
-        u16 tile_base = (ppu->lcdc & LCDC_BG_WIN_TILES) ? 0x0000 : 0x1000;
-        u8 ty = (ppu->ly - ppu->wy) / 8;
-        u8 py = (ppu->ly - ppu->wy) % 8;
-
-        int win_x_start = (int)ppu->wx - 7;
-        for (int x = win_x_start; x < GB_SCREEN_WIDTH; x++) {
-            if (x < 0) continue;
-            u8 tx = (x - win_x_start) / 8;
-            u8 px = (x - win_x_start) % 8;
-            u16 map_offset = map_base + (ty % 32) * 32 + (tx % 32);
-            
-            /* Fetch Tile Index */
-            u8 tile_index = ppu->vram[map_offset];
-            
-            /* Fetch Attributes (VRAM Bank 1) */
-            u8 attr = ppu->vram[map_offset + 0x2000];
-            
-            u8 cgb_pal_idx = attr & 0x07;
-            u8 cgb_vram_bank = (attr & (1 << 3)) ? 1 : 0;
-            bool x_flip = attr & (1 << 5);
-            bool y_flip = attr & (1 << 6);
-            bool bg_priority = attr & (1 << 7);
-            
-            int effective_py = y_flip ? (7 - py) : py;
-
-            u16 tile_addr;
-            if (ppu->lcdc & LCDC_BG_WIN_TILES) {
-                tile_addr = tile_base + tile_index * 16 + effective_py * 2;
-            } else {
-                tile_addr = tile_base + (int8_t)tile_index * 16 + effective_py * 2;
-            }
-            
-            if (cgb_vram_bank == 1) tile_addr += 0x2000;
-            
-            u8 b1 = ppu->vram[tile_addr];
-            u8 b2 = ppu->vram[tile_addr + 1];
-            
-            u8 bit = x_flip ? px : (7 - px);
-            u8 color_idx = ((b1 >> bit) & 1) | (((b2 >> bit) & 1) << 1);
-            
-            scanline_row[x] = color_idx | (bg_priority ? 0x80 : 0x00);
-            
-            /* Use DMG Palette for now */
-            u8 shade = (ppu->bgp >> (color_idx * 2)) & 3;
-            u32 color = default_palette[shade];
-            u32 fb_idx = (ppu->ly * GB_SCREEN_WIDTH + x) * 4;
-            
-            if (fb_idx + 3 < GB_FRAMEBUFFER_SIZE) {
-                ppu->framebuffer[fb_idx + 0] = (color >> 0) & 0xFF;
-                ppu->framebuffer[fb_idx + 1] = (color >> 8) & 0xFF;
-                ppu->framebuffer[fb_idx + 2] = (color >> 16) & 0xFF;
-                ppu->framebuffer[fb_idx + 3] = (color >> 24) & 0xFF;
+    if ((line->lcdc & LCDC_WIN_ENABLE) && line->ly >= line->wy) {
+        u16 map_base = (line->lcdc & LCDC_WIN_TILEMAP) ? 0x1C00 : 0x1800;
+        u8 y = line->ly - line->wy;
+        u16 map_line = map_base + ((y / 8) % 32) * 32;
+
+        int win_x_start = (int)line->wx - 7;
+        u8 tx = 0;
+        for (int col = win_x_start; col < GB_SCREEN_WIDTH; col += 8, tx++) {
+            u8 row[8];
+            fetch_tile_row(ppu, line->lcdc, map_line + (tx % 32), y % 8, row);
+            for (int px = 0; px < 8; px++) {
+                int x = col + px;
+                if (x >= 0 && x < GB_SCREEN_WIDTH) {
+                    scanline_row[x] = row[px];
+                }
             }
         }
     }
 
-    /* Apply background/window palette and write to framebuffer */
-    for (u32 x = 0; x < GB_SCREEN_WIDTH; x++) {
-        u8 color_idx = scanline_row[x];
-        u8 shade = (ppu->bgp >> (color_idx * 2)) & 3;
-        u32 color = default_palette[shade];
-        u32 fb_idx = (ppu->ly * GB_SCREEN_WIDTH + x) * 4;
-        
-        if (fb_idx + 3 < GB_FRAMEBUFFER_SIZE) {
-            ppu->framebuffer[fb_idx + 0] = (color >> 0) & 0xFF;
-            ppu->framebuffer[fb_idx + 1] = (color >> 8) & 0xFF;
-            ppu->framebuffer[fb_idx + 2] = (color >> 16) & 0xFF;
-            ppu->framebuffer[fb_idx + 3] = (color >> 24) & 0xFF;
+    /* 3. Render Sprites (OBJ): the line's sprites from highest priority
+     * down, each claiming the pixels where it is opaque. A claimed pixel
+     * stays claimed even when the sprite is behind a BG colour 1-3, so
+     * lower priority sprites never show through there. */
+    if (line->lcdc & LCDC_OBJ_ENABLE) {
+        const gb_oam_cache_t *oam = &ppu->oam_cache;
+        u8 obj_height = (line->lcdc & LCDC_OBJ_SIZE) ? 16 : 8;
+        u8 claimed[GB_SCREEN_WIDTH];
+        memset(claimed, 0, sizeof(claimed));
+
+        for (u8 n = 0; n < line->sprite_count; n++) {
+            u8 i = line->sprites[n];
+            u8 py = line->ly + 16 - oam->y[i];
+            if (py >= obj_height) continue; /* OBJ size shrank since the scan */
+
+            u8 attr = oam->attr[i];
+            bool flip_x = attr & (1 << 5);
+            bool behind = attr & (1 << 7);
+            u8 bank = (attr >> 3) & 1; /* CGB: bank of the tile data */
+            u8 tile = oam->tile[i];
+            if (attr & (1 << 6)) py = obj_height - 1 - py;
+            if (obj_height == 16) tile &= ~0x01;
+            tile += py / 8; /* Rows 8-15 are the next tile */
+
+            int x = (int)oam->x[i] - 8;
+            if (x <= -8 || x >= GB_SCREEN_WIDTH) continue; /* Still counts toward the ten */
+
+            /* Opaque pixels: bit n for pixel n of the row as drawn (the
+             * bitplanes hold the leftmost pixel in bit 7) */
+            const u8 *planes = ppu->vram + bank * 0x2000 + tile * 16 + (py % 8) * 2;
+            u32 mask = planes[0] | planes[1];
+            if (!flip_x) {
+                mask = (nibble_reverse[mask & 15] << 4) | nibble_reverse[mask >> 4];
+            }
+            if (x < 0) mask &= 0xFFu << -x;
+            if (x > GB_SCREEN_WIDTH - 8) mask &= 0xFFu >> (x - (GB_SCREEN_WIDTH - 8));
+            if (!mask) continue;
+
+            const u8 *row = gb_tile_cache_row(ppu->vram, bank, tile, py % 8, flip_x);
+            u8 palette = oam->palette[i];
+            while (mask) {
+                u8 px = (u8)__builtin_ctz(mask);
+                mask &= mask - 1;
+                u8 sx = (u8)(x + px);
+                if (claimed[sx]) continue;
+                claimed[sx] = 1;
+                if (behind && (scanline_row[sx] & 3)) continue;
+                obj_row[sx] = palette | row[px];
+            }
         }
     }
 
-    /* 3. Render Sprites (OBJ) */
-    if (ppu->lcdc & LCDC_OBJ_ENABLE) {
-        u8 obj_height = (ppu->lcdc & LCDC_OBJ_SIZE) ? 16 : 8;
-        int sprites_rendered = 0;
-
-        /* Sort sprites by X coordinate could be implemented for higher accuracy in CGB,
-           but standard OAM order is often sufficient for basic emulation. 
-           However, CGB uses OAM index for priority, while DMG uses X coord.
-           For now, stick to OAM order. */
-
-        for (int i = 0; i < 40 && sprites_rendered < 10; i++) {
-            u16 oam_addr = i * 4;
-            int y = (int)ppu->oam[oam_addr] - 16;
-            int x = (int)ppu->oam[oam_addr + 1] - 8;
-            u8 tile_index = ppu->oam[oam_addr + 2];
-            u8 attr = ppu->oam[oam_addr + 3];
-
-            if (ppu->ly >= y && ppu->ly < (y + obj_height)) {
-                sprites_rendered++;
-                bool flip_y = attr & (1 << 6);
-                bool flip_x = attr & (1 << 5);
-                bool priority = attr & (1 << 7);
-                
-                /* DMG Palette selection */
-                u8 palette_reg = (attr & (1 << 4)) ? ppu->obp1 : ppu->obp0;
-                
-                /* CGB Attributes */
-                u8 cgb_pal_idx = attr & 0x07;
-                u8 cgb_vram_bank = (attr & (1 << 3)) ? 1 : 0; /* Attributes bit 3 is VRAM bank for character data */
+    /* 4. Composite through the line's BGP/OBP0/OBP1 colour table */
+    gb_compose_line(ppu->framebuffer + line->ly * GB_SCREEN_WIDTH * 4, scanline_row, obj_row, lut);
+}
 
-                int py = ppu->ly - y;
-                if (flip_y) py = obj_height - 1 - py;
+/* The current line's state, as it is when mode 3 ends */
+static void capture_line(const gb_ppu_t *ppu, gb_ppu_line_t *line) {
+    line->ly = ppu->ly;
+    line->lcdc = ppu->lcdc;
+    line->scy = ppu->scy;
+    line->scx = ppu->scx;
+    line->wy = ppu->wy;
+    line->wx = ppu->wx;
+    line->bgp = ppu->bgp;
+    line->obp0 = ppu->obp0;
+    line->obp1 = ppu->obp1;
+    line->sprite_count = ppu->line_sprite_count;
+    memcpy(line->sprites, ppu->line_sprites, sizeof(line->sprites));
+}
 
-                if (obj_height == 16) tile_index &= ~0x01;
+void gb_ppu_render_scanline(gb_ppu_t *ppu) {
+    if (!(ppu->lcdc & LCDC_ENABLE)) return;
 
-                /* Handle VRAM banking for tile data */
-                u16 tile_addr = tile_index * 16 + py * 2;
-                if (cgb_vram_bank == 1) tile_addr += 0x2000;
-                
-                u8 b1 = ppu->vram[tile_addr];
-                u8 b2 = ppu->vram[tile_addr + 1];
-
-                for (int px = 0; px < 8; px++) {
-                    int screen_x = x + px;
-                    if (screen_x < 0 || screen_x >= GB_SCREEN_WIDTH) continue;
-
-                    u8 bit = flip_x ? px : 7 - px;
-                    u8 color_idx = ((b1 >> bit) & 1) | (((b2 >> bit) & 1) << 1);
-
-                    if (color_idx == 0) continue; /* Transparent */
-
-                    /* Priority check */
-                    /* If CGB logic enabled (checking lcdc or such), priorities change a bit.
-                       For now, use DMG-style priority logic regarding BG/Win. */
-                    if (priority && scanline_row[screen_x] != 0) continue;
-                    
-                    /* Color selection */
-                    /* TODO: Distinguish between DMG and CGB mode based on a global flag.
-                       For now, assuming DMG behavior if CGB palettes aren't fully set up logic.
-                       Or we can try to support both. */
-                       
-                    /* Check if we are using CGB palettes - actually we should check if CGB mode is active.
-                       Since we don't have usage flags, let's just stick to DMG rendering for now unless 
-                       we add CGB rendering path. 
-                       Wait, the task IS to add CGB rendering. */
-                    
-                    /* CGB Rendering Polder */
-                    /* Extract RGB555 from cgb_obj_pal[cgb_pal_idx] */
-                    /* Each palette is 8 bytes (4 colors * 2 bytes). */
-                    u16 pal_offset = cgb_pal_idx * 8 + color_idx * 2;
-                    u8 c_lo = ppu->cgb_obj_pal[pal_offset];
-                    u8 c_hi = ppu->cgb_obj_pal[pal_offset + 1];
-                    u16 c_word = c_lo | (c_hi << 8);
-                    
-                    /* Convert RGB555 to RGBA8888 */
-                    u8 r = (c_word & 0x1F) << 3;
-                    u8 g = ((c_word >> 5) & 0x1F) << 3;
-                    u8 b = ((c_word >> 10) & 0x1F) << 3;
-                    
-                    /* Render! */
-                    u32 fb_idx = (ppu->ly * GB_SCREEN_WIDTH + screen_x) * 4;
-                    if (fb_idx + 3 < GB_FRAMEBUFFER_SIZE) {
-                         /* If CGB palettes are all zero (uninitialized), fall back to DMG?
-                            Actually, default to DMG green for now if we haven't detected CGB mode properly.
-                            Let's rely on standard DMG rendering for this step and add specific CGB check later?
-                            No, let's implement the specific check now. */
-                         
-                         /* Simple heuristic: if we accessed VRAM bank 1 via attributes, it's definitely CGB. */
-                         // For now, let's just use DMG colors as placeholder to ensure existing code works,
-                         // and we will switch to CGB colors when we implement the "is_cgb" flag in next step.
-                         // But I'll leave the CGB color calculation commented out or use it conditionally.
-                         
-                         u8 shade = (palette_reg >> (color_idx * 2)) & 3;
-                         u32 color = default_palette[shade];
-                         
-                         ppu->framebuffer[fb_idx + 0] = (color >> 0) & 0xFF;
-                         ppu->framebuffer[fb_idx + 1] = (color >> 8) & 0xFF;
-                         ppu->framebuffer[fb_idx + 2] = (color >> 16) & 0xFF;
-                         ppu->framebuffer[fb_idx + 3] = (color >> 24) & 0xFF;
-                    }
-                }
-            }
+    if (ppu->ly >= GB_SCREEN_HEIGHT) return;
+
+    gb_ppu_line_t line;
+    capture_line(ppu, &line);
+    render_line(ppu, &line, ppu->dmg_lut);
+}
+
+/* Swap a journaled value with the one in memory, keeping the caches that
+ * follow VRAM and OAM in step */
+static void log_swap(gb_ppu_t *ppu, gb_ppu_log_write_t *w) {
+    u8 *mem;
+    if (w->addr < GB_PPU_LOG_OAM) {
+        mem = &ppu->vram[w->addr];
+        gb_tile_cache_touch(w->addr);
+    } else {
+        mem = &ppu->oam[w->addr - GB_PPU_LOG_OAM];
+    }
+    u8 value = *mem;
+    *mem = w->value;
+    w->value = value;
+    if (w->addr >= GB_PPU_LOG_OAM) {
+        oam_decode(ppu, (w->addr - GB_PPU_LOG_OAM) >> 2);
+    }
+}
+
+void gb_ppu_flush_lines(gb_ppu_t *ppu) {
+    if (!line_log.lines) {
+        return;
+    }
+
+    for (u32 i = line_log.writes; i-- > 0;) {
+        log_swap(ppu, &line_log.write[i]);
+    }
+
+    u32 lut[GB_COMPOSE_LUT_SIZE] = { 0 };
+    u32 next = 0;
+    for (u32 n = 0; n < line_log.lines; n++) {
+        const gb_ppu_line_t *line = &line_log.line[n];
+        while (next < line_log.writes && line_log.write[next].line <= n) {
+            log_swap(ppu, &line_log.write[next++]);
         }
+        if (n == 0 || line->bgp != line[-1].bgp) dmg_palette_update(lut, 0, line->bgp);
+        if (n == 0 || line->obp0 != line[-1].obp0) dmg_palette_update(lut, GB_COMPOSE_OBP0, line->obp0);
+        if (n == 0 || line->obp1 != line[-1].obp1) dmg_palette_update(lut, GB_COMPOSE_OBP1, line->obp1);
+        render_line(ppu, line, lut);
     }
+    while (next < line_log.writes) {
+        log_swap(ppu, &line_log.write[next++]);
+    }
+
+    line_log.lines = 0;
+    line_log.writes = 0;
+}
+
+void gb_ppu_drop_lines(void) {
+    line_log.lines = 0;
+    line_log.writes = 0;
+}
+
+void gb_ppu_log_write(gb_ppu_t *ppu, u16 addr, u16 len) {
+    if (!line_log.lines) {
+        return;
+    }
+    if (line_log.writes + len > GB_PPU_LOG_WRITES) {
+        gb_ppu_flush_lines(ppu);
+        return;
+    }
+    const u8 *mem = addr < GB_PPU_LOG_OAM ? &ppu->vram[addr] : &ppu->oam[addr - GB_PPU_LOG_OAM];
+    for (u16 i = 0; i < len; i++) {
+        gb_ppu_log_write_t *w = &line_log.write[line_log.writes++];
+        w->addr = addr + i;
+        w->line = (u8)line_log.lines;
+        w->value = mem[i];
+    }
+}
+
+void gb_ppu_set_deferred(gb_ppu_t *ppu, bool enabled) {
+    gb_ppu_flush_lines(ppu);
+    gb_ppu_deferred = enabled;
 }
 
 void gb_ppu_write_vram(gb_ppu_t *ppu, u16 addr, u8 value) {
     if (addr < 0x2000) {
-        ppu->vram[addr] = value;
+        u16 offset = ((ppu->vbk & 0x01) ? 0x2000 : 0) + addr;
+        gb_ppu_log_write(ppu, offset, 1);
+        ppu->vram[offset] = value;
+        gb_tile_cache_touch(offset);
     }
 }
 
 u8 gb_ppu_read_vram(gb_ppu_t *ppu, u16 addr) {
     if (addr < 0x2000) {
-        return ppu->vram[addr];
+        return ppu->vram[((ppu->vbk & 0x01) ? 0x2000 : 0) + addr];
     }
     return 0xFF;
 }
 
 void gb_ppu_write_oam(gb_ppu_t *ppu, u16 addr, u8 value) {
     if (addr < 0xA0) {
+        gb_ppu_log_write(ppu, GB_PPU_LOG_OAM + addr, 1);
         ppu->oam[addr] = value;
+        oam_decode(ppu, addr >> 2);
     }
 }
 
@@ -491,17 +584,33 @@ u8 gb_ppu_read_reg(gb_ppu_t *ppu, u16 addr) {
 }
 
 /* Write Register */
-void gb_ppu_write_reg(gb_ppu_t *ppu, u16 addr, u8 value) {
+void gb_ppu_write_reg(gb_ppu_t *ppu, void *mmu_ptr, u16 addr, u8 value) {
+    gb_mmu_t *mmu = (gb_mmu_t *)mmu_ptr;
+    
     switch (addr) {
-        case 0xFF40: ppu->lcdc = value; break;
+        case 0xFF40: {
+            u8 old_lcdc = ppu->lcdc;
+            ppu->lcdc = value;
+            if ((old_lcdc & LCDC_ENABLE) && !(value & LCDC_ENABLE)) {
+                /* LCD off: the PPU idles at LY 0 and stops scheduling */
+                gb_ppu_flush_lines(ppu);
+                ppu->ly = 0;
+                ppu->mode = PPU_MODE_HBLANK;
+                gb_sched_cancel(mmu->sched, GB_EVENT_PPU);
+            } else if (!(old_lcdc & LCDC_ENABLE) && (value & LCDC_ENABLE)) {
+                /* LCD on: line 0 restarts from the H-Blank the PPU idled in */
+                schedule_next(mmu, mmu->sched->now, PPU_HBLANK_CYCLES);
+            }
+            break;
+        }
         case 0xFF41: ppu->stat = (ppu->stat & 0x07) | (value & 0xF8); break;
         case 0xFF42: ppu->scy = value; break;
         case 0xFF43: ppu->scx = value; break;
         case 0xFF44: break;
         case 0xFF45: ppu->lyc = value; break;
-        case 0xFF47: ppu->bgp = value; break;
-        case 0xFF48: ppu->obp0 = value; break;
-        case 0xFF49: ppu->obp1 = value; break;
+        case 0xFF47: ppu->bgp = value; dmg_palette_update(ppu->dmg_lut, 0, value); break;
+        case 0xFF48: ppu->obp0 = value; dmg_palette_update(ppu->dmg_lut, GB_COMPOSE_OBP0, value); break;
+        case 0xFF49: ppu->obp1 = value; dmg_palette_update(ppu->dmg_lut, GB_COMPOSE_OBP1, value); break;
         case 0xFF4A: ppu->wy = value; break;
         case 0xFF4B: ppu->wx = value; break;
         /* GBC Registers */
@@ -510,6 +619,7 @@ void gb_ppu_write_reg(gb_ppu_t *ppu, u16 addr, u8 value) {
         case 0xFF69: {
             u8 idx = ppu->bcps & 0x3F;
             ppu->cgb_bg_pal[idx] = value;
+            cgb_palette_update(ppu, ppu->cgb_bg_lut, ppu->cgb_bg_pal, idx);
             if (ppu->bcps & 0x80) { /* Auto Increment */
                 ppu->bcps = (ppu->bcps & 0x80) | ((idx + 1) & 0x3F);
             }
@@ -519,6 +629,7 @@ void gb_ppu_write_reg(gb_ppu_t *ppu, u16 addr, u8 value) {
         case 0xFF6B: {
             u8 idx = ppu->ocps & 0x3F;
             ppu->cgb_obj_pal[idx] = value;
+            cgb_palette_update(ppu, ppu->cgb_obj_lut, ppu->cgb_obj_pal, idx);
             if (ppu->ocps & 0x80) { /* Auto Increment */
                 ppu->ocps = (ppu->ocps & 0x80) | ((idx + 1) & 0x3F);
             }
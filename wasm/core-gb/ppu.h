@@ -29,6 +29,18 @@
 #define GB_SCREEN_HEIGHT 144
 #define GB_FRAMEBUFFER_SIZE (GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT * 4)  /* RGBA */
 
+#define GB_OAM_SPRITES  40
+#define GB_LINE_SPRITES 10   /* Sprites the PPU draws on one line */
+
+/* OAM decoded one array per field, updated on every OAM write and DMA */
+typedef struct {
+    u8 y[GB_OAM_SPRITES];        /* Top line + 16 */
+    u8 x[GB_OAM_SPRITES];        /* Left column + 8 */
+    u8 tile[GB_OAM_SPRITES];
+    u8 attr[GB_OAM_SPRITES];     /* Behind-BG, flips and bank bits as in OAM */
+    u8 palette[GB_OAM_SPRITES];  /* GB_COMPOSE_OBP0 or GB_COMPOSE_OBP1 */
+} gb_oam_cache_t;
+
 /* PPU modes */
 typedef enum {
     PPU_MODE_HBLANK = 0,
@@ -81,8 +93,22 @@ typedef struct gb_ppu_t {
     u8 ocpd; /* 0xFF6B */
     
     /* Internal state */
-    gb_ppu_mode_t mode;
-    u32 mode_cycles;
+    gb_ppu_mode_t mode;  /* Mode changes are GB_EVENT_PPU scheduler events */
+
+    /* Palettes as RGBA pixels, rebuilt only when a palette register is
+     * written (gb_ppu_refresh_palettes() rebuilds them all) */
+    u32 dmg_lut[16];        /* compose.h layout: BGP 0-3, OBP0 4-7, OBP1 8-11 */
+    u32 cgb_bg_lut[8 * 4];  /* Palette * 4 + colour */
+    u32 cgb_obj_lut[8 * 4];
+    bool color_correction;  /* CGB LUTs through the LCD curve, a host setting */
+
+    gb_oam_cache_t oam_cache;
+
+    /* Sprites on the current line, picked from the OAM cache as OAM scan
+     * ends: OAM indices in DMG drawing priority (lowest X first, then
+     * lowest index) */
+    u8 line_sprites[GB_LINE_SPRITES];
+    u8 line_sprite_count;
     
     /* Framebuffer (RGBA format for easy rendering) */
     u8 framebuffer[GB_FRAMEBUFFER_SIZE];
@@ -111,23 +137,79 @@ void gb_ppu_init(gb_ppu_t *ppu);
 void gb_ppu_reset(gb_ppu_t *ppu);
 
 /**
- * Step PPU by given number of cycles
- * Returns true if a frame was completed
+ * Schedule the first mode transition after reset
+ */
+void gb_ppu_start(gb_ppu_t *ppu, void *mmu);
+
+/**
+ * GB_EVENT_PPU handler: perform the mode transition due at `when`
+ * and schedule the next one
+ * Returns true if a frame was completed (VBlank entered)
  */
-bool gb_ppu_step(gb_ppu_t *ppu, void *mmu, u32 cycles);
+bool gb_ppu_event(gb_ppu_t *ppu, void *mmu, u64 when);
 
 /**
  * Render a scanline
  */
 void gb_ppu_render_scanline(gb_ppu_t *ppu);
 
+/*
+ * Deferred rendering: visible lines are logged as mode 3 ends and drawn
+ * together at VBlank (see ppu.c), with the same result as drawing each one
+ * then. The framebuffer is only brought up to date at VBlank, when the LCD
+ * is switched off and by gb_ppu_flush_lines().
+ */
+extern bool gb_ppu_deferred;
+
+/* Journal address of OAM byte 0 for gb_ppu_log_write() */
+#define GB_PPU_LOG_OAM 0x4000
+
+/**
+ * Turn deferred rendering on or off (drawing any lines still logged)
+ */
+void gb_ppu_set_deferred(gb_ppu_t *ppu, bool enabled);
+
+/**
+ * Draw the lines logged so far
+ */
+void gb_ppu_flush_lines(gb_ppu_t *ppu);
+
+/**
+ * Forget the logged lines without drawing them (reset, state load)
+ */
+void gb_ppu_drop_lines(void);
+
+/**
+ * Call before writing `len` bytes of VRAM (offset, bank 1 from 0x2000) or
+ * OAM (GB_PPU_LOG_OAM + offset) behind the PPU's back, e.g. by DMA, so
+ * logged lines still draw from the old contents
+ */
+void gb_ppu_log_write(gb_ppu_t *ppu, u16 addr, u16 len);
+
+/**
+ * Rebuild every palette table from the palette registers and memory
+ * (after init, a state load or a colour-correction change)
+ */
+void gb_ppu_refresh_palettes(gb_ppu_t *ppu);
+
+/**
+ * Pass CGB colours through the LCD colour-correction curve (off: RGB555
+ * scaled straight to 8 bits per channel)
+ */
+void gb_ppu_set_color_correction(gb_ppu_t *ppu, bool enabled);
+
+/**
+ * Re-decode all of OAM into the OAM cache (after an OAM DMA)
+ */
+void gb_ppu_refresh_oam(gb_ppu_t *ppu);
+
 /**
- * Write to VRAM
+ * Write to VRAM in the bank VBK selects (`addr` relative to 0x8000)
  */
 void gb_ppu_write_vram(gb_ppu_t *ppu, u16 addr, u8 value);
 
 /**
- * Read from VRAM
+ * Read from VRAM in the bank VBK selects
  */
 u8 gb_ppu_read_vram(gb_ppu_t *ppu, u16 addr);
 
@@ -142,7 +224,7 @@ void gb_ppu_write_oam(gb_ppu_t *ppu, u16 addr, u8 value);
 u8 gb_ppu_read_oam(gb_ppu_t *ppu, u16 addr);
 
 u8 gb_ppu_read_reg(gb_ppu_t *ppu, u16 addr);
-void gb_ppu_write_reg(gb_ppu_t *ppu, u16 addr, u8 value);
+void gb_ppu_write_reg(gb_ppu_t *ppu, void *mmu, u16 addr, u8 value);
 
 /* STAT bits */
 #define STAT_INTERRUPT_LYC  (1 << 6)
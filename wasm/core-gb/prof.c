@@ -0,0 +1,221 @@
+/**
+ * NeoBoy - Game Boy Guest Code Profiler Implementation
+ *
+ * Purpose: Hotspot and call-stack tables and their text export
+ */
+
+#include "prof.h"
+
+#if GB_GUEST_PROFILER
+
+#include "core.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Tables are not filled past 3/4 so that probing always ends */
+#define GB_PROF_HOT_LIMIT   (GB_PROF_HOT_SLOTS / 4 * 3)
+#define GB_PROF_STACK_LIMIT (GB_PROF_STACK_SLOTS / 4 * 3)
+
+#define GB_PROF_HASH_SEED 0x811C9DC5u
+
+gb_prof_t gb_prof;
+
+/* Export buffer, reused across calls */
+static char *text;
+static u32 text_size;
+static u32 text_cap;
+
+void gb_prof_reset(void) {
+    bool enabled = gb_prof.enabled;
+    memset(&gb_prof, 0, sizeof(gb_prof));
+    gb_prof.enabled = enabled;
+    gb_prof.hashes[0] = GB_PROF_HASH_SEED;
+}
+
+u32 gb_prof_key(const gb_mmu_t *mmu, u16 pc) {
+    return (u32)gb_mmu_code_bank(mmu, pc) << 16 | pc;
+}
+
+static inline u32 hot_index(u32 key) {
+    return (key * 0x9E3779B1u) >> 19; /* 13 bits: GB_PROF_HOT_SLOTS */
+}
+
+static void prof_sample(void) {
+    u8 depth = gb_prof.depth;
+    u32 hash = gb_prof.hashes[depth];
+
+    for (u32 i = hash;; i++) {
+        gb_prof_stack_t *s = &gb_prof.stacks[i & (GB_PROF_STACK_SLOTS - 1)];
+        if (!s->cycles) {
+            if (gb_prof.stack_used >= GB_PROF_STACK_LIMIT) {
+                gb_prof.stack_dropped += gb_prof.pending;
+                return;
+            }
+            gb_prof.stack_used++;
+            s->hash = hash;
+            s->depth = depth;
+            for (u8 d = 0; d < depth; d++) {
+                s->frames[d] = gb_prof.frames[d].key;
+            }
+            s->cycles = gb_prof.pending;
+            return;
+        }
+        if (s->hash != hash || s->depth != depth) {
+            continue;
+        }
+        u8 d = 0;
+        while (d < depth && s->frames[d] == gb_prof.frames[d].key) {
+            d++;
+        }
+        if (d == depth) {
+            s->cycles += gb_prof.pending;
+            return;
+        }
+    }
+}
+
+void gb_prof_retire(u32 cycles) {
+    u32 key = gb_prof.key;
+    for (u32 i = hot_index(key);; i++) {
+        gb_prof_hot_t *h = &gb_prof.hot[i & (GB_PROF_HOT_SLOTS - 1)];
+        if (h->cycles && h->key == key) {
+            h->cycles += cycles;
+            break;
+        }
+        if (!h->cycles) {
+            if (gb_prof.hot_used >= GB_PROF_HOT_LIMIT) {
+                gb_prof.hot_dropped += cycles;
+                break;
+            }
+            gb_prof.hot_used++;
+            h->key = key;
+            h->cycles = cycles;
+            break;
+        }
+    }
+
+    gb_prof.pending += cycles;
+    if (gb_prof.pending >= GB_PROF_SAMPLE_CYCLES) {
+        prof_sample();
+        gb_prof.pending = 0;
+    }
+}
+
+void gb_prof_call(const gb_mmu_t *mmu, u16 target, u16 sp, bool irq) {
+    u8 depth = gb_prof.depth;
+    if (depth == GB_PROF_MAX_DEPTH) {
+        gb_prof.overflow++;
+        return;
+    }
+    u32 key = gb_prof_key(mmu, target) | (irq ? GB_PROF_IRQ : 0);
+    gb_prof.frames[depth].key = key;
+    gb_prof.frames[depth].sp = sp;
+    gb_prof.hashes[depth + 1] = (gb_prof.hashes[depth] ^ key) * 0x01000193u;
+    gb_prof.depth = depth + 1;
+}
+
+void gb_prof_ret(u16 sp) {
+    while (gb_prof.depth && gb_prof.frames[gb_prof.depth - 1].sp < sp) {
+        gb_prof.depth--;
+    }
+}
+
+/* --- Text export --- */
+
+static void text_append(const char *s, u32 len) {
+    if (text_size + len + 1 > text_cap) {
+        u32 cap = text_cap ? text_cap : 4096;
+        while (text_size + len + 1 > cap) {
+            cap *= 2;
+        }
+        char *grown = realloc(text, cap);
+        if (!grown) {
+            return;
+        }
+        text = grown;
+        text_cap = cap;
+    }
+    memcpy(text + text_size, s, len);
+    text_size += len;
+    text[text_size] = '\0';
+}
+
+static void text_frame(u32 key) {
+    char name[24];
+    int len = snprintf(name, sizeof(name), "%02X:%04X%s",
+                       (key & ~GB_PROF_IRQ) >> 16, key & 0xFFFF, (key & GB_PROF_IRQ) ? "(irq)" : "");
+    text_append(name, (u32)len);
+}
+
+static void text_count(u64 cycles) {
+    char count[24];
+    int len = snprintf(count, sizeof(count), " %llu\n", (unsigned long long)cycles);
+    text_append(count, (u32)len);
+}
+
+static int hot_compare(const void *a, const void *b) {
+    const gb_prof_hot_t *x = *(const gb_prof_hot_t *const *)a;
+    const gb_prof_hot_t *y = *(const gb_prof_hot_t *const *)b;
+    if (x->cycles != y->cycles) {
+        return x->cycles > y->cycles ? -1 : 1;
+    }
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static void export_folded(void) {
+    for (u32 i = 0; i < GB_PROF_STACK_SLOTS; i++) {
+        const gb_prof_stack_t *s = &gb_prof.stacks[i];
+        if (!s->cycles) {
+            continue;
+        }
+        text_append("main", 4);
+        for (u8 d = 0; d < s->depth; d++) {
+            text_append(";", 1);
+            text_frame(s->frames[d]);
+        }
+        text_count(s->cycles);
+    }
+}
+
+static void export_hotspots(void) {
+    const gb_prof_hot_t **order = malloc(sizeof(*order) * (gb_prof.hot_used + 1));
+    if (!order) {
+        return;
+    }
+    u32 count = 0;
+    for (u32 i = 0; i < GB_PROF_HOT_SLOTS; i++) {
+        if (gb_prof.hot[i].cycles) {
+            order[count++] = &gb_prof.hot[i];
+        }
+    }
+    qsort(order, count, sizeof(*order), hot_compare);
+    for (u32 i = 0; i < count; i++) {
+        text_frame(order[i]->key);
+        text_count(order[i]->cycles);
+    }
+    free(order);
+}
+
+const char *gb_prof_export(int format, u32 *size) {
+    bool hotspots = format == GB_GUEST_PROFILE_HOTSPOTS;
+    u64 dropped = hotspots ? gb_prof.hot_dropped : gb_prof.stack_dropped;
+
+    text_size = 0;
+    text_append("", 0);
+    if (hotspots) {
+        export_hotspots();
+    } else {
+        export_folded();
+    }
+    if (dropped) {
+        text_append("[dropped]", 9);
+        text_count(dropped);
+    }
+    if (size) {
+        *size = text_size;
+    }
+    return text ? text : "";
+}
+
+#endif /* GB_GUEST_PROFILER */
@@ -0,0 +1,132 @@
+/**
+ * NeoBoy - Game Boy Guest Code Profiler Header
+ *
+ * Purpose: Where the emulated game spends its cycles
+ *
+ * Built only with GB_GUEST_PROFILER=1 (profile.h, `make gb-prof` and
+ * `make guestprof`); otherwise every GB_PROF_* hook below is empty and the
+ * core carries no trace of it. When built in, it is started and stopped at
+ * runtime with gb_set_guest_profiler() and gb_cpu_run() interprets while it
+ * runs, so every instruction passes through the hooks.
+ *
+ * Two views are collected:
+ *
+ *   Hotspots  cycles per (ROM bank, PC), in a sparse hash table. HALT and
+ *             skipped idle loops count towards the instruction they wait on.
+ *
+ *   Stacks    a shadow call stack built from CALL, RST and interrupt entry
+ *             and unwound by RET/RETI, sampled every GB_PROF_SAMPLE_CYCLES.
+ *             Each sample carries the cycles since the previous one, so the
+ *             stack totals add up to the run time.
+ *
+ * Code is named "bank:address" as in RGBDS symbol files (bank 00 outside the
+ * switchable ROM area). A RET matches every frame whose return address lies
+ * below the new SP, so code that drops return addresses or moves SP still
+ * unwinds on its next return. Both views export as text: folded stacks for
+ * flamegraph.pl / speedscope, and hotspots sorted by cycles.
+ */
+
+#ifndef GB_PROF_H
+#define GB_PROF_H
+
+#include "../common/common.h"
+#include "mmu.h"
+#include "profile.h"
+
+#if GB_GUEST_PROFILER
+
+#define GB_PROF_HOT_SLOTS     8192  /* Distinct (bank, PC), power of two */
+#define GB_PROF_STACK_SLOTS   2048  /* Distinct stacks, power of two */
+#define GB_PROF_MAX_DEPTH     24    /* Deeper frames are not tracked */
+#define GB_PROF_SAMPLE_CYCLES 512   /* About 137 samples per frame */
+
+/* Frame entered by an interrupt rather than a CALL/RST (gb_prof_frame_t.key) */
+#define GB_PROF_IRQ 0x80000000u
+
+typedef struct {
+    u32 key;       /* bank << 16 | address of the entry point, | GB_PROF_IRQ */
+    u16 sp;        /* Where the return address was pushed */
+} gb_prof_frame_t;
+
+typedef struct {
+    u32 key;
+    u64 cycles;    /* 0 marks a free slot */
+} gb_prof_hot_t;
+
+typedef struct {
+    u32 hash;
+    u8 depth;
+    u32 frames[GB_PROF_MAX_DEPTH];  /* Entry keys, outermost first */
+    u64 cycles;    /* 0 marks a free slot */
+} gb_prof_stack_t;
+
+typedef struct {
+    bool enabled;
+    u32 key;                       /* Instruction being executed */
+    u32 pending;                   /* Cycles since the last stack sample */
+    u8 depth;
+    u32 overflow;                  /* Calls made beyond GB_PROF_MAX_DEPTH */
+    gb_prof_frame_t frames[GB_PROF_MAX_DEPTH];
+    u32 hashes[GB_PROF_MAX_DEPTH + 1]; /* Hash of frames[0..d) at index d */
+    u32 hot_used;
+    u32 stack_used;
+    u64 hot_dropped;               /* Cycles not recorded: hot[] was full */
+    u64 stack_dropped;             /* Likewise for stacks[] */
+    gb_prof_hot_t hot[GB_PROF_HOT_SLOTS];
+    gb_prof_stack_t stacks[GB_PROF_STACK_SLOTS];
+} gb_prof_t;
+
+extern gb_prof_t gb_prof;
+
+/**
+ * Clear the profile and the shadow stack
+ */
+void gb_prof_reset(void);
+
+/**
+ * Profile key (bank << 16 | pc) of the code at `pc` as currently mapped
+ */
+u32 gb_prof_key(const gb_mmu_t *mmu, u16 pc);
+
+/**
+ * Charge `cycles` to gb_prof.key and take a stack sample when one is due
+ */
+void gb_prof_retire(u32 cycles);
+
+/**
+ * Enter the routine at `target`; `sp` points at the pushed return address
+ */
+void gb_prof_call(const gb_mmu_t *mmu, u16 target, u16 sp, bool irq);
+
+/**
+ * Drop the frames a return that left SP at `sp` has left
+ */
+void gb_prof_ret(u16 sp);
+
+/**
+ * Render the profile as NUL-terminated text (GuestProfileFormat in core.h)
+ * The buffer stays valid until the next call
+ */
+const char *gb_prof_export(int format, u32 *size);
+
+#define GB_PROF_ACTIVE()                 (gb_prof.enabled)
+#define GB_PROF_FETCH(mmu, pc)           do { if (gb_prof.enabled) gb_prof.key = gb_prof_key(mmu, pc); } while (0)
+#define GB_PROF_RETIRE(cycles)           do { if (gb_prof.enabled) gb_prof_retire(cycles); } while (0)
+#define GB_PROF_CALL(mmu, target, sp)    do { if (gb_prof.enabled) gb_prof_call(mmu, target, sp, false); } while (0)
+#define GB_PROF_IRQ_ENTRY(mmu, vec, sp)  do { if (gb_prof.enabled) gb_prof_call(mmu, vec, sp, true); } while (0)
+#define GB_PROF_RET(sp)                  do { if (gb_prof.enabled) gb_prof_ret(sp); } while (0)
+#define GB_PROF_UNWIND()                 (gb_prof.depth = 0) /* PC and SP replaced (reset, state load) */
+
+#else
+
+#define GB_PROF_ACTIVE()                 0
+#define GB_PROF_FETCH(mmu, pc)           ((void)0)
+#define GB_PROF_RETIRE(cycles)           ((void)0)
+#define GB_PROF_CALL(mmu, target, sp)    ((void)0)
+#define GB_PROF_IRQ_ENTRY(mmu, vec, sp)  ((void)0)
+#define GB_PROF_RET(sp)                  ((void)0)
+#define GB_PROF_UNWIND()                 ((void)0)
+
+#endif /* GB_GUEST_PROFILER */
+
+#endif /* GB_PROF_H */
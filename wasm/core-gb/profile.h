@@ -0,0 +1,68 @@
+/**
+ * NeoBoy - Game Boy Core Build Profiles
+ *
+ * Purpose: Compile-time choice between accuracy and raw speed
+ *
+ * The core is built from one source tree in one of two profiles:
+ *
+ *   NEOBOY_PROFILE_ACCURATE (default)  every timing quirk the core models
+ *   NEOBOY_PROFILE_FAST                drops the per-instruction checks that
+ *                                      only a handful of ROMs depend on
+ *
+ * Each quirk is a 0/1 feature macro below and is tested with plain `#if`,
+ * so a FAST build carries no runtime branch for what it leaves out. Use
+ * `make profile-diff ROM=...` to see on which frame the two profiles'
+ * framebuffers first diverge for a given ROM.
+ */
+
+#ifndef GB_PROFILE_H
+#define GB_PROFILE_H
+
+#if defined(NEOBOY_PROFILE_FAST) && defined(NEOBOY_PROFILE_ACCURATE)
+#error "NEOBOY_PROFILE_FAST and NEOBOY_PROFILE_ACCURATE are mutually exclusive"
+#endif
+
+#ifdef NEOBOY_PROFILE_FAST
+
+#define GB_PROFILE_NAME "fast"
+
+/* EI takes effect immediately instead of after the following instruction */
+#define GB_EI_DELAY 0
+
+/* HALT with IME=0 and an interrupt pending simply falls through */
+#define GB_HALT_BUG 0
+
+/* Events are only dispatched between instructions: one that falls due during
+ * an instruction is seen after the next one, so its interrupt is taken up to
+ * one instruction late */
+#define GB_EVENT_CATCH_UP 0
+
+#else
+
+#define GB_PROFILE_NAME "accurate"
+
+#define GB_EI_DELAY 1
+#define GB_HALT_BUG 1
+
+/* Events that fell due during an instruction are dispatched before
+ * interrupts are sampled at its end */
+#define GB_EVENT_CATCH_UP 1
+
+#endif
+
+/* Not part of either profile: 1 takes ADD/ADC/SUB/SBC/CP, INC/DEC and DAA
+ * results and flags from tables generated into alu_tables.h (about 517 KB,
+ * see scripts/gen-alu-tables.py) instead of computing them. Compare the two
+ * paths with `make alu-bench ROM=...`. */
+#ifndef GB_ALU_TABLES
+#define GB_ALU_TABLES 0
+#endif
+
+/* Not part of either profile: 1 builds in the guest code profiler (prof.h),
+ * which hooks every instruction, call and return. Without it the hooks
+ * compile to nothing. */
+#ifndef GB_GUEST_PROFILER
+#define GB_GUEST_PROFILER 0
+#endif
+
+#endif /* GB_PROFILE_H */
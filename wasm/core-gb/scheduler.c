@@ -0,0 +1,93 @@
+/**
+ * NeoBoy - Game Boy Event Scheduler Implementation
+ *
+ * Purpose: Event bookkeeping and dispatch to the owning components
+ */
+
+#include "core.h"
+#include "scheduler.h"
+#include "mmu.h"
+#include "ppu.h"
+#include "apu.h"
+#include <string.h>
+
+static void find_next(gb_scheduler_t *sched) {
+    u64 next = GB_SCHED_NEVER;
+    u8 next_event = 0;
+
+    /* Strict compare: lower event ids win ties */
+    for (u8 i = 0; i < GB_EVENT_COUNT; i++) {
+        if (sched->when[i] < next) {
+            next = sched->when[i];
+            next_event = i;
+        }
+    }
+
+    sched->next = next;
+    sched->next_event = next_event;
+}
+
+void gb_sched_init(gb_scheduler_t *sched) {
+    memset(sched, 0, sizeof(gb_scheduler_t));
+    for (u8 i = 0; i < GB_EVENT_COUNT; i++) {
+        sched->when[i] = GB_SCHED_NEVER;
+    }
+    sched->next = GB_SCHED_NEVER;
+}
+
+void gb_sched_schedule(gb_scheduler_t *sched, gb_event_t event, u64 when) {
+    sched->when[event] = when;
+    if (when < sched->next || (when == sched->next && event < sched->next_event)) {
+        sched->next = when;
+        sched->next_event = event;
+    } else if (event == sched->next_event) {
+        /* The earliest event moved later */
+        find_next(sched);
+    }
+}
+
+void gb_sched_cancel(gb_scheduler_t *sched, gb_event_t event) {
+    sched->when[event] = GB_SCHED_NEVER;
+    if (event == sched->next_event) {
+        find_next(sched);
+    }
+}
+
+void gb_sched_dispatch(gb_scheduler_t *sched, gb_mmu_t *mmu) {
+    while (sched->next <= sched->now) {
+        gb_event_t event = (gb_event_t)sched->next_event;
+        u64 when = sched->next;
+
+        /* Handlers re-schedule themselves relative to `when`, not `now`,
+         * so an event that fires late never drifts */
+        gb_sched_cancel(sched, event);
+
+        switch (event) {
+            case GB_EVENT_PPU:
+                if (gb_ppu_event(mmu->ppu, mmu, when)) {
+                    gb_sched_stop(sched, GB_STOP_VBLANK);
+                }
+                break;
+            case GB_EVENT_APU_FRAME_SEQ:
+                gb_apu_frame_sequencer_event(mmu->apu, mmu, when);
+                break;
+            case GB_EVENT_APU_SAMPLE:
+                gb_apu_sample_event(mmu->apu, mmu, when);
+                break;
+            case GB_EVENT_TIMER:
+                gb_mmu_timer_event(mmu, when);
+                break;
+            case GB_EVENT_OAM_DMA:
+                gb_mmu_oam_dma_event(mmu);
+                break;
+            case GB_EVENT_HDMA:
+                gb_mmu_execute_hdma(mmu, when);
+                break;
+            case GB_EVENT_SERIAL:
+                gb_mmu_serial_event(mmu);
+                break;
+            default:
+                break;
+        }
+    }
+}
@@ -0,0 +1,121 @@
+/**
+ * NeoBoy - Game Boy Event Scheduler Header
+ *
+ * Purpose: Single master clock and timestamp-ordered hardware events
+ *
+ * All time in the core is measured in CPU cycles on one 64-bit clock
+ * (`now`). Components do not tick after every instruction; instead each
+ * one schedules its next interesting moment (PPU mode change, TIMA
+ * overflow, frame-sequencer tick, ...) at an absolute cycle time, and the
+ * CPU runs freely until the earliest of them is due.
+ *
+ * There is a fixed slot per event source, so scheduling never allocates
+ * and re-scheduling an event simply replaces its timestamp.
+ */
+
+#ifndef GB_SCHEDULER_H
+#define GB_SCHEDULER_H
+
+#include "../common/common.h"
+
+struct gb_mmu_t;
+
+/* Timestamp of an idle slot */
+#define GB_SCHED_NEVER UINT64_MAX
+
+/* Event sources. When two events are due on the same cycle they are
+ * dispatched in this order. */
+typedef enum {
+    GB_EVENT_PPU = 0,         /* PPU mode transition */
+    GB_EVENT_APU_FRAME_SEQ,   /* 512 Hz frame sequencer tick */
+    GB_EVENT_APU_SAMPLE,      /* Audio output sample point */
+    GB_EVENT_TIMER,           /* TIMA overflow */
+    GB_EVENT_OAM_DMA,         /* OAM DMA transfer complete */
+    GB_EVENT_HDMA,            /* CGB H-Blank DMA block */
+    GB_EVENT_SERIAL,          /* Serial transfer completion */
+    GB_EVENT_COUNT
+} gb_event_t;
+
+/* Events whose handlers can raise an interrupt (and so wake a sleeping CPU) */
+#define GB_SCHED_IRQ_EVENTS (BIT(GB_EVENT_PPU) | BIT(GB_EVENT_TIMER) | BIT(GB_EVENT_SERIAL))
+
+/* Events that only advance audio state (nothing the CPU can read back
+ * outside FF10-FF3F) */
+#define GB_SCHED_APU_EVENTS (BIT(GB_EVENT_APU_FRAME_SEQ) | BIT(GB_EVENT_APU_SAMPLE))
+
+typedef struct gb_scheduler_t {
+    u64 now;                    /* Master clock (CPU cycles since reset) */
+    u64 deadline;               /* gb_cpu_run() returns once `now` reaches this */
+    u64 next;                   /* Timestamp of the earliest pending event */
+    u64 when[GB_EVENT_COUNT];   /* Per-event due time, GB_SCHED_NEVER if idle */
+    u8 next_event;              /* Event due at `next` */
+    u8 stop_mask;               /* GB_STOP_* conditions that end the current run */
+    u8 stop_reason;             /* GB_STOP_* conditions that fired during it */
+} gb_scheduler_t;
+
+/**
+ * Reset the clock to zero and clear all events
+ */
+void gb_sched_init(gb_scheduler_t *sched);
+
+/**
+ * Schedule (or re-schedule) an event at an absolute cycle time
+ */
+void gb_sched_schedule(gb_scheduler_t *sched, gb_event_t event, u64 when);
+
+/**
+ * Remove a pending event
+ */
+void gb_sched_cancel(gb_scheduler_t *sched, gb_event_t event);
+
+/**
+ * Dispatch every event due at or before `now`, in timestamp order
+ */
+void gb_sched_dispatch(gb_scheduler_t *sched, struct gb_mmu_t *mmu);
+
+static inline bool gb_sched_pending(const gb_scheduler_t *sched, gb_event_t event) {
+    return sched->when[event] != GB_SCHED_NEVER;
+}
+
+/* Earliest pending event among those in `mask` (a set of BIT(event)) */
+static inline u64 gb_sched_next_of(const gb_scheduler_t *sched, u32 mask) {
+    u64 next = GB_SCHED_NEVER;
+    for (u8 i = 0; i < GB_EVENT_COUNT; i++) {
+        if ((mask & BIT(i)) && sched->when[i] < next) {
+            next = sched->when[i];
+        }
+    }
+    return next;
+}
+
+/* Earliest pending event that can raise an interrupt. Everything before it
+ * only touches its own component state, keyed off its own timestamp, so
+ * dispatching it late in one batch gives the same result. */
+static inline u64 gb_sched_next_irq(const gb_scheduler_t *sched) {
+    return gb_sched_next_of(sched, GB_SCHED_IRQ_EVENTS);
+}
+
+/* Keep the CPU off the bus for `cycles` from `from` (VRAM DMA): the clock
+ * moves on to the end of the stall unless it is already past it (a halted
+ * CPU fast-forwarding over the event that stalls it). Events falling due
+ * inside the stall are dispatched after it, each with its own timestamp,
+ * as after any instruction; only an interrupt they raise waits for the
+ * CPU, which it would anyway. */
+static inline void gb_sched_stall(gb_scheduler_t *sched, u64 from, u32 cycles) {
+    sched->now = MAX(sched->now, from + cycles);
+}
+
+/* End the current gb_cpu_run() at the next instruction boundary */
+static inline void gb_sched_break(gb_scheduler_t *sched) {
+    sched->deadline = sched->now;
+}
+
+/* Report a stop condition (GB_STOP_* in core.h); ends the run if requested */
+static inline void gb_sched_stop(gb_scheduler_t *sched, u8 reason) {
+    if (sched->stop_mask & reason) {
+        sched->stop_reason |= reason;
+        gb_sched_break(sched);
+    }
+}
+
+#endif /* GB_SCHEDULER_H */
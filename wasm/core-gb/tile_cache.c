@@ -0,0 +1,45 @@
+/**
+ * NeoBoy - Game Boy Decoded Tile Cache Implementation
+ *
+ * Purpose: Bitplane decoding and dirty tracking
+ */
+
+#include "tile_cache.h"
+#include <string.h>
+
+gb_tile_cache_t gb_tile_cache;
+
+void gb_tile_cache_flush(void) {
+    memset(gb_tile_cache.dirty, 1, sizeof(gb_tile_cache.dirty));
+}
+
+void gb_tile_cache_invalidate(u16 offset, u16 len) {
+    u16 end = offset + len;
+    while (offset < end) {
+        u8 bank = offset >> 13;
+        u16 in_bank = offset & 0x1FFF;
+        u16 stop = MIN((u16)((bank + 1) * 0x2000), end);
+        if (in_bank < GB_TILE_DATA_SIZE) {
+            u16 last = MIN((u16)(in_bank + (stop - offset) - 1), GB_TILE_DATA_SIZE - 1);
+            memset(&gb_tile_cache.dirty[bank][in_bank >> 4], 1, (last >> 4) - (in_bank >> 4) + 1);
+        }
+        offset = stop;
+    }
+}
+
+void gb_tile_cache_decode(const u8 *vram, u8 bank, u16 tile) {
+    const u8 *data = vram + tile * 16;
+    for (u8 row = 0; row < 8; row++) {
+        u8 lo = data[row * 2];
+        u8 hi = data[row * 2 + 1];
+        u8 *out = gb_tile_cache.rows[bank][tile][row];
+        u8 *mirror = gb_tile_cache.flipped[bank][tile][row];
+        for (u8 px = 0; px < 8; px++) {
+            u8 bit = 7 - px;
+            u8 color = ((lo >> bit) & 1) | (((hi >> bit) & 1) << 1);
+            out[px] = color;
+            mirror[7 - px] = color;
+        }
+    }
+    gb_tile_cache.dirty[bank][tile] = 0;
+}
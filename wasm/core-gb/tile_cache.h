@@ -0,0 +1,69 @@
+/**
+ * NeoBoy - Game Boy Decoded Tile Cache Header
+ *
+ * Purpose: Tile rows as ready-made colour indices for the scanline renderer
+ *
+ * A tile row is stored in VRAM as two bitplanes; drawing it means pulling
+ * one bit out of each for every pixel. The cache keeps each of the 384
+ * tiles of both VRAM banks decoded into 8 rows of 8 colour indices (0-3),
+ * once as stored and once mirrored for X-flip, so the renderer copies a
+ * whole row per 8 pixels.
+ *
+ * Tiles are decoded on first use after they change. Writes to the tile data
+ * pages (0x8000-0x97FF) are not mapped in the page tables: they go through
+ * gb_mmu_write_slow() and gb_ppu_write_vram(), which marks the tile dirty,
+ * as do the HDMA/GDMA paths for the range they copied. Tile maps stay
+ * directly mapped unless rendering is deferred (gb_ppu_deferred), when
+ * their writes also take the slow path to reach the PPU's line journal;
+ * either way the renderer reads them from VRAM.
+ */
+
+#ifndef GB_TILE_CACHE_H
+#define GB_TILE_CACHE_H
+
+#include "../common/common.h"
+
+#define GB_TILE_COUNT      384     /* Tiles per VRAM bank (0x8000-0x97FF) */
+#define GB_TILE_DATA_SIZE  0x1800
+
+typedef struct {
+    u8 rows[2][GB_TILE_COUNT][8][8];     /* Bank, tile, row, pixel (left first) */
+    u8 flipped[2][GB_TILE_COUNT][8][8];  /* Same rows mirrored horizontally */
+    u8 dirty[2][GB_TILE_COUNT];          /* Changed since decoded */
+} gb_tile_cache_t;
+
+extern gb_tile_cache_t gb_tile_cache;
+
+/**
+ * Mark every tile dirty (VRAM replaced wholesale: reset, state load)
+ */
+void gb_tile_cache_flush(void);
+
+/**
+ * Mark the tiles overlapping `len` bytes at `offset` in the 16KB VRAM
+ * (bank 1 from 0x2000) dirty
+ */
+void gb_tile_cache_invalidate(u16 offset, u16 len);
+
+/**
+ * Decode one tile from VRAM (`vram` points at its bank)
+ */
+void gb_tile_cache_decode(const u8 *vram, u8 bank, u16 tile);
+
+/* Colour indices of row `row` of a tile, mirrored if `flip` */
+static inline const u8 *gb_tile_cache_row(const u8 *vram, u8 bank, u16 tile, u8 row, bool flip) {
+    if (gb_tile_cache.dirty[bank][tile]) {
+        gb_tile_cache_decode(vram + bank * 0x2000, bank, tile);
+    }
+    return flip ? gb_tile_cache.flipped[bank][tile][row] : gb_tile_cache.rows[bank][tile][row];
+}
+
+/* Mark the tile holding VRAM byte `offset` dirty (single CPU write) */
+static inline void gb_tile_cache_touch(u16 offset) {
+    u16 in_bank = offset & 0x1FFF;
+    if (in_bank < GB_TILE_DATA_SIZE) {
+        gb_tile_cache.dirty[offset >> 13][in_bank >> 4] = 1;
+    }
+}
+
+#endif /* GB_TILE_CACHE_H */
@@ -0,0 +1,45 @@
+/**
+ * NeoBoy - Game Boy Instruction Trace Implementation
+ *
+ * Purpose: Trace ring allocation and snapshots
+ */
+
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+gb_trace_t gb_trace;
+
+bool gb_trace_enable(u32 records) {
+    free(gb_trace.ring);
+    gb_trace.ring = NULL;
+    gb_trace.mask = 0;
+    gb_trace.count = 0;
+    if (!records) {
+        return true;
+    }
+
+    u32 size = 1;
+    while (size < records && size < 0x80000000u) {
+        size <<= 1;
+    }
+    gb_trace.ring = malloc((size_t)size * sizeof(GameBoyTraceRecord));
+    if (!gb_trace.ring) {
+        return false;
+    }
+    gb_trace.mask = size - 1;
+    return true;
+}
+
+u32 gb_trace_snapshot(GameBoyTraceRecord *out, u32 max) {
+    if (!gb_trace.ring) {
+        return 0;
+    }
+    u32 held = (u32)MIN(gb_trace.count, (u64)gb_trace.mask + 1);
+    u32 n = MIN(held, max);
+    u32 first = (gb_trace.count - n) & gb_trace.mask;
+    u32 head = MIN(n, gb_trace.mask + 1 - first); /* Up to the end of the ring */
+    memcpy(out, &gb_trace.ring[first], head * sizeof(GameBoyTraceRecord));
+    memcpy(out + head, gb_trace.ring, (n - head) * sizeof(GameBoyTraceRecord));
+    return n;
+}
@@ -0,0 +1,65 @@
+/**
+ * NeoBoy - Game Boy Instruction Trace Header
+ *
+ * Purpose: Binary ring of executed instructions for desync hunting
+ *
+ * gb_cpu_run() appends one GameBoyTraceRecord (core.h) per instruction it
+ * interprets while the ring is allocated (gb_set_trace); with the ring off
+ * the cost is one pointer test per interpreted instruction. Records hold
+ * the registers before the instruction, like the logs of most reference
+ * emulators, so tools/gb-trace-diff.c can line the two up. Interrupt
+ * dispatch and halted cycles leave no record of their own; the cycle stamp
+ * of the next record shows them.
+ */
+
+#ifndef GB_TRACE_H
+#define GB_TRACE_H
+
+#include "../common/common.h"
+#include "core.h"
+#include "cpu.h"
+#include "mmu.h"
+
+/* Trace files (tools/gb-trace.c) are this magic followed by the records */
+#define GB_TRACE_MAGIC     "NBTRACE1"
+#define GB_TRACE_MAGIC_LEN 8
+
+typedef struct {
+    GameBoyTraceRecord *ring;  /* NULL while tracing is off */
+    u32 mask;                  /* Ring size - 1 */
+    u64 count;                 /* Records written since enabled */
+} gb_trace_t;
+
+extern gb_trace_t gb_trace;
+
+/**
+ * Allocate a ring of at least `records` entries (0 frees it)
+ * Returns false if the allocation failed; tracing is then off
+ */
+bool gb_trace_enable(u32 records);
+
+/**
+ * Copy up to `max` of the newest records, oldest first; returns the count
+ */
+u32 gb_trace_snapshot(GameBoyTraceRecord *out, u32 max);
+
+/* Append the instruction at `pc` (already fetched, not yet executed) */
+static inline void gb_trace_record(const gb_cpu_t *cpu, const gb_mmu_t *mmu, u64 cycle, u16 pc, u8 opcode) {
+    GameBoyTraceRecord *r = &gb_trace.ring[gb_trace.count++ & gb_trace.mask];
+    r->cycle = cycle;
+    r->pc = pc;
+    r->bank = gb_mmu_code_bank(mmu, pc);
+    r->sp = cpu->sp;
+    r->opcode = opcode;
+    r->a = cpu->a;
+    r->f = gb_cpu_get_f(cpu);
+    r->b = cpu->b;
+    r->c = cpu->c;
+    r->d = cpu->d;
+    r->e = cpu->e;
+    r->h = cpu->h;
+    r->l = cpu->l;
+    r->reserved = 0;
+}
+
+#endif /* GB_TRACE_H */